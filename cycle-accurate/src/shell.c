@@ -19,6 +19,10 @@
 #include <stdint.h>
 
 #include "shell.h"
+#include "profile.h"
+#include "trace.h"
+#include "disasm.h"
+#include "mips.h"
 
 /***************************************************************/
 /* Main memory.                                                */
@@ -129,6 +133,43 @@ void help() {
   printf("quit                  - exit the program              \n\n");
 }
 
+/***************************************************************/
+/*                                                             */
+/* Procedure : trace_instruction                               */
+/*                                                             */
+/* Purpose   : Append the instruction just executed at pc to   */
+/*             the trace                                       */
+/*                                                             */
+/***************************************************************/
+void trace_instruction(uint32_t pc) {
+  Trace_Record record;
+  int regs[TRACE_MAX_REG_WRITES];
+  int opcode, i;
+
+  record.pc = pc;
+  record.instruction = mem_read_32(pc);
+  record.num_reg_writes = mips_dest_regs(record.instruction, regs);
+  for (i = 0; i < record.num_reg_writes; i++) {
+    record.reg[i] = regs[i];
+    if (regs[i] == MIPS_REG_HI)
+      record.value[i] = NEXT_STATE.HI;
+    else if (regs[i] == MIPS_REG_LO)
+      record.value[i] = NEXT_STATE.LO;
+    else
+      record.value[i] = NEXT_STATE.REGS[regs[i]];
+  }
+
+  opcode = record.instruction >> 26;
+  record.mem = TRACE_MEM_NONE;
+  if (opcode >= OP_LB && opcode <= OP_SW) {
+    record.mem = opcode >= OP_SB ? TRACE_MEM_STORE : TRACE_MEM_LOAD;
+    record.mem_addr = CURRENT_STATE.REGS[(record.instruction >> 21) & 0x1F] +
+                      (int16_t) (record.instruction & 0xFFFF);
+  }
+
+  trace_write(&record);
+}
+
 /***************************************************************/
 /*                                                             */
 /* Procedure : cycle                                           */
@@ -137,8 +178,12 @@ void help() {
 /*                                                             */
 /***************************************************************/
 void cycle() {                                                
+  uint32_t pc = CURRENT_STATE.PC;
 
+  profile_count(pc, PROF_EXECUTED, 1);
   process_instruction();
+  if (trace.active)
+    trace_instruction(pc);
   CURRENT_STATE = NEXT_STATE;
   INSTRUCTION_COUNT++;
 }
@@ -374,6 +419,7 @@ void load_program(char *program_filename) {
   CURRENT_STATE.PC = MEM_TEXT_START;
 
   printf("Read %d words from program into memory.\n\n", ii/4);
+  profile_load_source(program_filename, ii/4);
 }
 
 /************************************************************/
@@ -404,17 +450,49 @@ void initialize(char *program_filename, int num_prog_files) {
 /***************************************************************/
 int main(int argc, char *argv[]) {                              
   FILE * dumpsim_file;
+  int first_prog = 1;
+  int profile_top = 40;
+  const char *profile_file = NULL;
+  const char *trace_file = NULL;
+  int trace_compress = 1;
+
+  /* Options come before the program files */
+  while (first_prog < argc && strncmp(argv[first_prog], "--", 2) == 0) {
+    if (strcmp(argv[first_prog], "--profile=1") == 0)
+      profile_file = profile_file ? profile_file : "";
+    else if (strcmp(argv[first_prog], "--profile=0") == 0)
+      profile_file = NULL;
+    else if (strncmp(argv[first_prog], "--profile-top=", 14) == 0)
+      profile_top = atoi(argv[first_prog] + 14);
+    else if (strncmp(argv[first_prog], "--profile-file=", 15) == 0)
+      profile_file = argv[first_prog] + 15;
+    else if (strncmp(argv[first_prog], "--trace-file=", 13) == 0)
+      trace_file = argv[first_prog] + 13;
+    else if (strncmp(argv[first_prog], "--trace-compress=", 17) == 0)
+      trace_compress = atoi(argv[first_prog] + 17);
+    else {
+      printf("Error: invalid option %s\n", argv[first_prog]);
+      exit(1);
+    }
+    first_prog++;
+  }
 
   /* Error Checking */
-  if (argc < 2) {
-    printf("Error: usage: %s <program_file_1> <program_file_2> ...\n",
-           argv[0]);
+  if (first_prog >= argc) {
+    printf("Error: usage: %s [--profile=1] [--profile-top=N] [--profile-file=path] "
+           "[--trace-file=path] [--trace-compress=0|1] "
+           "<program_file_1> <program_file_2> ...\n", argv[0]);
     exit(1);
   }
 
   printf("MIPS Simulator\n\n");
 
-  initialize(argv[1], argc - 1);
+  if (profile_file)
+    init_profile(MEM_TEXT_START, MEM_TEXT_SIZE, PROF_EXECUTED + 1, PROF_EXECUTED,
+                 profile_top, profile_file);
+  initialize(argv[first_prog], argc - first_prog);
+  if (trace_file)
+    init_trace(trace_file, trace_compress, MEM_TEXT_START, MEM_TEXT_SIZE);
 
   if ( (dumpsim_file = fopen( "dumpsim", "w" )) == NULL ) {
     printf("Error: Can't open dumpsim file\n");
@@ -0,0 +1,45 @@
+#include "bimodal.h"
+#include <stdlib.h>
+
+void init_bimodal(Bimodal *bimodal, uint32_t size)
+{
+    bimodal->size = size;
+    bimodal->counters = (uint8_t*) malloc(size * sizeof(uint8_t));
+
+    for (uint32_t i = 0; i < size; ++i) {
+        bimodal->counters[i] = 1;
+    }
+}
+
+void destroy_bimodal(Bimodal *bimodal)
+{
+    free(bimodal->counters);
+}
+
+uint32_t get_bimodal_index(Bimodal *bimodal, uint32_t PC)
+{
+    return ((PC >> 2) & (bimodal->size - 1));
+}
+
+int predict_bimodal(Bimodal *bimodal, uint32_t PC, Bpred_Info *info)
+{
+    info->index[0] = get_bimodal_index(bimodal, PC);
+    info->taken = bimodal->counters[info->index[0]] > 1;
+
+    return info->taken;
+}
+
+void update_bimodal(Bimodal *bimodal, uint32_t index, uint8_t is_taken)
+{
+    if (is_taken) {
+        bimodal->counters[index] += (bimodal->counters[index] == 3 ? 0 : 1);
+    }
+    else {
+        bimodal->counters[index] -= (bimodal->counters[index] == 0 ? 0 : 1);
+    }
+}
+
+uint32_t bimodal_storage_bits(Bimodal *bimodal)
+{
+    return 2 * bimodal->size;
+}
@@ -0,0 +1,33 @@
+#ifndef _BIMODAL_H_
+#define _BIMODAL_H_
+
+#include <stdint.h>
+#include "bpred_info.h"
+
+#define BIMODAL_SIZE 4096
+
+/* table of 2-bit saturating counters indexed by PC */
+typedef struct Bimodal {
+    uint32_t size;          /* number of counters (power of two) */
+    uint8_t *counters;
+} Bimodal;
+
+/* allocates the counters and sets them to weakly not taken */
+void init_bimodal(Bimodal *bimodal, uint32_t size);
+
+/* frees the counters */
+void destroy_bimodal(Bimodal *bimodal);
+
+/* returns the counter index for the given PC */
+uint32_t get_bimodal_index(Bimodal *bimodal, uint32_t PC);
+
+/* returns 1 if the branch at PC is predicted taken */
+int predict_bimodal(Bimodal *bimodal, uint32_t PC, Bpred_Info *info);
+
+/* trains the counter used for the prediction */
+void update_bimodal(Bimodal *bimodal, uint32_t index, uint8_t is_taken);
+
+/* returns the number of bits of predictor state */
+uint32_t bimodal_storage_bits(Bimodal *bimodal);
+
+#endif
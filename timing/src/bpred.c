@@ -0,0 +1,223 @@
+#include "bpred.h"
+#include "config.h"
+#include "shell.h"
+#include "mips.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *bpred_names[] = { "bimodal", "gshare", "tournament", "tage", "perceptron" };
+
+static void check_power_of_two(const char *name, int value)
+{
+    if (value <= 0 || (value & (value - 1)) != 0) {
+        printf("Error: %s must be a power of two\n", name);
+        exit(-1);
+    }
+}
+
+void init_bpred(Branch_Predictor *bp, int type)
+{
+    memset(bp, 0, sizeof(Branch_Predictor));
+    bp->type = type;
+    bp->speculative = sim_config.bp_spec_history;
+
+    switch (type) {
+        case BP_BIMODAL:
+            check_power_of_two("bp-bimodal-entries", sim_config.bp_bimodal_entries);
+            init_bimodal(&bp->u.bimodal, sim_config.bp_bimodal_entries);
+            break;
+
+        case BP_GSHARE:
+            check_power_of_two("bp-gshare-entries", sim_config.bp_gshare_entries);
+            if (sim_config.bp_gshare_history < 0 || sim_config.bp_gshare_history > 32) {
+                printf("Error: bp-gshare-history must be between 0 and 32\n");
+                exit(-1);
+            }
+            init_gshare(&bp->u.gshare, sim_config.bp_gshare_history, sim_config.bp_gshare_entries);
+            break;
+
+        case BP_TOURNAMENT:
+            check_power_of_two("bp-bimodal-entries", sim_config.bp_bimodal_entries);
+            check_power_of_two("bp-gshare-entries", sim_config.bp_gshare_entries);
+            check_power_of_two("bp-chooser-entries", sim_config.bp_chooser_entries);
+            if (sim_config.bp_gshare_history < 0 || sim_config.bp_gshare_history > 32) {
+                printf("Error: bp-gshare-history must be between 0 and 32\n");
+                exit(-1);
+            }
+            init_tournament(&bp->u.tournament, sim_config.bp_bimodal_entries,
+                            sim_config.bp_gshare_history, sim_config.bp_gshare_entries,
+                            sim_config.bp_chooser_entries);
+            break;
+
+        case BP_TAGE:
+            check_power_of_two("bp-bimodal-entries", sim_config.bp_bimodal_entries);
+            if (sim_config.bp_tage_tables < 1 || sim_config.bp_tage_tables > TAGE_MAX_TABLES) {
+                printf("Error: bp-tage-tables must be between 1 and %d\n", TAGE_MAX_TABLES);
+                exit(-1);
+            }
+            if (sim_config.bp_tage_log_entries < 2 || sim_config.bp_tage_log_entries > 16 ||
+                sim_config.bp_tage_tag_bits < 2 || sim_config.bp_tage_tag_bits > 16) {
+                printf("Error: bp-tage-log-entries and bp-tage-tag-bits must be between 2 and 16\n");
+                exit(-1);
+            }
+            if (sim_config.bp_tage_min_history < 1 ||
+                sim_config.bp_tage_max_history < sim_config.bp_tage_min_history ||
+                sim_config.bp_tage_max_history >= TAGE_HIST_BUFFER) {
+                printf("Error: TAGE history lengths must satisfy 1 <= min <= max < %d\n",
+                       TAGE_HIST_BUFFER);
+                exit(-1);
+            }
+            init_tage(&bp->u.tage, sim_config.bp_bimodal_entries, sim_config.bp_tage_tables,
+                      sim_config.bp_tage_log_entries, sim_config.bp_tage_tag_bits,
+                      sim_config.bp_tage_min_history, sim_config.bp_tage_max_history);
+            break;
+
+        case BP_PERCEPTRON:
+            check_power_of_two("bp-perceptron-entries", sim_config.bp_perceptron_entries);
+            if (sim_config.bp_perceptron_history < 1 ||
+                sim_config.bp_perceptron_history > PERCEPTRON_MAX_HISTORY) {
+                printf("Error: bp-perceptron-history must be between 1 and %d\n",
+                       PERCEPTRON_MAX_HISTORY);
+                exit(-1);
+            }
+            init_perceptron(&bp->u.perceptron, sim_config.bp_perceptron_entries,
+                            sim_config.bp_perceptron_history);
+            break;
+    }
+}
+
+void destroy_bpred(Branch_Predictor *bp)
+{
+    switch (bp->type) {
+        case BP_BIMODAL:    destroy_bimodal(&bp->u.bimodal); break;
+        case BP_GSHARE:     destroy_gshare(&bp->u.gshare); break;
+        case BP_TOURNAMENT: destroy_tournament(&bp->u.tournament); break;
+        case BP_TAGE:       destroy_tage(&bp->u.tage); break;
+        case BP_PERCEPTRON: destroy_perceptron(&bp->u.perceptron); break;
+    }
+}
+
+const char *bpred_name(Branch_Predictor *bp)
+{
+    return bpred_names[bp->type];
+}
+
+int bpred_predict(Branch_Predictor *bp, uint32_t PC, Bpred_Info *info)
+{
+    switch (bp->type) {
+        case BP_BIMODAL:    return predict_bimodal(&bp->u.bimodal, PC, info);
+        case BP_GSHARE:     return predict_gshare(&bp->u.gshare, PC, info);
+        case BP_TOURNAMENT: return predict_tournament(&bp->u.tournament, PC, info);
+        case BP_TAGE:       return predict_tage(&bp->u.tage, PC, info);
+        case BP_PERCEPTRON: return predict_perceptron(&bp->u.perceptron, PC, info);
+    }
+
+    return 0;
+}
+
+void bpred_resolve(Branch_Predictor *bp, uint32_t PC, uint8_t is_taken, Bpred_Info *info)
+{
+    bp->stat_cond_branches++;
+    if (info->taken != is_taken)
+        bp->stat_mispredicts++;
+
+    /* with resolve-time history, the gshare PHT is trained at the index
+     * formed with the current history (as in the original model) */
+    if (!bp->speculative) {
+        if (bp->type == BP_GSHARE)
+            info->index[0] = get_pht_index(&bp->u.gshare, PC);
+        else if (bp->type == BP_TOURNAMENT)
+            info->index[1] = get_pht_index(&bp->u.tournament.gshare, PC);
+    }
+
+    switch (bp->type) {
+        case BP_BIMODAL:    update_bimodal(&bp->u.bimodal, info->index[0], is_taken); break;
+        case BP_GSHARE:     update_gshare(&bp->u.gshare, info->index[0], is_taken); break;
+        case BP_TOURNAMENT: update_tournament(&bp->u.tournament, PC, is_taken, info); break;
+        case BP_TAGE:       update_tage(&bp->u.tage, PC, is_taken, info); break;
+        case BP_PERCEPTRON: update_perceptron(&bp->u.perceptron, PC, is_taken, info); break;
+    }
+
+    if (!bp->speculative)
+        bpred_update_history(bp, is_taken);
+}
+
+int bpred_is_cond_branch(uint32_t instruction)
+{
+    switch ((instruction >> 26) & 0x3F) {
+        case OP_BRSPEC:
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_BLEZ:
+        case OP_BGTZ:
+            return 1;
+    }
+
+    return 0;
+}
+
+void bpred_update_history(Branch_Predictor *bp, uint8_t is_taken)
+{
+    switch (bp->type) {
+        case BP_GSHARE:     shift_gshare_history(&bp->u.gshare, is_taken); break;
+        case BP_TOURNAMENT: shift_gshare_history(&bp->u.tournament.gshare, is_taken); break;
+        case BP_TAGE:       shift_tage_history(&bp->u.tage, is_taken); break;
+        case BP_PERCEPTRON: shift_perceptron_history(&bp->u.perceptron, is_taken); break;
+    }
+}
+
+void bpred_save_history(Branch_Predictor *bp, Bpred_History *history)
+{
+    switch (bp->type) {
+        case BP_GSHARE:     history->ghr = bp->u.gshare.GHR; break;
+        case BP_TOURNAMENT: history->ghr = bp->u.tournament.gshare.GHR; break;
+        case BP_TAGE:       save_tage_history(&bp->u.tage, history); break;
+        case BP_PERCEPTRON: history->ghr = bp->u.perceptron.history; break;
+    }
+}
+
+void bpred_restore_history(Branch_Predictor *bp, Bpred_History *history)
+{
+    switch (bp->type) {
+        case BP_GSHARE:     bp->u.gshare.GHR = (uint32_t) history->ghr; break;
+        case BP_TOURNAMENT: bp->u.tournament.gshare.GHR = (uint32_t) history->ghr; break;
+        case BP_TAGE:       restore_tage_history(&bp->u.tage, history); break;
+        case BP_PERCEPTRON: bp->u.perceptron.history = history->ghr; break;
+    }
+}
+
+void bpred_repair_history(Branch_Predictor *bp, Bpred_History *history, int outcome)
+{
+    bpred_restore_history(bp, history);
+    if (outcome >= 0)
+        bpred_update_history(bp, outcome);
+}
+
+uint32_t bpred_storage_bits(Branch_Predictor *bp)
+{
+    switch (bp->type) {
+        case BP_BIMODAL:    return bimodal_storage_bits(&bp->u.bimodal);
+        case BP_GSHARE:     return gshare_storage_bits(&bp->u.gshare);
+        case BP_TOURNAMENT: return tournament_storage_bits(&bp->u.tournament);
+        case BP_TAGE:       return tage_storage_bits(&bp->u.tage);
+        case BP_PERCEPTRON: return perceptron_storage_bits(&bp->u.perceptron);
+    }
+
+    return 0;
+}
+
+void bpred_register_stats(Branch_Predictor *bp)
+{
+    stats_register_constant("PredictorStorageBits", bpred_storage_bits(bp),
+                            "direction predictor state");
+    stats_register_counter("CondBranches", &bp->stat_cond_branches,
+                           "resolved conditional branches");
+    stats_register_counter("DirMispredicts", &bp->stat_mispredicts,
+                           "conditional branches with a mispredicted direction");
+    stats_register_formula("DirAccuracy", &bp->stat_cond_branches, &bp->stat_mispredicts,
+                           &bp->stat_cond_branches, 1.0, "direction prediction accuracy");
+    stats_register_formula("MPKI", &bp->stat_mispredicts, NULL, &stat_inst_retire, 1000.0,
+                           "direction mispredictions per 1000 retired instructions");
+}
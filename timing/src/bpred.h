@@ -0,0 +1,81 @@
+#ifndef _BPRED_H_
+#define _BPRED_H_
+
+#include <stdint.h>
+#include "bpred_info.h"
+#include "bimodal.h"
+#include "gshare.h"
+#include "tournament.h"
+#include "tage.h"
+#include "perceptron.h"
+
+/* direction predictors (values of sim_config.bp) */
+#define BP_BIMODAL    0
+#define BP_GSHARE     1
+#define BP_TOURNAMENT 2
+#define BP_TAGE       3
+#define BP_PERCEPTRON 4
+
+/* The direction predictor selected at run time. Every predictor implements
+ * init/predict/update/storage_bits/destroy; the functions below dispatch to
+ * the selected one and keep accuracy statistics.
+ *
+ * By default the global history is updated when a branch resolves. With
+ * speculative history, the front end shifts predicted directions in at
+ * fetch with bpred_update_history(), saves the history of every op with
+ * bpred_save_history(), and repairs it after a misprediction. */
+typedef struct Branch_Predictor {
+    int type;
+    int speculative;        /* history updated at fetch? */
+    union {
+        Bimodal bimodal;
+        Gshare gshare;
+        Tournament tournament;
+        Tage tage;
+        Perceptron perceptron;
+    } u;
+
+    /* statistics */
+    uint64_t stat_cond_branches;    /* resolved conditional branches */
+    uint64_t stat_mispredicts;      /* of which the direction was mispredicted */
+} Branch_Predictor;
+
+/* initializes the predictor of the given type with the configured geometry */
+void init_bpred(Branch_Predictor *bp, int type);
+
+/* frees all predictor structures */
+void destroy_bpred(Branch_Predictor *bp);
+
+/* returns the name of the predictor */
+const char *bpred_name(Branch_Predictor *bp);
+
+/* predicts the direction of the instruction at PC; fills in info, which has
+ * to be passed back to bpred_resolve() if it turns out to be a branch */
+int bpred_predict(Branch_Predictor *bp, uint32_t PC, Bpred_Info *info);
+
+/* trains the predictor with the outcome of a conditional branch; also
+ * updates the history unless it is speculative */
+void bpred_resolve(Branch_Predictor *bp, uint32_t PC, uint8_t is_taken, Bpred_Info *info);
+
+/* returns 1 if the instruction is a conditional branch (predecode) */
+int bpred_is_cond_branch(uint32_t instruction);
+
+/* shifts a branch direction into the global history */
+void bpred_update_history(Branch_Predictor *bp, uint8_t is_taken);
+
+/* saves/restores the global history */
+void bpred_save_history(Branch_Predictor *bp, Bpred_History *history);
+void bpred_restore_history(Branch_Predictor *bp, Bpred_History *history);
+
+/* repairs the history after a misprediction: restores the history saved when
+ * the branch was fetched and shifts in its outcome (-1 if it is not a
+ * conditional branch) */
+void bpred_repair_history(Branch_Predictor *bp, Bpred_History *history, int outcome);
+
+/* returns the number of bits of predictor state */
+uint32_t bpred_storage_bits(Branch_Predictor *bp);
+
+/* registers the accuracy and storage budget of the predictor */
+void bpred_register_stats(Branch_Predictor *bp);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _BPRED_INFO_H_
+#define _BPRED_INFO_H_
+
+#include <stdint.h>
+
+/* most tables any predictor reads for one prediction */
+#define BPRED_MAX_TABLES 16
+
+/* Information recorded by a direction predictor when it makes a prediction.
+ * It travels with the branch so that the predictor can be trained with the
+ * same table entries once the branch resolves. */
+typedef struct Bpred_Info {
+    uint8_t taken;          /* predicted direction */
+    uint8_t alt_taken;      /* alternate prediction (TAGE altpred, tournament loser) */
+    uint8_t provider;       /* providing component or table */
+    uint8_t alt_provider;   /* table of the alternate prediction */
+    int32_t output;         /* perceptron dot product */
+    uint64_t history;       /* global history at prediction time */
+    uint32_t index[BPRED_MAX_TABLES];  /* table indices at prediction time */
+    uint16_t tag[BPRED_MAX_TABLES];    /* partial tags at prediction time */
+} Bpred_Info;
+
+/* Global history of a predictor, saved before every speculative history
+ * update so that the history can be repaired after a misprediction. */
+typedef struct Bpred_History {
+    uint64_t ghr;                       /* gshare/tournament/perceptron history */
+    uint32_t ptr;                       /* TAGE history buffer position */
+    uint32_t fold[3][BPRED_MAX_TABLES]; /* TAGE folded histories */
+} Bpred_History;
+
+#endif
@@ -0,0 +1,258 @@
+#include "btb.h"
+#include "config.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int log2_of(int value)
+{
+    int n = 0;
+    while ((1 << n) < value)
+        n++;
+    return n;
+}
+
+static void init_level(BTB_Level *level, const char *name, int entries, int ways)
+{
+    if (entries <= 0 || ways <= 0 || (entries & (entries - 1)) != 0 ||
+        (ways & (ways - 1)) != 0 || ways > entries || ways > 32) {
+        printf("Error: %s entries and ways must be powers of two with ways <= min(entries, 32)\n",
+               name);
+        exit(-1);
+    }
+
+    level->num_ways = ways;
+    level->num_sets = entries / ways;
+    level->log2_sets = log2_of(level->num_sets);
+    level->tag_bits = 30 - level->log2_sets;
+    if (sim_config.btb_tag_bits > 0 && sim_config.btb_tag_bits < level->tag_bits)
+        level->tag_bits = sim_config.btb_tag_bits;
+    level->repl = sim_config.btb_repl;
+
+    level->entries = (BTB_Entry*) calloc(entries, sizeof(BTB_Entry));
+    level->plru = (uint32_t*) calloc(level->num_sets, sizeof(uint32_t));
+    for (int i = 0; i < entries; ++i)
+        level->entries[i].lru = ways - 1;
+}
+
+static uint32_t level_set(BTB_Level *level, uint32_t PC)
+{
+    return (PC >> 2) & (level->num_sets - 1);
+}
+
+static uint32_t level_tag(BTB_Level *level, uint32_t PC)
+{
+    uint32_t tag = PC >> (2 + level->log2_sets);
+    if (level->tag_bits < 32)
+        tag &= (1u << level->tag_bits) - 1;
+    return tag;
+}
+
+/* marks way as most recently used */
+static void level_touch(BTB_Level *level, uint32_t set, int way)
+{
+    BTB_Entry *e = &level->entries[set * level->num_ways];
+
+    if (level->repl == BTB_REPL_LRU) {
+        for (int i = 0; i < level->num_ways; ++i) {
+            if (e[i].lru < e[way].lru)
+                e[i].lru++;
+        }
+        e[way].lru = 0;
+        return;
+    }
+
+    /* walk from the root, pointing every node away from way */
+    int node = 0;
+    for (int half = level->num_ways / 2; half > 0; half /= 2) {
+        int right = (way & half) != 0;
+        if (right)
+            level->plru[set] &= ~(1u << node);
+        else
+            level->plru[set] |= 1u << node;
+        node = 2 * node + 1 + right;
+    }
+}
+
+static int level_victim(BTB_Level *level, uint32_t set)
+{
+    BTB_Entry *e = &level->entries[set * level->num_ways];
+
+    for (int way = 0; way < level->num_ways; ++way) {
+        if (!e[way].valid)
+            return way;
+    }
+
+    if (level->repl == BTB_REPL_LRU) {
+        for (int way = 0; way < level->num_ways; ++way) {
+            if (e[way].lru == level->num_ways - 1)
+                return way;
+        }
+        return 0;
+    }
+
+    /* follow the tree bits to the pseudo-LRU way */
+    int node = 0, way = 0;
+    for (int half = level->num_ways / 2; half > 0; half /= 2) {
+        int right = (level->plru[set] >> node) & 1;
+        way |= right ? half : 0;
+        node = 2 * node + 1 + right;
+    }
+    return way;
+}
+
+static BTB_Entry *level_find(BTB_Level *level, uint32_t PC, int touch)
+{
+    uint32_t set = level_set(level, PC);
+    uint32_t tag = level_tag(level, PC);
+    BTB_Entry *e = &level->entries[set * level->num_ways];
+
+    for (int way = 0; way < level->num_ways; ++way) {
+        if (e[way].valid && e[way].tag == tag) {
+            if (touch)
+                level_touch(level, set, way);
+            return &e[way];
+        }
+    }
+
+    return NULL;
+}
+
+static BTB_Entry *level_insert(BTB_Level *level, uint32_t PC, uint32_t target,
+                               int is_unconditional)
+{
+    uint32_t set = level_set(level, PC);
+    int way = level_victim(level, set);
+    BTB_Entry *e = &level->entries[set * level->num_ways + way];
+
+    e->tag = level_tag(level, PC);
+    e->branch_target = target;
+    e->valid = 1;
+    e->is_unconditional = is_unconditional;
+    level_touch(level, set, way);
+
+    return e;
+}
+
+static uint32_t level_storage_bits(BTB_Level *level)
+{
+    /* valid + tag + word-aligned target + unconditional bit */
+    uint32_t entry_bits = 1 + level->tag_bits + 30 + 1;
+    uint32_t repl_bits = level->repl == BTB_REPL_LRU ?
+        level->num_ways * log2_of(level->num_ways) : level->num_ways - 1;
+
+    return level->num_sets * (level->num_ways * entry_bits + repl_bits);
+}
+
+static void destroy_level(BTB_Level *level)
+{
+    free(level->entries);
+    free(level->plru);
+}
+
+void init_btb(BTB *btb)
+{
+    memset(btb, 0, sizeof(BTB));
+
+    init_level(&btb->l1, "btb", sim_config.btb_entries, sim_config.btb_ways);
+    if (sim_config.btb_l0_entries > 0) {
+        btb->has_l0 = 1;
+        init_level(&btb->l0, "btb-l0", sim_config.btb_l0_entries, sim_config.btb_l0_entries);
+        btb->l1_bubble = sim_config.btb_l1_bubble;
+    }
+}
+
+void destroy_btb(BTB *btb)
+{
+    destroy_level(&btb->l1);
+    if (btb->has_l0)
+        destroy_level(&btb->l0);
+}
+
+BTB_Entry *btb_lookup(BTB *btb, uint32_t PC, int *bubble)
+{
+    btb->stat_lookups++;
+    *bubble = 0;
+
+    if (btb->has_l0) {
+        BTB_Entry *e = level_find(&btb->l0, PC, 1);
+        if (e) {
+            btb->stat_l0_hits++;
+            return e;
+        }
+    }
+
+    BTB_Entry *e = level_find(&btb->l1, PC, 1);
+    if (e == NULL)
+        return NULL;
+
+    btb->stat_l1_hits++;
+    if (btb->has_l0) {
+        *bubble = btb->l1_bubble;
+        level_insert(&btb->l0, PC, e->branch_target, e->is_unconditional);
+    }
+
+    return e;
+}
+
+void btb_update(BTB *btb, uint32_t PC, uint32_t target, int is_unconditional)
+{
+    BTB_Entry *e = level_find(&btb->l1, PC, 0);
+    if (e == NULL) {
+        level_insert(&btb->l1, PC, target, is_unconditional);
+    }
+    else {
+        e->branch_target = target;
+        e->is_unconditional = is_unconditional;
+    }
+
+    /* the L0 is filled on L1 hits; only keep existing copies up to date */
+    if (btb->has_l0) {
+        e = level_find(&btb->l0, PC, 0);
+        if (e) {
+            e->branch_target = target;
+            e->is_unconditional = is_unconditional;
+        }
+    }
+}
+
+void btb_invalidate(BTB *btb, uint32_t PC)
+{
+    btb->stat_alias_flushes++;
+
+    BTB_Entry *e = level_find(&btb->l1, PC, 0);
+    if (e)
+        e->valid = 0;
+    if (btb->has_l0) {
+        e = level_find(&btb->l0, PC, 0);
+        if (e)
+            e->valid = 0;
+    }
+}
+
+uint32_t btb_storage_bits(BTB *btb)
+{
+    uint32_t bits = level_storage_bits(&btb->l1);
+    if (btb->has_l0)
+        bits += level_storage_bits(&btb->l0);
+    return bits;
+}
+
+void btb_register_stats(BTB *btb)
+{
+    stats_register_constant("BTBStorageBits", btb_storage_bits(btb), "BTB state");
+    stats_register_counter("BTBLookups", &btb->stat_lookups, "BTB lookups");
+    if (btb->has_l0)
+        stats_register_counter("BTBL0Hits", &btb->stat_l0_hits, "lookups that hit in the L0");
+    stats_register_counter("BTBL1Hits", &btb->stat_l1_hits, "lookups that hit in the L1");
+    stats_register_counter("TakenBranches", &btb->stat_taken_branches, "resolved taken branches");
+    stats_register_counter("BTBTakenMisses", &btb->stat_taken_misses,
+                           "taken branches without a BTB entry");
+    if (sim_config.btb_tag_bits > 0)
+        stats_register_counter("BTBAliasFlushes", &btb->stat_alias_flushes,
+                               "non-branches redirected by a partial-tag BTB alias");
+    if (btb->has_l0)
+        stats_register_counter("BTBBubbleCycles", &btb->stat_bubble_cycles,
+                               "fetch cycles lost to L1 BTB bubbles");
+}
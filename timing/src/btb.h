@@ -0,0 +1,69 @@
+#ifndef _BTB_H_
+#define _BTB_H_
+
+#include <stdint.h>
+#include "btb_entry.h"
+
+#define BTB_SIZE 1024
+#define BTB_WAYS 1
+#define BTB_TAG_BITS 0      /* 0 = full tag */
+#define BTB_L0_SIZE 0       /* 0 = single-level BTB */
+#define BTB_L1_BUBBLE 1     /* fetch bubble after a taken L1 prediction */
+
+/* replacement policies (values of sim_config.btb_repl) */
+#define BTB_REPL_LRU  0
+#define BTB_REPL_PLRU 1
+
+/* One set-associative level. With PLRU replacement every set keeps a binary
+ * tree of ways - 1 bits; a bit points towards the less recently used half. */
+typedef struct BTB_Level {
+    int num_sets, num_ways;
+    int log2_sets;
+    int tag_bits;           /* stored tag bits */
+    int repl;
+    BTB_Entry *entries;     /* num_sets x num_ways */
+    uint32_t *plru;         /* per-set tree bits */
+} BTB_Level;
+
+/* Branch target buffer. If an L0 is present, it is a small fully-associative
+ * table that predicts without a bubble; targets found only in the larger L1
+ * redirect fetch l1_bubble cycles late and are copied into the L0. */
+typedef struct BTB {
+    BTB_Level l0, l1;
+    int has_l0;
+    int l1_bubble;
+
+    /* statistics */
+    uint64_t stat_lookups;
+    uint64_t stat_l0_hits;
+    uint64_t stat_l1_hits;
+    uint64_t stat_taken_branches;   /* resolved taken branches */
+    uint64_t stat_taken_misses;     /* of which the BTB had no entry */
+    uint64_t stat_bubble_cycles;    /* fetch cycles lost to L1 bubbles */
+    uint64_t stat_alias_flushes;    /* non-branches redirected by a partial tag */
+} BTB;
+
+/* initializes the BTB with the configured geometry */
+void init_btb(BTB *btb);
+
+/* frees all BTB structures */
+void destroy_btb(BTB *btb);
+
+/* looks up the branch at PC; returns NULL on a miss. On a hit, *bubble is set
+ * to the fetch bubble to insert if fetch is redirected to the target. */
+BTB_Entry *btb_lookup(BTB *btb, uint32_t PC, int *bubble);
+
+/* installs or updates the target of the branch at PC */
+void btb_update(BTB *btb, uint32_t PC, uint32_t target, int is_unconditional);
+
+/* removes the entry that matched PC although PC holds no branch (a partial
+ * tag alias of another branch), so that it does not redirect fetch again */
+void btb_invalidate(BTB *btb, uint32_t PC);
+
+/* returns the number of bits of BTB state */
+uint32_t btb_storage_bits(BTB *btb);
+
+/* registers BTB statistics */
+void btb_register_stats(BTB *btb);
+
+#endif
@@ -4,10 +4,11 @@
 #include <stdint.h>
 
 typedef struct BTB_Entry {
-    uint32_t address;
+    uint32_t tag;
     uint32_t branch_target;
     uint8_t valid;
     uint8_t is_unconditional;
+    uint8_t lru;            /* 0 = MRU (LRU replacement only) */
 } BTB_Entry;
 
 #endif
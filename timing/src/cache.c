@@ -1,9 +1,14 @@
 #include "cache.h"
+#include "config.h"
+#include "shell.h"
+#include "stats.h"
+#include <stdio.h>
 
 void cache_init (Cache *cache, uint16_t num_set, uint16_t num_way) {
     cache->NUM_SET = num_set;
     cache->NUM_WAY = num_way;
     cache->block = (Block**) malloc(num_set * sizeof(Block*));
+    cache->stat_accesses = cache->stat_misses = 0;
 
     for (uint16_t set = 0; set < num_set; ++set) {
         cache->block[set] = (Block*) malloc(num_way * sizeof(Block));
@@ -21,6 +26,18 @@ void cache_init (Cache *cache, uint16_t num_set, uint16_t num_way) {
     }
 }
 
+void cache_register_stats(Cache *cache, const char *name) {
+    char stat_name[64];
+
+    snprintf(stat_name, sizeof(stat_name), "%sAccesses", name);
+    stats_register_counter(stat_name, &cache->stat_accesses, "cache accesses");
+    snprintf(stat_name, sizeof(stat_name), "%sMisses", name);
+    stats_register_counter(stat_name, &cache->stat_misses, "cache misses");
+    snprintf(stat_name, sizeof(stat_name), "%sHitRate", name);
+    stats_register_formula(stat_name, &cache->stat_accesses, &cache->stat_misses,
+                           &cache->stat_accesses, 1.0, "cache hit rate");
+}
+
 void cache_destroy(Cache *cache) {
     for (uint16_t set = 0; set < cache->NUM_SET; ++set) {
         free(cache->block[set]);
@@ -81,3 +98,88 @@ void cache_update_lru_state(Cache *cache, uint16_t set, uint16_t way) {
 
     cache->block[set][way].lru = 0;
 }
+
+void victim_cache_init(Victim_Cache *vc, uint16_t num_entries) {
+    vc->NUM_ENTRIES = num_entries;
+    vc->block = (Block*) calloc(num_entries > 0 ? num_entries : 1, sizeof(Block));
+    for (uint16_t i = 0; i < num_entries; ++i) {
+        vc->block[i].lru = num_entries - 1;
+    }
+}
+
+void victim_cache_destroy(Victim_Cache *vc) {
+    free(vc->block);
+}
+
+uint16_t victim_cache_find(Victim_Cache *vc, uint32_t mem_addr) {
+    uint32_t line = mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE);
+    for (uint16_t i = 0; i < vc->NUM_ENTRIES; ++i) {
+        if (vc->block[i].valid && vc->block[i].tag == line) {
+            return i;
+        }
+    }
+
+    return vc->NUM_ENTRIES;
+}
+
+int victim_cache_insert(Victim_Cache *vc, Block *block, uint32_t line, uint16_t slot, Block *replaced) {
+    if (slot == vc->NUM_ENTRIES) {
+        for (slot = 0; slot < vc->NUM_ENTRIES; ++slot) {
+            if (vc->block[slot].lru == vc->NUM_ENTRIES - 1) {
+                break;
+            }
+        }
+    }
+
+    int was_valid = vc->block[slot].valid;
+    if (was_valid) {
+        *replaced = vc->block[slot];
+    }
+
+    uint8_t lru = vc->block[slot].lru;
+    vc->block[slot] = *block;
+    vc->block[slot].tag = line;
+    vc->block[slot].lru = lru;
+    for (uint16_t i = 0; i < vc->NUM_ENTRIES; ++i) {
+        if (vc->block[i].lru < lru) {
+            vc->block[i].lru++;
+        }
+    }
+    vc->block[slot].lru = 0;
+
+    return was_valid;
+}
+
+uint32_t line_fill_start(Line_Fill *fill, uint32_t mem_addr) {
+    uint64_t start = stat_cycles > fill->done ? stat_cycles : fill->done;
+    int beat_words = sim_config.mem_bus_bytes / WORD_SIZE;
+    int beats = BLOCK_SIZE / beat_words;
+    uint8_t offset = (mem_addr >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1);
+    int critical_beat = sim_config.cache_cwf ? offset / beat_words : 0;
+
+    fill->addr = mem_addr & ~(BLOCK_SIZE * WORD_SIZE - 1);
+    fill->done = start + sim_config.mem_latency + beats - 1;
+    for (uint8_t index = 0; index < BLOCK_SIZE; ++index) {
+        int beat = (index / beat_words - critical_beat + beats) % beats;
+        fill->arrival[index] = sim_config.cache_cwf ? start + sim_config.mem_latency + beat
+                                                    : fill->done;
+    }
+
+    return fill->arrival[offset] - stat_cycles;
+}
+
+uint32_t line_fill_wait(Line_Fill *fill, uint32_t mem_addr) {
+    if ((mem_addr & ~(BLOCK_SIZE * WORD_SIZE - 1)) != fill->addr) {
+        return 0;
+    }
+
+    uint64_t arrival = fill->arrival[(mem_addr >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1)];
+    return arrival > stat_cycles ? arrival - stat_cycles : 0;
+}
+
+void line_fill_cancel(Line_Fill *fill) {
+    for (uint8_t index = 0; index < BLOCK_SIZE; ++index) {
+        fill->arrival[index] = 0;
+    }
+    fill->done = stat_cycles;
+}
@@ -18,17 +18,49 @@
 #define L1D_LOG2_NUM_SETS 8
 #define L1D_MISS_STALL_CYCLE_COUNT 49
 
+/* line fills: cycles until the first bus beat arrives, and bytes per beat */
+#define MEM_LATENCY (L1D_MISS_STALL_CYCLE_COUNT + 1)
+#define MEM_BUS_BYTES (BLOCK_SIZE * WORD_SIZE)
+
+/* L1D victim cache */
+#define VC_SIZE 0       /* disabled by default */
+#define VC_LATENCY 1
+
 typedef struct Cache {
     uint16_t NUM_SET, NUM_WAY;
     Block **block;
+
+    /* statistics, counted by the cache's users (retries are not counted) */
+    uint64_t stat_accesses, stat_misses;
 } Cache;
 
+/* Fully-associative victim cache with LRU replacement. It holds lines
+ * evicted from a cache; the tag of each block is its line address shifted
+ * right by the line size. */
+typedef struct Victim_Cache {
+    uint16_t NUM_ENTRIES;
+    Block *block;
+} Victim_Cache;
+
+/* A line fill from memory. The line arrives in bus beats; with critical-word-
+ * first the beat holding the requested word comes first, and the others
+ * follow in wrap-around order. A cache has one fill in progress at a time. */
+typedef struct Line_Fill {
+    uint32_t addr;                  /* line address */
+    uint64_t arrival[BLOCK_SIZE];   /* cycle in which each word arrives */
+    uint64_t done;                  /* cycle in which the last word arrives */
+} Line_Fill;
+
 /* initialize cache and set all values to 0 in all the blocks */
 void cache_init(Cache *cache, uint16_t num_set, uint16_t num_way);
 
 /* deallocate memory for the cache */
 void cache_destroy(Cache *cache);
 
+/* registers the accesses, misses and hit rate of the cache; name prefixes
+ * every statistic */
+void cache_register_stats(Cache *cache, const char *name);
+
 /* returns the way number for the set and tag value */
 uint16_t cache_get_way(Cache *cache, uint16_t set, uint32_t tag);
 
@@ -42,4 +74,31 @@ uint16_t cache_find_victim(Cache *cache, uint16_t set);
 /* make the specified set and way the MRU block and increase LRU values of others */
 void cache_update_lru_state(Cache *cache, uint16_t set, uint16_t way);
 
+/* allocates a victim cache with all entries invalid */
+void victim_cache_init(Victim_Cache *vc, uint16_t num_entries);
+
+/* deallocate memory for the victim cache */
+void victim_cache_destroy(Victim_Cache *vc);
+
+/* returns the entry holding the line of mem_addr, or NUM_ENTRIES */
+uint16_t victim_cache_find(Victim_Cache *vc, uint32_t mem_addr);
+
+/* inserts an evicted block (with the block's tag replaced by the line
+ * address) in place of the LRU entry, or of the entry given by slot if it is
+ * not NUM_ENTRIES. Returns 1 and copies the replaced block to *replaced if it
+ * was valid. */
+int victim_cache_insert(Victim_Cache *vc, Block *block, uint32_t line, uint16_t slot, Block *replaced);
+
+/* starts filling the line of mem_addr once the previous fill is done, and
+ * returns the cycles until the access can restart: when the requested word
+ * arrives with --cache-cwf, and when the whole line has arrived otherwise */
+uint32_t line_fill_start(Line_Fill *fill, uint32_t mem_addr);
+
+/* returns the cycles until the word at mem_addr arrives, or 0 if it is not
+ * part of the line being filled */
+uint32_t line_fill_wait(Line_Fill *fill, uint32_t mem_addr);
+
+/* drops the fill in progress; its remaining words never arrive */
+void line_fill_cancel(Line_Fill *fill);
+
 #endif
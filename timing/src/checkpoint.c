@@ -0,0 +1,339 @@
+#include "checkpoint.h"
+#include "functional.h"
+#include "pipe.h"
+#include "shell.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define CHECKPOINT_MAGIC "MIPSCKP1"
+#define CHECKPOINT_MAX_REGIONS 8
+#define CHECKPOINT_UARCH 1      /* header flag */
+
+/* regions are aligned for mmap() with pages of up to 64 KB; zero pages are
+ * found at a 4 KB granularity */
+#define CHECKPOINT_ALIGN 65536
+#define CHECKPOINT_PAGE  4096
+
+typedef struct Checkpoint_Region {
+    uint32_t start, size;
+    uint64_t offset;
+} Checkpoint_Region;
+
+typedef struct Checkpoint_Header {
+    char magic[8];
+    uint32_t flags;
+    uint32_t num_regions;
+    uint64_t instructions;
+    uint32_t pc, hi, lo, reserved;
+    uint32_t regs[32];
+    Checkpoint_Region regions[CHECKPOINT_MAX_REGIONS];
+    uint64_t uarch_offset, uarch_size;
+} Checkpoint_Header;
+
+/* the microarchitectural state is saved and restored by the same code */
+typedef struct Checkpoint_IO {
+    FILE *file;
+    int restoring;
+} Checkpoint_IO;
+
+uint64_t checkpoint_instructions;
+
+static void checkpoint_bytes(Checkpoint_IO *io, void *data, size_t size)
+{
+    size_t done = io->restoring ? fread(data, 1, size, io->file) : fwrite(data, 1, size, io->file);
+    if (done != size) {
+        printf("Error: cannot %s checkpoint\n", io->restoring ? "read the" : "write the");
+        exit(-1);
+    }
+}
+
+/* a value that has to be the same on restore */
+static void checkpoint_check(Checkpoint_IO *io, const char *name, uint32_t value)
+{
+    uint32_t saved = value;
+    checkpoint_bytes(io, &saved, sizeof(saved));
+    if (saved != value) {
+        printf("Error: the checkpoint's %s is %u, but the configuration's is %u\n", name, saved,
+               value);
+        exit(-1);
+    }
+}
+
+/* an array whose length has to be the same on restore */
+static void checkpoint_array(Checkpoint_IO *io, const char *name, void *data, uint32_t count,
+                             size_t elem_size)
+{
+    checkpoint_check(io, name, count);
+    if (count > 0)
+        checkpoint_bytes(io, data, count * elem_size);
+}
+
+static void checkpoint_cache(Checkpoint_IO *io, const char *name, Cache *cache)
+{
+    checkpoint_check(io, name, cache->NUM_SET);
+    checkpoint_check(io, name, cache->NUM_WAY);
+    for (uint16_t set = 0; set < cache->NUM_SET; ++set)
+        checkpoint_bytes(io, cache->block[set], cache->NUM_WAY * sizeof(Block));
+}
+
+static void checkpoint_bimodal(Checkpoint_IO *io, Bimodal *bimodal)
+{
+    checkpoint_array(io, "bimodal table", bimodal->counters, bimodal->size, sizeof(uint8_t));
+}
+
+static void checkpoint_gshare(Checkpoint_IO *io, Gshare *gshare)
+{
+    checkpoint_check(io, "gshare history", gshare->history_bits);
+    checkpoint_bytes(io, &gshare->GHR, sizeof(gshare->GHR));
+    checkpoint_array(io, "gshare PHT", gshare->PHT, gshare->pht_size, sizeof(uint8_t));
+}
+
+static void checkpoint_bpred(Checkpoint_IO *io, Branch_Predictor *bp)
+{
+    checkpoint_check(io, "direction predictor", bp->type);
+    switch (bp->type) {
+        case BP_BIMODAL:
+            checkpoint_bimodal(io, &bp->u.bimodal);
+            break;
+
+        case BP_GSHARE:
+            checkpoint_gshare(io, &bp->u.gshare);
+            break;
+
+        case BP_TOURNAMENT:
+            checkpoint_bimodal(io, &bp->u.tournament.bimodal);
+            checkpoint_gshare(io, &bp->u.tournament.gshare);
+            checkpoint_array(io, "chooser", bp->u.tournament.chooser,
+                             bp->u.tournament.chooser_size, sizeof(uint8_t));
+            break;
+
+        case BP_TAGE: {
+            Tage *tage = &bp->u.tage;
+            checkpoint_check(io, "TAGE tables", tage->num_tables);
+            checkpoint_bimodal(io, &tage->base);
+            for (int t = 1; t <= tage->num_tables; ++t) {
+                checkpoint_check(io, "TAGE history", tage->hist_len[t]);
+                checkpoint_array(io, "TAGE table", tage->table[t], 1u << tage->log_entries,
+                                 sizeof(Tage_Entry));
+            }
+            checkpoint_bytes(io, tage->ghist, sizeof(tage->ghist));
+            checkpoint_bytes(io, &tage->ptr, sizeof(tage->ptr));
+            checkpoint_bytes(io, tage->idx_fold, sizeof(tage->idx_fold));
+            checkpoint_bytes(io, tage->tag_fold, sizeof(tage->tag_fold));
+            checkpoint_bytes(io, &tage->use_alt_on_na, sizeof(tage->use_alt_on_na));
+            checkpoint_bytes(io, &tage->tick, sizeof(tage->tick));
+            checkpoint_bytes(io, &tage->seed, sizeof(tage->seed));
+            break;
+        }
+
+        case BP_PERCEPTRON: {
+            Perceptron *perceptron = &bp->u.perceptron;
+            checkpoint_check(io, "perceptron history", perceptron->history_bits);
+            checkpoint_bytes(io, &perceptron->history, sizeof(perceptron->history));
+            checkpoint_array(io, "perceptron table", perceptron->weights,
+                             perceptron->size * (perceptron->history_bits + 1), sizeof(int8_t));
+            break;
+        }
+    }
+}
+
+static void checkpoint_btb_level(Checkpoint_IO *io, BTB_Level *level)
+{
+    checkpoint_check(io, "BTB ways", level->num_ways);
+    checkpoint_check(io, "BTB tag bits", level->tag_bits);
+    checkpoint_array(io, "BTB", level->entries, level->num_sets * level->num_ways,
+                     sizeof(BTB_Entry));
+    checkpoint_array(io, "BTB", level->plru, level->num_sets, sizeof(uint32_t));
+}
+
+static void checkpoint_tlb(Checkpoint_IO *io, TLB *tlb)
+{
+    checkpoint_check(io, "TLB ways", tlb->num_ways);
+    checkpoint_array(io, "TLB", tlb->entries, tlb->num_sets * tlb->num_ways, sizeof(TLB_Entry));
+}
+
+static void checkpoint_uarch(Checkpoint_IO *io)
+{
+    checkpoint_cache(io, "L1I geometry", &pipe.l1i_cache);
+    checkpoint_cache(io, "L1D geometry", &pipe.l1d_cache);
+    checkpoint_array(io, "victim cache", pipe.l1d_victim.block, pipe.l1d_victim.NUM_ENTRIES,
+                     sizeof(Block));
+
+    checkpoint_bpred(io, &pipe.bpred);
+
+    checkpoint_check(io, "BTB L0", pipe.btb.has_l0);
+    if (pipe.btb.has_l0)
+        checkpoint_btb_level(io, &pipe.btb.l0);
+    checkpoint_btb_level(io, &pipe.btb.l1);
+
+    checkpoint_check(io, "RAS depth", pipe.ras.depth);
+    checkpoint_bytes(io, &pipe.ras.tos, sizeof(pipe.ras.tos));
+    checkpoint_bytes(io, &pipe.ras.count, sizeof(pipe.ras.count));
+    checkpoint_array(io, "RAS", pipe.ras.entries, pipe.ras.depth, sizeof(uint32_t));
+
+    checkpoint_tlb(io, &pipe.mmu.itlb);
+    checkpoint_tlb(io, &pipe.mmu.dtlb);
+    checkpoint_tlb(io, &pipe.mmu.l2);
+}
+
+static int page_is_zero(const uint8_t *page, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (page[i])
+            return 0;
+    }
+    return 1;
+}
+
+void checkpoint_save(const char *filename, int uarch)
+{
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        printf("Error: cannot open checkpoint file %s\n", filename);
+        exit(-1);
+    }
+    Checkpoint_IO io = { file, 0 };
+
+    /* memory has to hold the data of dirty lines, which stay cached */
+    functional_clean_dcache();
+
+    Checkpoint_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.instructions = checkpoint_instructions + stat_inst_fast_forward + stat_inst_warm +
+                          stat_inst_retire;
+    header.pc = pipe.PC;
+    header.hi = pipe.HI;
+    header.lo = pipe.LO;
+    memcpy(header.regs, pipe.REGS, sizeof(header.regs));
+    checkpoint_bytes(&io, &header, sizeof(header));
+
+    if (uarch) {
+        header.flags |= CHECKPOINT_UARCH;
+        header.uarch_offset = ftell(file);
+        checkpoint_uarch(&io);
+        header.uarch_size = ftell(file) - header.uarch_offset;
+    }
+
+    /* regions start on page boundaries; zero pages stay holes */
+    uint64_t page = CHECKPOINT_PAGE;
+    uint64_t offset = (ftell(file) + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+    uint32_t start, size;
+    uint8_t *mem;
+    for (int i = 0; (mem = mem_region(i, &start, &size)) != NULL; ++i) {
+        if (i == CHECKPOINT_MAX_REGIONS) {
+            printf("Error: too many memory regions for a checkpoint\n");
+            exit(-1);
+        }
+        header.regions[i].start = start;
+        header.regions[i].size = size;
+        header.regions[i].offset = offset;
+        header.num_regions++;
+        for (uint64_t p = 0; p < size; p += page) {
+            size_t bytes = size - p < page ? size - p : page;
+            if (page_is_zero(mem + p, bytes))
+                continue;
+            fseek(file, offset + p, SEEK_SET);
+            checkpoint_bytes(&io, mem + p, bytes);
+        }
+        offset += (size + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+    }
+
+    /* a zero page at the end still has to be in the file */
+    fseek(file, 0, SEEK_END);
+    if ((uint64_t) ftell(file) < offset) {
+        uint8_t zero = 0;
+        fseek(file, offset - 1, SEEK_SET);
+        checkpoint_bytes(&io, &zero, 1);
+    }
+    fseek(file, 0, SEEK_SET);
+    checkpoint_bytes(&io, &header, sizeof(header));
+    if (fclose(file) != 0) {
+        printf("Error: cannot write checkpoint %s\n", filename);
+        exit(-1);
+    }
+
+    printf("Saved checkpoint %s at instruction %" PRIu64 "%s\n", filename, header.instructions,
+           uarch ? " with microarchitectural state" : "");
+}
+
+void checkpoint_restore(const char *filename)
+{
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        printf("Error: cannot open checkpoint file %s\n", filename);
+        exit(-1);
+    }
+    Checkpoint_Header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.num_regions > CHECKPOINT_MAX_REGIONS) {
+        printf("Error: %s is not a checkpoint\n", filename);
+        exit(-1);
+    }
+
+    /* check everything before any memory is replaced; mapping pages past
+     * the end of the file would fault on their first access */
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        printf("Error: cannot read checkpoint file %s\n", filename);
+        exit(-1);
+    }
+    uint64_t file_size = st.st_size;
+    for (uint32_t i = 0; i < header.num_regions; ++i) {
+        uint32_t start, size;
+        Checkpoint_Region *region = &header.regions[i];
+        if (!mem_region(i, &start, &size) || start != region->start || size != region->size) {
+            printf("Error: the memory regions of %s do not match the simulator's\n", filename);
+            exit(-1);
+        }
+        if (region->offset % CHECKPOINT_ALIGN != 0 || region->offset > file_size ||
+            region->size > file_size - region->offset) {
+            printf("Error: checkpoint %s is truncated or corrupt\n", filename);
+            exit(-1);
+        }
+    }
+    if ((header.flags & CHECKPOINT_UARCH) &&
+        (header.uarch_offset > file_size || header.uarch_size > file_size - header.uarch_offset)) {
+        printf("Error: checkpoint %s is truncated or corrupt\n", filename);
+        exit(-1);
+    }
+
+    for (uint32_t i = 0; i < header.num_regions; ++i) {
+        Checkpoint_Region *region = &header.regions[i];
+        void *mapping = mmap(NULL, region->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                             fileno(file), region->offset);
+        if (mapping == MAP_FAILED) {
+            printf("Error: cannot map checkpoint %s\n", filename);
+            exit(-1);
+        }
+        mem_region_map(i, mapping);
+    }
+
+    pipe.PC = header.pc;
+    pipe.HI = header.hi;
+    pipe.LO = header.lo;
+    memcpy(pipe.REGS, header.regs, sizeof(header.regs));
+    checkpoint_instructions = header.instructions;
+
+    if (header.flags & CHECKPOINT_UARCH) {
+        Checkpoint_IO io = { file, 1 };
+        fseek(file, header.uarch_offset, SEEK_SET);
+        checkpoint_uarch(&io);
+    }
+    fclose(file);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Restored checkpoint %s at instruction %" PRIu64 "%s in %.2f ms\n", filename,
+           header.instructions,
+           header.flags & CHECKPOINT_UARCH ? " with microarchitectural state" : "",
+           (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6);
+}
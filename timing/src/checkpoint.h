@@ -0,0 +1,37 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <stdint.h>
+
+/* Checkpoints of the whole machine state in one binary file. The header
+ * holds the magic "MIPSCKP1", the architectural registers, the number of
+ * instructions executed before the checkpoint, and the offset of every
+ * memory region and of the optional microarchitectural state. Everything
+ * is in the host's byte order.
+ *
+ * The microarchitectural state covers the L1 caches (with their data), the
+ * victim cache, the direction predictor, the BTB, the RAS and the TLBs.
+ * Every table is stored with its size, and a restore with a different
+ * geometry fails. Statistics are not saved, and neither is the 3C miss
+ * classifier. Checkpoints are only taken with the pipeline drained, so no
+ * instructions are in flight.
+ *
+ * Memory regions start on 64 KB boundaries in the file, and all-zero pages
+ * are left as holes. A restore maps the regions copy-on-write (MAP_PRIVATE),
+ * so it takes about a millisecond whatever the memory size, and the file
+ * is never modified. */
+
+/* instructions executed before the restored checkpoint (0 without one) */
+extern uint64_t checkpoint_instructions;
+
+/* writes a checkpoint of the current state, with the microarchitectural
+ * state if uarch is set; the pipeline must be drained (see
+ * pipe_drained()) */
+void checkpoint_save(const char *filename, int uarch);
+
+/* replaces the current state with the checkpoint, including the
+ * microarchitectural state if the file has it; the pipeline must be
+ * drained */
+void checkpoint_restore(const char *filename);
+
+#endif
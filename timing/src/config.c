@@ -0,0 +1,350 @@
+#include "config.h"
+#include "bpred.h"
+#include "pipe.h"
+#include "btb.h"
+#include "frontend.h"
+#include "ras.h"
+#include "store_buffer.h"
+#include "tlb.h"
+#include "profile.h"
+#include "sweep.h"
+#include "simpoint.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Sim_Config sim_config;
+
+/* A run-time parameter. Integer parameters have choices set to NULL. For the
+ * others, the value is the index of the selected choice. String parameters
+ * (such as file names) have value set to NULL and use string instead, and
+ * so do instruction counts, which are 64-bit and use count. */
+typedef struct Config_Option {
+    const char *name;
+    int *value;
+    int default_value;
+    const char **choices;  /* NULL-terminated list of names */
+    const char *help;
+    const char **string;
+    const char *default_string;
+    uint64_t *count;
+} Config_Option;
+
+static const char *core_choices[] = { "inorder", "ooo", NULL };
+static const char *btb_repl_choices[] = { "lru", "plru", NULL };
+static const char *bp_choices[] = { "bimodal", "gshare", "tournament", "tage", "perceptron", NULL };
+static const char *interval_format_choices[] = { "csv", "binary", NULL };
+static const char *sweep_stream_choices[] = { "inst", "data", NULL };
+static const char *simpoint_choices[] = { "off", "profile", "simulate", "verify", NULL };
+static const char *smarts_confidence_choices[] = { "95", "99", "99.7", NULL };
+static const char *profile_sort_choices[] = {
+    "executed", "icache", "dcache", "mispredicts", "stalls", "memstalls", NULL
+};
+
+static Config_Option options[] = {
+    { "core",           &sim_config.core,                 CORE_INORDER, core_choices,
+      "core model" },
+    { "pipe-fetch-stages", &sim_config.pipe_fetch_stages, 1,   NULL,
+      "in-order fetch sub-stages" },
+    { "pipe-decode-stages", &sim_config.pipe_decode_stages, 1, NULL,
+      "in-order decode sub-stages" },
+    { "pipe-execute-stages", &sim_config.pipe_execute_stages, 1, NULL,
+      "in-order execute sub-stages" },
+    { "pipe-mem-stages", &sim_config.pipe_mem_stages,     1,   NULL,
+      "in-order memory sub-stages" },
+    { "mul-latency",    &sim_config.mul_latency,          MULT_LATENCY, NULL,
+      "multiply latency" },
+    { "mul-pipelined",  &sim_config.mul_pipelined,        1,   NULL,
+      "pipelined multiplier (0/1)" },
+    { "div-latency",    &sim_config.div_latency,          DIV_LATENCY, NULL,
+      "divide latency (32-bit dividend)" },
+    { "div-early-out",  &sim_config.div_early_out,        0,   NULL,
+      "divide latency depends on the dividend (0/1)" },
+    { "mem-latency",    &sim_config.mem_latency,          MEM_LATENCY, NULL,
+      "cycles until the first beat of a line fill" },
+    { "mem-bus-bytes",  &sim_config.mem_bus_bytes,        MEM_BUS_BYTES, NULL,
+      "bytes per line fill beat" },
+    { "cache-cwf",      &sim_config.cache_cwf,            0,   NULL,
+      "critical word first with early restart (0/1)" },
+    { "vc-entries",     &sim_config.vc_entries,           VC_SIZE, NULL,
+      "L1D victim cache entries (0 = off)" },
+    { "vc-latency",     &sim_config.vc_latency,           VC_LATENCY, NULL,
+      "victim cache hit latency" },
+    { "l1d-3c",         &sim_config.l1d_3c,               0,   NULL,
+      "classify L1D misses (compulsory/capacity/conflict) (0/1)" },
+    { "itlb-entries",   &sim_config.itlb_entries,         ITLB_SIZE, NULL,
+      "I-TLB entries (0 = no instruction translation)" },
+    { "itlb-ways",      &sim_config.itlb_ways,            L1_TLB_WAYS, NULL,
+      "I-TLB associativity" },
+    { "dtlb-entries",   &sim_config.dtlb_entries,         DTLB_SIZE, NULL,
+      "D-TLB entries (0 = no data translation)" },
+    { "dtlb-ways",      &sim_config.dtlb_ways,            L1_TLB_WAYS, NULL,
+      "D-TLB associativity" },
+    { "l2tlb-entries",  &sim_config.l2tlb_entries,        L2_TLB_SIZE, NULL,
+      "shared L2 TLB entries (0 = none)" },
+    { "l2tlb-ways",     &sim_config.l2tlb_ways,           L2_TLB_WAYS, NULL,
+      "L2 TLB associativity" },
+    { "l2tlb-latency",  &sim_config.l2tlb_latency,        L2_TLB_LATENCY, NULL,
+      "L2 TLB lookup cycles" },
+    { "sb-entries",     &sim_config.sb_entries,           STORE_BUFFER_SIZE, NULL,
+      "in-order store buffer entries (0 = off)" },
+    { "ooo-width",      &sim_config.ooo_width,            4,   NULL,
+      "OoO fetch/dispatch/issue/commit width" },
+    { "ooo-fetch-queue", &sim_config.ooo_fetch_queue_size, 16,  NULL,
+      "OoO fetch queue entries" },
+    { "ooo-rob",        &sim_config.ooo_rob_size,         64,  NULL,
+      "OoO reorder buffer entries" },
+    { "ooo-iq",         &sim_config.ooo_iq_size,          32,  NULL,
+      "OoO issue queue entries" },
+    { "ooo-lsq",        &sim_config.ooo_lsq_size,         32,  NULL,
+      "OoO load/store queue entries" },
+    { "ooo-pregs",      &sim_config.ooo_num_pregs,        128, NULL,
+      "OoO physical registers" },
+    { "bp",             &sim_config.bp,                   BP_GSHARE, bp_choices,
+      "branch direction predictor" },
+    { "bp-bimodal-entries", &sim_config.bp_bimodal_entries, BIMODAL_SIZE, NULL,
+      "bimodal counters (also tournament/TAGE base)" },
+    { "bp-gshare-history", &sim_config.bp_gshare_history, GHR_BITS, NULL,
+      "gshare history bits (also tournament)" },
+    { "bp-gshare-entries", &sim_config.bp_gshare_entries, PHT_SIZE, NULL,
+      "gshare PHT entries (also tournament)" },
+    { "bp-chooser-entries", &sim_config.bp_chooser_entries, CHOOSER_SIZE, NULL,
+      "tournament chooser entries" },
+    { "bp-tage-tables", &sim_config.bp_tage_tables,       TAGE_NUM_TABLES, NULL,
+      "TAGE tagged tables" },
+    { "bp-tage-log-entries", &sim_config.bp_tage_log_entries, TAGE_LOG_ENTRIES, NULL,
+      "log2 of entries per TAGE table" },
+    { "bp-tage-tag-bits", &sim_config.bp_tage_tag_bits,   TAGE_TAG_BITS, NULL,
+      "TAGE tag bits" },
+    { "bp-tage-min-history", &sim_config.bp_tage_min_history, TAGE_MIN_HISTORY, NULL,
+      "shortest TAGE history" },
+    { "bp-tage-max-history", &sim_config.bp_tage_max_history, TAGE_MAX_HISTORY, NULL,
+      "longest TAGE history" },
+    { "bp-perceptron-entries", &sim_config.bp_perceptron_entries, PERCEPTRON_SIZE, NULL,
+      "perceptrons" },
+    { "bp-perceptron-history", &sim_config.bp_perceptron_history, PERCEPTRON_HISTORY, NULL,
+      "perceptron history bits" },
+    { "bp-spec-history", &sim_config.bp_spec_history,    0,   NULL,
+      "update global history at fetch and repair on mispredicts (0/1)" },
+    { "btb-entries",    &sim_config.btb_entries,          BTB_SIZE, NULL,
+      "BTB entries" },
+    { "btb-ways",       &sim_config.btb_ways,             BTB_WAYS, NULL,
+      "BTB associativity" },
+    { "btb-tag-bits",   &sim_config.btb_tag_bits,         BTB_TAG_BITS, NULL,
+      "BTB partial tag bits (0 = full tags)" },
+    { "btb-repl",       &sim_config.btb_repl,             BTB_REPL_LRU, btb_repl_choices,
+      "BTB replacement" },
+    { "btb-l0-entries", &sim_config.btb_l0_entries,       BTB_L0_SIZE, NULL,
+      "fully-associative L0 BTB entries (0 = off)" },
+    { "btb-l1-bubble",  &sim_config.btb_l1_bubble,        BTB_L1_BUBBLE, NULL,
+      "fetch bubble cycles for L1 BTB hits" },
+    { "fe-ftq-size",    &sim_config.fe_ftq_size,          FE_FTQ_SIZE, NULL,
+      "fetch target queue blocks (0 = coupled fetch)" },
+    { "fe-ib-size",     &sim_config.fe_ib_size,           FE_IB_SIZE, NULL,
+      "instruction buffer entries" },
+    { "fe-prefetch",    &sim_config.fe_prefetch,          1,   NULL,
+      "fetch-directed I-cache prefetch (0/1)" },
+    { "ras-depth",      &sim_config.ras_depth,            RAS_DEPTH, NULL,
+      "return address stack entries (0 = off)" },
+    { "interval-cycles", &sim_config.interval_cycles,     0,   NULL,
+      "sample statistics every N cycles (0 = off)" },
+    { "interval-insts", &sim_config.interval_insts,       0,   NULL,
+      "sample statistics every N retired instructions (0 = off)" },
+    { "interval-format", &sim_config.interval_format,     INTERVAL_CSV, interval_format_choices,
+      "interval sample file format" },
+    { "interval-file",  NULL,                             0,   NULL,
+      "interval sample file (default intervals.csv/.bin)",
+      &sim_config.interval_file, "" },
+    { "profile",        &sim_config.profile,              0,   NULL,
+      "per-PC profile report at exit (0/1)" },
+    { "profile-sort",   &sim_config.profile_sort,         PROF_STALL_CYCLES, profile_sort_choices,
+      "profile report order" },
+    { "profile-top",    &sim_config.profile_top,          40,  NULL,
+      "profile report rows (0 = all)" },
+    { "profile-file",   NULL,                             0,   NULL,
+      "profile report file (default stdout)",
+      &sim_config.profile_file, "" },
+    { "fast-forward",   NULL,                             0,   NULL,
+      "instructions executed functionally before simulation",
+      NULL, NULL, &sim_config.fast_forward },
+    { "warmup",         NULL,                             0,   NULL,
+      "then instructions executed functionally to warm caches and predictors",
+      NULL, NULL, &sim_config.warmup },
+    { "measure",        NULL,                             0,   NULL,
+      "then instructions simulated in detail (0 = all)",
+      NULL, NULL, &sim_config.measure },
+    { "simpoint",       &sim_config.simpoint,             SIMPOINT_OFF, simpoint_choices,
+      "SimPoint profiling, simulation of the points, or verification" },
+    { "simpoint-interval", NULL,                          100000, NULL,
+      "instructions per SimPoint interval",
+      NULL, NULL, &sim_config.simpoint_interval },
+    { "simpoint-warmup", NULL,                            100000, NULL,
+      "instructions of functional warming before each SimPoint",
+      NULL, NULL, &sim_config.simpoint_warmup },
+    { "simpoint-max-k", &sim_config.simpoint_max_k,       10,  NULL,
+      "most SimPoint clusters" },
+    { "simpoint-dims",  &sim_config.simpoint_dims,        15,  NULL,
+      "dimensions of the projected basic-block vectors" },
+    { "simpoint-file",  NULL,                             0,   NULL,
+      "simulation points and weights",
+      &sim_config.simpoint_file, "simpoints.txt" },
+    { "simpoint-bbv-file", NULL,                          0,   NULL,
+      "basic-block vectors in SimPoint's .bb format (default none)",
+      &sim_config.simpoint_bbv_file, "" },
+    { "smarts",         &sim_config.smarts,               0,   NULL,
+      "SMARTS systematic sampling with functional warming (0/1)" },
+    { "smarts-unit",    NULL,                             1000, NULL,
+      "instructions measured per SMARTS sample",
+      NULL, NULL, &sim_config.smarts_unit },
+    { "smarts-warmup",  NULL,                             2000, NULL,
+      "instructions of detailed warming before each sample",
+      NULL, NULL, &sim_config.smarts_warmup },
+    { "smarts-period",  NULL,                             100000, NULL,
+      "initial instructions between SMARTS samples",
+      NULL, NULL, &sim_config.smarts_period },
+    { "smarts-error",   &sim_config.smarts_error,         3,   NULL,
+      "target CPI confidence interval (+- percent)" },
+    { "smarts-confidence", &sim_config.smarts_confidence, 2,   smarts_confidence_choices,
+      "confidence level of the interval (percent)" },
+    { "sample-workers", &sim_config.sample_workers,       0,   NULL,
+      "SimPoint/SMARTS samples simulated at once in forked workers (0 = none)" },
+    { "checkpoint-file", NULL,                            0,   NULL,
+      "checkpoint saved where detailed simulation starts (default none)",
+      &sim_config.checkpoint_file, "" },
+    { "checkpoint-uarch", &sim_config.checkpoint_uarch,   1,   NULL,
+      "save caches, predictors, BTB, RAS and TLBs in checkpoints (0/1)" },
+    { "restore",        NULL,                             0,   NULL,
+      "checkpoint to start from (default none; no program file needed)",
+      &sim_config.restore, "" },
+    { "trace-file",     NULL,                             0,   NULL,
+      "binary trace of retired instructions (default none)",
+      &sim_config.trace_file, "" },
+    { "trace-compress", &sim_config.trace_compress,       1,   NULL,
+      "compress trace blocks (0/1)" },
+    { "trace-input",    NULL,                             0,   NULL,
+      "run a trace through the caches and predictor only (default none)",
+      &sim_config.trace_input, "" },
+    { "stack-distance", &sim_config.stack_distance,       0,   NULL,
+      "LRU miss rates of all cache shapes in trace-driven mode (0/1)" },
+    { "stack-distance-sets", &sim_config.stack_distance_sets, 4096, NULL,
+      "largest set count analyzed (a power of two)" },
+    { "stack-distance-ways", &sim_config.stack_distance_ways, 64, NULL,
+      "widest associativity printed" },
+    { "stack-distance-file", NULL,                        0,   NULL,
+      "CSV of the miss rate of every associativity (default none)",
+      &sim_config.stack_distance_file, "" },
+    { "sweep",          &sim_config.sweep,                0,   NULL,
+      "simulate all --sweep-* cache configurations in trace-driven mode (0/1)" },
+    { "sweep-stream",   &sim_config.sweep_stream,         SWEEP_DATA, sweep_stream_choices,
+      "address stream of the sweep" },
+    { "sweep-sets",     NULL,                             0,   NULL,
+      "sweep set counts",
+      &sim_config.sweep_sets, "64,128,256,512" },
+    { "sweep-ways",     NULL,                             0,   NULL,
+      "sweep associativities",
+      &sim_config.sweep_ways, "1,2,4,8" },
+    { "sweep-line",     NULL,                             0,   NULL,
+      "sweep line sizes in bytes",
+      &sim_config.sweep_line, "16,32,64" },
+    { "sweep-policy",   NULL,                             0,   NULL,
+      "sweep replacement policies (lru|fifo|random)",
+      &sim_config.sweep_policy, "lru,fifo,random" },
+    { "sweep-threads",  &sim_config.sweep_threads,        0,   NULL,
+      "sweep threads (0 = one per CPU)" },
+    { NULL, NULL, 0, NULL, NULL }
+};
+
+void config_init()
+{
+    for (Config_Option *opt = options; opt->name; ++opt) {
+        if (opt->string)
+            *opt->string = opt->default_string;
+        else if (opt->count)
+            *opt->count = opt->default_value;
+        else
+            *opt->value = opt->default_value;
+    }
+}
+
+int config_parse_option(const char *option)
+{
+    if (strncmp(option, "--", 2) != 0) {
+        return -1;
+    }
+    option += 2;
+
+    const char *value = strchr(option, '=');
+    if (value == NULL) {
+        return -1;
+    }
+    size_t name_len = value - option;
+    value++;
+
+    for (Config_Option *opt = options; opt->name; ++opt) {
+        if (strlen(opt->name) != name_len || strncmp(opt->name, option, name_len) != 0) {
+            continue;
+        }
+
+        if (opt->string) {
+            *opt->string = value;
+            return 0;
+        }
+
+        if (opt->choices) {
+            for (int i = 0; opt->choices[i]; ++i) {
+                if (strcmp(opt->choices[i], value) == 0) {
+                    *opt->value = i;
+                    return 0;
+                }
+            }
+            return -1;
+        }
+
+        char *end;
+        errno = 0;
+        if (opt->count) {
+            unsigned long long val = strtoull(value, &end, 0);
+            /* strtoull() would silently negate a leading minus sign */
+            if (*value < '0' || *value > '9' || *end != '\0' || errno == ERANGE) {
+                return -1;
+            }
+            *opt->count = val;
+            return 0;
+        }
+
+        long val = strtol(value, &end, 0);
+        if (*value == '\0' || *end != '\0' || errno == ERANGE || val < INT_MIN || val > INT_MAX) {
+            return -1;
+        }
+        *opt->value = (int) val;
+        return 0;
+    }
+
+    return -1;
+}
+
+void config_print()
+{
+    printf("Options:\n");
+    for (Config_Option *opt = options; opt->name; ++opt) {
+        if (opt->string) {
+            printf("  --%-20s %-10s %s\n", opt->name, *opt->string, opt->help);
+        }
+        else if (opt->choices) {
+            printf("  --%-20s %-10s %s (", opt->name, opt->choices[*opt->value], opt->help);
+            for (int i = 0; opt->choices[i]; ++i) {
+                printf("%s%s", i ? "|" : "", opt->choices[i]);
+            }
+            printf(")\n");
+        }
+        else if (opt->count) {
+            printf("  --%-20s %-10" PRIu64 " %s\n", opt->name, *opt->count, opt->help);
+        }
+        else {
+            printf("  --%-20s %-10d %s\n", opt->name, *opt->value, opt->help);
+        }
+    }
+}
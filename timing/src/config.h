@@ -0,0 +1,169 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include <stdint.h>
+
+/* core models */
+#define CORE_INORDER 0
+#define CORE_OOO     1
+
+/* interval sample file formats */
+#define INTERVAL_CSV    0
+#define INTERVAL_BINARY 1
+
+/* Simulator parameters that can be changed at run time. Every parameter has a
+ * command line option of the form --name=value (see config.c). */
+typedef struct Sim_Config {
+    /* core model */
+    int core;
+
+    /* multiply/divide unit */
+    int mul_latency;
+    int mul_pipelined;          /* accepts a new multiply every cycle? */
+    int div_latency;            /* latency for 32-bit dividends */
+    int div_early_out;          /* latency scales with the dividend's significant bits? */
+
+    /* out-of-order core geometry */
+    int ooo_width;            /* fetch/dispatch/issue/commit width */
+    int ooo_fetch_queue_size; /* fetched instructions waiting for dispatch */
+    int ooo_rob_size;         /* reorder buffer entries */
+    int ooo_iq_size;          /* issue queue entries */
+    int ooo_lsq_size;         /* load/store queue entries */
+    int ooo_num_pregs;        /* physical registers (GPRs + HI/LO) */
+
+    /* in-order pipeline depth: cycles spent in each stage */
+    int pipe_fetch_stages;
+    int pipe_decode_stages;
+    int pipe_execute_stages;
+    int pipe_mem_stages;
+
+    /* line fills (both caches) */
+    int mem_latency;            /* cycles until the first bus beat arrives */
+    int mem_bus_bytes;          /* bytes per bus beat */
+    int cache_cwf;              /* critical word first with early restart? */
+
+    /* L1D victim cache and miss classification */
+    int vc_entries;             /* 0 disables the victim cache */
+    int vc_latency;             /* cycles to move a line back into the L1D */
+    int l1d_3c;                 /* classify L1D misses? */
+
+    /* TLBs (0 entries disables translation on that side) */
+    int itlb_entries, itlb_ways;
+    int dtlb_entries, dtlb_ways;
+    int l2tlb_entries, l2tlb_ways;  /* shared; 0 entries = no L2 TLB */
+    int l2tlb_latency;
+
+    /* in-order core store buffer entries (0 disables it) */
+    int sb_entries;
+
+    /* branch direction predictor */
+    int bp;                     /* BP_* in bpred.h */
+    int bp_bimodal_entries;     /* bimodal table (also the tournament/TAGE base) */
+    int bp_gshare_history;      /* gshare GHR bits (also the tournament component) */
+    int bp_gshare_entries;
+    int bp_chooser_entries;     /* tournament chooser */
+    int bp_tage_tables;         /* tagged TAGE tables */
+    int bp_tage_log_entries;    /* log2 of entries per tagged table */
+    int bp_tage_tag_bits;
+    int bp_tage_min_history;
+    int bp_tage_max_history;
+    int bp_perceptron_entries;
+    int bp_perceptron_history;
+    int bp_spec_history;        /* update the global history at fetch? */
+
+    /* branch target buffer */
+    int btb_entries;
+    int btb_ways;
+    int btb_tag_bits;           /* 0 stores full tags */
+    int btb_repl;               /* BTB_REPL_* in btb.h */
+    int btb_l0_entries;         /* fully-associative L0 (0 disables it) */
+    int btb_l1_bubble;          /* fetch bubble on L0 miss, L1 hit */
+
+    /* decoupled front end */
+    int fe_ftq_size;            /* fetch target queue blocks (0 = coupled fetch) */
+    int fe_ib_size;             /* instruction buffer entries */
+    int fe_prefetch;            /* fetch-directed I-cache prefetch? */
+
+    /* return address stack entries (0 disables it) */
+    int ras_depth;
+
+    /* periodic statistics samples (at most one of the periods is set) */
+    int interval_cycles;
+    int interval_insts;
+    int interval_format;        /* INTERVAL_* */
+    const char *interval_file;  /* "" = intervals.csv or intervals.bin */
+
+    /* per-PC profile */
+    int profile;
+    int profile_sort;           /* PROF_* in profile.h */
+    int profile_top;            /* rows reported (0 = all) */
+    const char *profile_file;   /* "" = stdout */
+
+    /* functional fast-forward and warming before detailed simulation, and
+     * the number of instructions simulated in detail (0 = all); after them
+     * the program finishes functionally (instruction counts are 64-bit) */
+    uint64_t fast_forward;
+    uint64_t warmup;
+    uint64_t measure;
+
+    /* SimPoint profiling and simulation (see simpoint.h) */
+    int simpoint;               /* SIMPOINT_* */
+    uint64_t simpoint_interval; /* instructions per interval */
+    uint64_t simpoint_warmup;   /* functional warming before each point */
+    int simpoint_max_k;         /* most clusters tried */
+    int simpoint_dims;          /* random projection dimensions */
+    const char *simpoint_file;
+    const char *simpoint_bbv_file; /* "" = no basic-block vectors */
+
+    /* SMARTS systematic sampling (see smarts.h) */
+    int smarts;
+    uint64_t smarts_unit;       /* instructions measured per sample */
+    uint64_t smarts_warmup;     /* detailed warming before each unit */
+    uint64_t smarts_period;     /* initial instructions between samples */
+    int smarts_error;           /* target confidence interval, +- percent */
+    int smarts_confidence;      /* index into 95, 99, 99.7 percent */
+
+    /* worker processes that simulate SimPoint and SMARTS samples while
+     * the functional core runs ahead (see sample_pool.h; 0 = none) */
+    int sample_workers;
+
+    /* checkpoints (see checkpoint.h) */
+    const char *checkpoint_file;    /* "" = none; saved where detailed simulation starts */
+    int checkpoint_uarch;           /* include the microarchitectural state? */
+    const char *restore;            /* "" = none */
+
+    /* binary instruction trace */
+    const char *trace_file;     /* "" = no trace */
+    int trace_compress;
+    const char *trace_input;    /* "" = run programs; else trace-driven mode */
+
+    /* LRU stack distances in trace-driven mode */
+    int stack_distance;
+    int stack_distance_sets;    /* largest set count */
+    int stack_distance_ways;    /* widest associativity printed */
+    const char *stack_distance_file; /* "" = no CSV */
+
+    /* cache sweep in trace-driven mode (see sweep.h); lists are
+     * comma-separated */
+    int sweep;
+    int sweep_stream;           /* SWEEP_INST or SWEEP_DATA */
+    const char *sweep_sets;
+    const char *sweep_ways;
+    const char *sweep_line;     /* line sizes in bytes */
+    const char *sweep_policy;   /* lru, fifo, random */
+    int sweep_threads;          /* 0 = one per CPU */
+} Sim_Config;
+
+/* global variable -- simulator parameters */
+extern Sim_Config sim_config;
+
+/* sets all parameters to their default values */
+void config_init();
+
+/* parses a "--name=value" option; returns 0 on success and -1 otherwise */
+int config_parse_option(const char *option);
+
+/* prints all parameters along with their current values */
+void config_print();
+
+#endif
@@ -0,0 +1,156 @@
+#include "disasm.h"
+#include "mips.h"
+#include <stdio.h>
+
+static const char *reg_names[32] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+};
+
+static void disassemble_special(uint32_t instr, char *buf, size_t size)
+{
+    const char *rs = reg_names[(instr >> 21) & 0x1F];
+    const char *rt = reg_names[(instr >> 16) & 0x1F];
+    const char *rd = reg_names[(instr >> 11) & 0x1F];
+    int shamt = (instr >> 6) & 0x1F;
+
+    switch (instr & 0x3F) {
+        case SUBOP_SLL:  snprintf(buf, size, "sll %s, %s, %d", rd, rt, shamt); return;
+        case SUBOP_SRL:  snprintf(buf, size, "srl %s, %s, %d", rd, rt, shamt); return;
+        case SUBOP_SRA:  snprintf(buf, size, "sra %s, %s, %d", rd, rt, shamt); return;
+        case SUBOP_SLLV: snprintf(buf, size, "sllv %s, %s, %s", rd, rt, rs); return;
+        case SUBOP_SRLV: snprintf(buf, size, "srlv %s, %s, %s", rd, rt, rs); return;
+        case SUBOP_SRAV: snprintf(buf, size, "srav %s, %s, %s", rd, rt, rs); return;
+        case SUBOP_JR:   snprintf(buf, size, "jr %s", rs); return;
+        case SUBOP_JALR: snprintf(buf, size, "jalr %s, %s", rd, rs); return;
+        case SUBOP_SYSCALL: snprintf(buf, size, "syscall"); return;
+        case SUBOP_MFHI: snprintf(buf, size, "mfhi %s", rd); return;
+        case SUBOP_MTHI: snprintf(buf, size, "mthi %s", rs); return;
+        case SUBOP_MFLO: snprintf(buf, size, "mflo %s", rd); return;
+        case SUBOP_MTLO: snprintf(buf, size, "mtlo %s", rs); return;
+        case SUBOP_MULT:  snprintf(buf, size, "mult %s, %s", rs, rt); return;
+        case SUBOP_MULTU: snprintf(buf, size, "multu %s, %s", rs, rt); return;
+        case SUBOP_DIV:   snprintf(buf, size, "div %s, %s", rs, rt); return;
+        case SUBOP_DIVU:  snprintf(buf, size, "divu %s, %s", rs, rt); return;
+        case SUBOP_ADD:  snprintf(buf, size, "add %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_ADDU: snprintf(buf, size, "addu %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_SUB:  snprintf(buf, size, "sub %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_SUBU: snprintf(buf, size, "subu %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_AND:  snprintf(buf, size, "and %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_OR:   snprintf(buf, size, "or %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_XOR:  snprintf(buf, size, "xor %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_NOR:  snprintf(buf, size, "nor %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_SLT:  snprintf(buf, size, "slt %s, %s, %s", rd, rs, rt); return;
+        case SUBOP_SLTU: snprintf(buf, size, "sltu %s, %s, %s", rd, rs, rt); return;
+    }
+    snprintf(buf, size, ".word 0x%08x", instr);
+}
+
+void mips_disassemble(uint32_t pc, uint32_t instr, char *buf, size_t size)
+{
+    int opcode = instr >> 26;
+    const char *rs = reg_names[(instr >> 21) & 0x1F];
+    const char *rt = reg_names[(instr >> 16) & 0x1F];
+    int32_t imm = (int16_t) (instr & 0xFFFF);
+    uint32_t uimm = instr & 0xFFFF;
+    uint32_t branch_dest = pc + 4 + (imm << 2);
+    uint32_t jump_dest = (pc & 0xF0000000) | ((instr & 0x03FFFFFF) << 2);
+
+    if (instr == 0) {
+        snprintf(buf, size, "nop");
+        return;
+    }
+
+    switch (opcode) {
+        case OP_SPECIAL:
+            disassemble_special(instr, buf, size);
+            return;
+
+        case OP_BRSPEC:
+            switch ((instr >> 16) & 0x1F) {
+                case BROP_BLTZ:   snprintf(buf, size, "bltz %s, 0x%08x", rs, branch_dest); return;
+                case BROP_BGEZ:   snprintf(buf, size, "bgez %s, 0x%08x", rs, branch_dest); return;
+                case BROP_BLTZAL: snprintf(buf, size, "bltzal %s, 0x%08x", rs, branch_dest); return;
+                case BROP_BGEZAL: snprintf(buf, size, "bgezal %s, 0x%08x", rs, branch_dest); return;
+            }
+            break;
+
+        case OP_J:     snprintf(buf, size, "j 0x%08x", jump_dest); return;
+        case OP_JAL:   snprintf(buf, size, "jal 0x%08x", jump_dest); return;
+        case OP_BEQ:   snprintf(buf, size, "beq %s, %s, 0x%08x", rs, rt, branch_dest); return;
+        case OP_BNE:   snprintf(buf, size, "bne %s, %s, 0x%08x", rs, rt, branch_dest); return;
+        case OP_BLEZ:  snprintf(buf, size, "blez %s, 0x%08x", rs, branch_dest); return;
+        case OP_BGTZ:  snprintf(buf, size, "bgtz %s, 0x%08x", rs, branch_dest); return;
+        case OP_ADDI:  snprintf(buf, size, "addi %s, %s, %d", rt, rs, imm); return;
+        case OP_ADDIU: snprintf(buf, size, "addiu %s, %s, %d", rt, rs, imm); return;
+        case OP_SLTI:  snprintf(buf, size, "slti %s, %s, %d", rt, rs, imm); return;
+        case OP_SLTIU: snprintf(buf, size, "sltiu %s, %s, %d", rt, rs, imm); return;
+        case OP_ANDI:  snprintf(buf, size, "andi %s, %s, 0x%x", rt, rs, uimm); return;
+        case OP_ORI:   snprintf(buf, size, "ori %s, %s, 0x%x", rt, rs, uimm); return;
+        case OP_XORI:  snprintf(buf, size, "xori %s, %s, 0x%x", rt, rs, uimm); return;
+        case OP_LUI:   snprintf(buf, size, "lui %s, 0x%x", rt, uimm); return;
+        case OP_LB:    snprintf(buf, size, "lb %s, %d(%s)", rt, imm, rs); return;
+        case OP_LH:    snprintf(buf, size, "lh %s, %d(%s)", rt, imm, rs); return;
+        case OP_LW:    snprintf(buf, size, "lw %s, %d(%s)", rt, imm, rs); return;
+        case OP_LBU:   snprintf(buf, size, "lbu %s, %d(%s)", rt, imm, rs); return;
+        case OP_LHU:   snprintf(buf, size, "lhu %s, %d(%s)", rt, imm, rs); return;
+        case OP_SB:    snprintf(buf, size, "sb %s, %d(%s)", rt, imm, rs); return;
+        case OP_SH:    snprintf(buf, size, "sh %s, %d(%s)", rt, imm, rs); return;
+        case OP_SW:    snprintf(buf, size, "sw %s, %d(%s)", rt, imm, rs); return;
+    }
+    snprintf(buf, size, ".word 0x%08x", instr);
+}
+
+int mips_dest_regs(uint32_t instr, int *regs)
+{
+    int opcode = instr >> 26;
+    int rt = (instr >> 16) & 0x1F;
+    int rd = (instr >> 11) & 0x1F;
+    int n = 0;
+
+    switch (opcode) {
+        case OP_SPECIAL:
+            switch (instr & 0x3F) {
+                case SUBOP_JR:
+                case SUBOP_SYSCALL:
+                    break;
+                case SUBOP_MTHI:
+                    regs[n++] = MIPS_REG_HI;
+                    break;
+                case SUBOP_MTLO:
+                    regs[n++] = MIPS_REG_LO;
+                    break;
+                case SUBOP_MULT:
+                case SUBOP_MULTU:
+                case SUBOP_DIV:
+                case SUBOP_DIVU:
+                    regs[n++] = MIPS_REG_HI;
+                    regs[n++] = MIPS_REG_LO;
+                    break;
+                default:
+                    if (rd != 0)
+                        regs[n++] = rd;
+            }
+            break;
+
+        case OP_BRSPEC:
+            if (rt == BROP_BLTZAL || rt == BROP_BGEZAL)
+                regs[n++] = 31;
+            break;
+
+        case OP_JAL:
+            regs[n++] = 31;
+            break;
+
+        case OP_ADDI: case OP_ADDIU: case OP_SLTI: case OP_SLTIU:
+        case OP_ANDI: case OP_ORI: case OP_XORI: case OP_LUI:
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU:
+            if (rt != 0)
+                regs[n++] = rt;
+            break;
+    }
+
+    return n;
+}
@@ -0,0 +1,19 @@
+#ifndef _DISASM_H_
+#define _DISASM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* writes the assembly text of the instruction at pc into buf, in the syntax
+ * of the test programs (branch and jump targets are absolute addresses) */
+void mips_disassemble(uint32_t pc, uint32_t instr, char *buf, size_t size);
+
+/* HI and LO in the register lists of mips_dest_regs() */
+#define MIPS_REG_HI 32
+#define MIPS_REG_LO 33
+
+/* fills regs with the registers the instruction writes (never $zero) and
+ * returns their number (at most 2) */
+int mips_dest_regs(uint32_t instr, int *regs);
+
+#endif
@@ -0,0 +1,271 @@
+#include "frontend.h"
+#include "config.h"
+#include "shell.h"
+#include "stats.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* global front end state */
+Frontend fe;
+
+#define LINE_MASK (0xffffffff << (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE))
+
+static uint16_t line_set(uint32_t addr)
+{
+    return (addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1I_NUM_SETS - 1);
+}
+
+static uint32_t line_tag(uint32_t addr)
+{
+    return addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1I_LOG2_NUM_SETS);
+}
+
+static int line_present(uint32_t addr)
+{
+    return cache_get_way(&pipe.l1i_cache, line_set(addr), line_tag(addr)) != pipe.l1i_cache.NUM_WAY;
+}
+
+/* the fill delivers the word at critical_addr first with --cache-cwf */
+static void start_fill(uint32_t critical_addr, int is_prefetch)
+{
+    fe.fill_active = 1;
+    fe.fill_is_prefetch = is_prefetch;
+    fe.fill_addr = critical_addr & LINE_MASK;
+    fe.fill_cycles = line_fill_start(&pipe.l1i_fill, critical_addr) - 1;
+}
+
+/* counts down the line fill and installs the line once the access can
+ * restart; later words of the line may still be arriving */
+static void fill_tick()
+{
+    if (!fe.fill_active)
+        return;
+
+    if (fe.fill_cycles > 0) {
+        fe.fill_cycles--;
+        return;
+    }
+
+    uint32_t data[BLOCK_SIZE];
+    for (uint8_t index = 0; index < BLOCK_SIZE; ++index) {
+        data[index] = mem_read_32(fe.fill_addr + (index << LOG2_WORD_SIZE));
+    }
+
+    uint16_t set = line_set(fe.fill_addr);
+    uint16_t way = cache_find_victim(&pipe.l1i_cache, set);
+    cache_insert_data(&pipe.l1i_cache, set, way, line_tag(fe.fill_addr), data);
+    fe.fill_active = 0;
+}
+
+/* I-cache: moves the oldest fetch block into the IB */
+static void fetch_block()
+{
+    if (fe.ftq_count == 0)
+        return;
+
+    FTQ_Entry *e = &fe.ftq[fe.ftq_head];
+    Pipe_Op *next = e->ops[e->fetched];
+
+    /* translate the line address once per block; an I-TLB miss waits for
+     * the walk */
+    if (fe.walk_cycles > 0) {
+        fe.walk_cycles--;
+        next->cpi_stall[CPI_ICACHE]++;
+        return;
+    }
+    if (pipe.mmu.itlb.entries && !e->translated) {
+        e->translated = 1;
+        fe.walk_cycles = mmu_translate(&pipe.mmu, &pipe.mmu.itlb, e->line_addr);
+        if (fe.walk_cycles > 0) {
+            fe.walk_cycles--;
+            next->cpi_stall[CPI_ICACHE]++;
+            return;
+        }
+    }
+
+    uint16_t set = line_set(e->line_addr);
+    uint16_t way = cache_get_way(&pipe.l1i_cache, set, line_tag(e->line_addr));
+
+    if (way == pipe.l1i_cache.NUM_WAY) {
+        if (!fe.fill_active) {
+            start_fill(next->pc, 0);
+            fe.stat_icache_misses++;
+            if (!e->missed) {
+                pipe.l1i_cache.stat_accesses++;
+                pipe.l1i_cache.stat_misses++;
+                profile_count(next->pc, PROF_ICACHE_MISSES, 1);
+                e->missed = 1;
+            }
+        }
+        else if (fe.fill_addr == e->line_addr && fe.fill_is_prefetch) {
+            fe.fill_is_prefetch = 0;
+            fe.stat_late_prefetches++;
+        }
+        fe.stat_icache_wait++;
+        next->cpi_stall[CPI_ICACHE]++;
+        return;
+    }
+
+    /* words of a line that is still being filled arrive one beat at a time */
+    if (line_fill_wait(&pipe.l1i_fill, next->pc) > 0) {
+        fe.stat_icache_wait++;
+        next->cpi_stall[CPI_ICACHE]++;
+        return;
+    }
+
+    if (fe.ib_count == sim_config.fe_ib_size) {
+        fe.stat_ib_full++;
+        return;
+    }
+
+    if (e->fetched == 0 && !e->missed)
+        pipe.l1i_cache.stat_accesses++;
+    cache_update_lru_state(&pipe.l1i_cache, set, way);
+    while (e->fetched < e->count && fe.ib_count < sim_config.fe_ib_size &&
+           line_fill_wait(&pipe.l1i_fill, e->ops[e->fetched]->pc) == 0) {
+        Pipe_Op *op = e->ops[e->fetched++];
+        op->instruction = pipe.l1i_cache.block[set][way].data[(op->pc >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1)];
+
+        fe.ib[(fe.ib_head + fe.ib_count) % sim_config.fe_ib_size] = op;
+        fe.ib_count++;
+        stat_inst_fetch++;
+    }
+
+    if (e->fetched == e->count) {
+        fe.ftq_head = (fe.ftq_head + 1) % sim_config.fe_ftq_size;
+        fe.ftq_count--;
+    }
+}
+
+/* branch predictor: appends the next fetch block to the FTQ */
+static void predict_block()
+{
+    if (pipe.fetch_stopped)
+        return;
+
+    /* if a taken branch was found in the L1 BTB, wait for the bubble */
+    if (pipe.btb_bubble > 0) {
+        pipe.btb_bubble--;
+        pipe.btb.stat_bubble_cycles++;
+        pipe.cpi_pending[CPI_FRONTEND]++;
+        return;
+    }
+
+    if (fe.ftq_count == sim_config.fe_ftq_size) {
+        fe.stat_ftq_full++;
+        return;
+    }
+
+    FTQ_Entry *e = &fe.ftq[(fe.ftq_head + fe.ftq_count) % sim_config.fe_ftq_size];
+    e->line_addr = pipe.PC & LINE_MASK;
+    e->count = 0;
+    e->fetched = 0;
+    e->missed = 0;
+    e->translated = 0;
+    fe.ftq_count++;
+
+    /* the predictor sees the predecoded instruction (its type) before the
+     * I-cache delivers it */
+    Pipe_Op *op;
+    do {
+        op = pipe_alloc_op(pipe.PC, mem_read_32(pipe.PC));
+        e->ops[e->count++] = op;
+        pipe.PC = predict_next_PC(op);
+    } while (e->count < BLOCK_SIZE && pipe.PC == op->pc + 4 &&
+             (pipe.PC & LINE_MASK) == e->line_addr);
+}
+
+/* fetch-directed prefetch: fills the line of the oldest upcoming block that
+ * misses in the I-cache */
+static void prefetch()
+{
+    if (!sim_config.fe_prefetch || fe.fill_active)
+        return;
+
+    for (int i = 1; i < fe.ftq_count; ++i) {
+        uint32_t addr = fe.ftq[(fe.ftq_head + i) % sim_config.fe_ftq_size].line_addr;
+        /* prefetches do not walk the page table */
+        if (pipe.mmu.itlb.entries && !mmu_probe(&pipe.mmu, &pipe.mmu.itlb, addr))
+            return;
+        if (!line_present(addr)) {
+            start_fill(fe.ftq[(fe.ftq_head + i) % sim_config.fe_ftq_size].ops[0]->pc, 1);
+            fe.stat_prefetches++;
+            return;
+        }
+    }
+}
+
+void frontend_init()
+{
+    if (sim_config.fe_ib_size < 1) {
+        printf("Error: fe-ib-size must be at least 1\n");
+        exit(-1);
+    }
+
+    memset(&fe, 0, sizeof(Frontend));
+    fe.ftq = calloc(sim_config.fe_ftq_size, sizeof(FTQ_Entry));
+    fe.ib = calloc(sim_config.fe_ib_size, sizeof(Pipe_Op*));
+}
+
+void frontend_stop()
+{
+    frontend_flush();
+    free(fe.ftq);
+    free(fe.ib);
+    fe.ftq = NULL;
+    fe.ib = NULL;
+}
+
+void frontend_cycle()
+{
+    fill_tick();
+    fetch_block();
+    predict_block();
+    prefetch();
+}
+
+Pipe_Op *frontend_pop()
+{
+    if (fe.ib_count == 0)
+        return NULL;
+
+    Pipe_Op *op = fe.ib[fe.ib_head];
+    fe.ib_head = (fe.ib_head + 1) % sim_config.fe_ib_size;
+    fe.ib_count--;
+
+    return op;
+}
+
+void frontend_flush()
+{
+    while (fe.ftq_count > 0) {
+        FTQ_Entry *e = &fe.ftq[fe.ftq_head];
+        for (int i = e->fetched; i < e->count; ++i) {
+            free(e->ops[i]);
+        }
+        fe.ftq_head = (fe.ftq_head + 1) % sim_config.fe_ftq_size;
+        fe.ftq_count--;
+    }
+
+    while (fe.ib_count > 0) {
+        free(frontend_pop());
+    }
+
+    /* an outstanding line fill completes and is kept as a prefetch */
+}
+
+void frontend_register_stats()
+{
+    stats_register_counter("FTQFullCycles", &fe.stat_ftq_full,
+                           "cycles the predictor waited for FTQ space");
+    stats_register_counter("IBFullCycles", &fe.stat_ib_full,
+                           "cycles the I-cache waited for IB space");
+    stats_register_counter("ICacheMisses", &fe.stat_icache_misses, "demand I-cache misses");
+    stats_register_counter("ICacheWaitCycles", &fe.stat_icache_wait,
+                           "cycles the I-cache waited for a line");
+    stats_register_counter("ICachePrefetches", &fe.stat_prefetches, "I-cache prefetches");
+    stats_register_counter("ICacheLatePrefetches", &fe.stat_late_prefetches,
+                           "demand accesses to a line still being prefetched");
+}
@@ -0,0 +1,70 @@
+#ifndef _FRONTEND_H_
+#define _FRONTEND_H_
+
+#include <stdint.h>
+#include "pipe.h"
+
+#define FE_FTQ_SIZE 0   /* fetch blocks; 0 keeps the coupled fetch stage */
+#define FE_IB_SIZE 8    /* instruction buffer entries */
+
+/* A predicted fetch block: consecutive instructions within one I-cache line,
+ * ending at the end of the line or at a predicted-taken branch. The ops are
+ * created by the predictor and carry its predictions. */
+typedef struct FTQ_Entry {
+    uint32_t line_addr;
+    int count;
+    int fetched;                /* ops already moved to the instruction buffer */
+    int missed;                 /* the line missed in the I-cache? */
+    int translated;             /* the line address went through the I-TLB? */
+    Pipe_Op *ops[BLOCK_SIZE];
+} FTQ_Entry;
+
+/* Decoupled front end. Every cycle the branch predictor appends a fetch block
+ * to the fetch target queue (FTQ), the I-cache reads the line of the oldest
+ * block into the instruction buffer (IB), and the I-cache prefetches the line
+ * of an upcoming block. Decode takes instructions from the IB. */
+typedef struct Frontend {
+    FTQ_Entry *ftq;             /* circular */
+    int ftq_head, ftq_count;
+    Pipe_Op **ib;               /* circular */
+    int ib_head, ib_count;
+
+    /* one I-cache line fill at a time, started by a miss or a prefetch */
+    int fill_active;
+    int fill_is_prefetch;
+    uint32_t fill_addr;
+    int fill_cycles;
+
+    int walk_cycles;            /* I-TLB miss being served */
+
+    /* statistics */
+    uint64_t stat_ftq_full;         /* cycles the predictor waited for FTQ space */
+    uint64_t stat_ib_full;          /* cycles the I-cache waited for IB space */
+    uint64_t stat_icache_misses;    /* demand misses */
+    uint64_t stat_icache_wait;      /* cycles the I-cache waited for a line */
+    uint64_t stat_prefetches;
+    uint64_t stat_late_prefetches;  /* demand accesses to a line still being prefetched */
+} Frontend;
+
+/* global variable -- front end state */
+extern Frontend fe;
+
+/* allocates the FTQ and IB; called from pipe_init() if fe-ftq-size > 0 */
+void frontend_init();
+
+/* frees all ops and structures */
+void frontend_stop();
+
+/* simulates one cycle of the predictor, the I-cache and the prefetcher */
+void frontend_cycle();
+
+/* removes the oldest instruction from the IB; returns NULL if it is empty */
+Pipe_Op *frontend_pop();
+
+/* discards all predicted and fetched instructions (on branch recovery) */
+void frontend_flush();
+
+/* registers front end statistics */
+void frontend_register_stats();
+
+#endif
@@ -0,0 +1,198 @@
+#include "functional.h"
+#include "config.h"
+#include "interval.h"
+#include "mips.h"
+#include "pipe.h"
+#include "shell.h"
+#include "simpoint.h"
+#include <string.h>
+
+uint64_t stat_inst_fast_forward, stat_inst_warm;
+
+void functional_clean_dcache()
+{
+    for (uint16_t set = 0; set < pipe.l1d_cache.NUM_SET; ++set) {
+        for (uint16_t way = 0; way < pipe.l1d_cache.NUM_WAY; ++way)
+            writeback_if_dirty(set, way);
+    }
+    for (uint16_t i = 0; i < pipe.l1d_victim.NUM_ENTRIES; ++i) {
+        Block *block = &pipe.l1d_victim.block[i];
+        if (block->valid && block->dirty) {
+            writeback_line(block->tag, block);
+            block->dirty = 0;
+        }
+    }
+}
+
+/* makes the line of the PC most recently used in the L1I, filling it on a
+ * miss */
+static void functional_warm_icache(uint32_t pc)
+{
+    uint32_t tag = pc >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1I_LOG2_NUM_SETS);
+    uint16_t set = (pc >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1I_NUM_SETS - 1);
+    uint16_t way = cache_get_way(&pipe.l1i_cache, set, tag);
+
+    if (way != pipe.l1i_cache.NUM_WAY) {
+        cache_update_lru_state(&pipe.l1i_cache, set, way);
+        return;
+    }
+
+    uint32_t data[BLOCK_SIZE];
+    uint32_t line_addr = pc & (0xffffffff << (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE));
+    for (uint8_t index = 0; index < BLOCK_SIZE; ++index)
+        data[index] = mem_read_32(line_addr + (index << LOG2_WORD_SIZE));
+    way = cache_find_victim(&pipe.l1i_cache, set);
+    cache_insert_data(&pipe.l1i_cache, set, way, tag, data);
+}
+
+/* makes the line of addr most recently used in the L1D, filling it on a miss.
+ * A line in the victim cache is dropped and filled again from memory, which
+ * holds the same data. */
+static void functional_warm_dcache(uint32_t addr)
+{
+    uint32_t tag = addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t set = (addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint16_t way = cache_get_way(&pipe.l1d_cache, set, tag);
+
+    if (way != pipe.l1d_cache.NUM_WAY) {
+        cache_update_lru_state(&pipe.l1d_cache, set, way);
+        return;
+    }
+
+    uint16_t entry = victim_cache_find(&pipe.l1d_victim, addr);
+    if (entry != pipe.l1d_victim.NUM_ENTRIES)
+        pipe.l1d_victim.block[entry].valid = 0;
+    d_cache_fill(addr);
+}
+
+/* writes a word to memory and to its cached copies */
+static void functional_write(uint32_t addr, uint32_t value)
+{
+    mem_write_32(addr, value);
+
+    uint8_t offset = (addr >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1);
+    uint32_t tag = addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t set = (addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint16_t way = cache_get_way(&pipe.l1d_cache, set, tag);
+    if (way != pipe.l1d_cache.NUM_WAY)
+        pipe.l1d_cache.block[set][way].data[offset] = value;
+
+    uint16_t entry = victim_cache_find(&pipe.l1d_victim, addr);
+    if (entry != pipe.l1d_victim.NUM_ENTRIES)
+        pipe.l1d_victim.block[entry].data[offset] = value;
+}
+
+/* trains the branch predictors with a resolved branch, as fetch and
+ * pipe_update_branch_pred() would after a correct prediction */
+static void functional_warm_branch(Pipe_Op *op)
+{
+    if (op->branch_cond) {
+        Bpred_Info info;
+        bpred_predict(&pipe.bpred, op->pc, &info);
+        bpred_resolve(&pipe.bpred, op->pc, op->branch_taken, &info);
+        if (pipe.bpred.speculative)
+            bpred_update_history(&pipe.bpred, op->branch_taken);
+    }
+
+    if (pipe.ras.depth > 0) {
+        int type = ras_classify(op->instruction);
+        if (type == RAS_RETURN && pipe.ras.count > 0)
+            ras_pop(&pipe.ras);
+        else if (type == RAS_CALL && op->branch_taken)
+            ras_push(&pipe.ras, op->pc + 4);
+    }
+
+    btb_update(&pipe.btb, op->pc, op->branch_dest, !op->branch_cond);
+}
+
+uint64_t functional_run(uint64_t count, int warm)
+{
+    /* warming does not count as predictions */
+    uint64_t cond_branches = pipe.bpred.stat_cond_branches;
+    uint64_t mispredicts = pipe.bpred.stat_mispredicts;
+    uint64_t n;
+
+    if (!RUN_BIT)
+        return 0;
+    functional_clean_dcache();
+
+    for (n = 0; n < count && RUN_BIT; ++n) {
+        Pipe_Op op;
+        memset(&op, 0, sizeof(Pipe_Op));
+        op.reg_src1 = op.reg_src2 = op.reg_dst = -1;
+        op.pc = pipe.PC;
+        op.instruction = mem_read_32(op.pc);
+        if (warm)
+            functional_warm_icache(op.pc);
+
+        pipe_decode_op(&op);
+        if (op.reg_src1 != -1)
+            op.reg_src1_value = pipe.REGS[op.reg_src1];
+        if (op.reg_src2 != -1)
+            op.reg_src2_value = pipe.REGS[op.reg_src2];
+        op.hi_value = pipe.HI;
+        op.lo_value = pipe.LO;
+        pipe_execute_op(&op);
+
+        if (op.is_mem) {
+            uint32_t addr = op.mem_addr & ~3;
+            if (warm)
+                functional_warm_dcache(addr);
+            uint32_t word = mem_read_32(addr);
+            if (op.mem_write)
+                functional_write(addr, pipe_store_merge(&op, word));
+            else
+                op.reg_dst_value = pipe_load_extract(&op, word);
+        }
+
+        if (op.reg_dst > 0)
+            pipe.REGS[op.reg_dst] = op.reg_dst_value;
+        if (op.writes_hi)
+            pipe.HI = op.hi_value;
+        if (op.writes_lo)
+            pipe.LO = op.lo_value;
+
+        if (op.is_branch && warm)
+            functional_warm_branch(&op);
+        pipe.PC = op.is_branch && op.branch_taken ? op.branch_dest : op.pc + 4;
+        if (simpoint_profiling)
+            simpoint_record(op.pc, op.is_branch);
+
+        if (op.opcode == OP_SPECIAL && op.subop == SUBOP_SYSCALL && op.reg_src1_value == 0xA) {
+            RUN_BIT = 0;
+            pipe_stop();
+            n++;
+            break;
+        }
+    }
+
+    pipe.bpred.stat_cond_branches = cond_branches;
+    pipe.bpred.stat_mispredicts = mispredicts;
+    if (warm)
+        stat_inst_warm += n;
+    else
+        stat_inst_fast_forward += n;
+    return n;
+}
+
+void detailed_cycle()
+{
+    pipe_cycle();
+    stat_cycles++;
+    interval_cycle();
+}
+
+void detailed_drain()
+{
+    pipe_stop_fetch();
+    while (RUN_BIT && !pipe_drained())
+        detailed_cycle();
+}
+
+void functional_register_stats()
+{
+    stats_register_counter("FastForwardInstr", &stat_inst_fast_forward,
+                           "instructions executed by functional simulation");
+    stats_register_counter("WarmupInstr", &stat_inst_warm,
+                           "instructions executed by functional simulation with warming");
+}
@@ -0,0 +1,37 @@
+#ifndef _FUNCTIONAL_H_
+#define _FUNCTIONAL_H_
+
+#include <stdint.h>
+
+/* instructions executed by functional simulation, without and with warming */
+extern uint64_t stat_inst_fast_forward, stat_inst_warm;
+
+/* Functional simulation: executes instructions one at a time on the
+ * architectural state of the pipeline (pipe.REGS/HI/LO/PC) and memory, with
+ * the same decode and execute code as the pipeline, and without timing.
+ *
+ * While functional simulation runs, the L1D holds no dirty lines, so memory
+ * is up to date; stores also update the cached copies of their words. */
+
+/* executes up to count instructions, stopping early if the program halts;
+ * with warm set, the instructions also train the L1 caches, the direction
+ * predictor, the BTB and the RAS (but no statistics). Only call while the
+ * pipeline is drained (see pipe_drained()). Returns the instructions
+ * executed. */
+uint64_t functional_run(uint64_t count, int warm);
+
+/* writes back the dirty lines of the L1D and its victim cache, keeping them
+ * as clean copies, so that memory is up to date */
+void functional_clean_dcache();
+
+/* simulates one cycle of the pipeline */
+void detailed_cycle();
+
+/* stops fetch and simulates cycles until the pipeline has drained or the
+ * program has halted, so that functional simulation can take over */
+void detailed_drain();
+
+/* registers the functional instruction counts */
+void functional_register_stats();
+
+#endif
@@ -1,29 +1,64 @@
 #include "gshare.h"
+#include <stdlib.h>
 
-void init_gshare(Gshare *gshare)
+void init_gshare(Gshare *gshare, uint32_t history_bits, uint32_t pht_size)
 {
     gshare->GHR = 0;
+    gshare->history_bits = history_bits;
+    gshare->pht_size = pht_size;
+    gshare->PHT = (uint8_t*) malloc(pht_size * sizeof(uint8_t));
     
-    for (int i = 0; i < PHT_SIZE; ++i) {
+    for (uint32_t i = 0; i < pht_size; ++i) {
         gshare->PHT[i] = 0;
     }
 }
 
+void destroy_gshare(Gshare *gshare)
+{
+    free(gshare->PHT);
+}
+
 uint32_t get_pht_index(Gshare *gshare, uint32_t PC)
 {
-    return ((gshare->GHR) ^ ((PC >> 2) & (PHT_SIZE - 1)));
+    /* histories longer than the index are folded onto it */
+    uint32_t history = gshare->GHR;
+    uint32_t folded = 0;
+    while (history) {
+        folded ^= history & (gshare->pht_size - 1);
+        history = (gshare->pht_size > 1) ? history / gshare->pht_size : 0;
+    }
+
+    return (folded ^ ((PC >> 2) & (gshare->pht_size - 1)));
 }
 
-void update_gshare(Gshare *gshare, uint32_t PC, uint8_t is_taken)
+int predict_gshare(Gshare *gshare, uint32_t PC, Bpred_Info *info)
 {
-    uint32_t pht_index = get_pht_index(gshare, PC);
+    info->index[0] = get_pht_index(gshare, PC);
+    info->history = gshare->GHR;
+    info->taken = gshare->PHT[info->index[0]] > 1;
+
+    return info->taken;
+}
 
+void update_gshare(Gshare *gshare, uint32_t pht_index, uint8_t is_taken)
+{
     if (is_taken) {
         gshare->PHT[pht_index] += (gshare->PHT[pht_index] == 3 ? 0 : 1);
     }
     else {
         gshare->PHT[pht_index] -= (gshare->PHT[pht_index] == 0 ? 0 : 1);
     }
+}
 
+void shift_gshare_history(Gshare *gshare, uint8_t is_taken)
+{
     gshare->GHR = (gshare->GHR << 1) + is_taken;
+    if (gshare->history_bits < 32) {
+        gshare->GHR &= (1u << gshare->history_bits) - 1;
+    }
+}
+
+uint32_t gshare_storage_bits(Gshare *gshare)
+{
+    return gshare->history_bits + 2 * gshare->pht_size;
 }
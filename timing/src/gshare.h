@@ -2,21 +2,37 @@
 #define _GSHARE_H_
 
 #include <stdint.h>
+#include "bpred_info.h"
 
 #define PHT_SIZE 256
+#define GHR_BITS 8
 
 typedef struct Gshare {
-    uint8_t GHR;            /* Global History Register */
-    uint8_t PHT[PHT_SIZE];  /* Pattern History Table */
+    uint32_t GHR;           /* Global History Register */
+    uint32_t history_bits;  /* number of GHR bits used */
+    uint32_t pht_size;      /* number of PHT entries (power of two) */
+    uint8_t *PHT;           /* Pattern History Table */
 } Gshare;
 
-/* initializes all predictor structures to 0 */
-void init_gshare(Gshare *gshare);
+/* allocates the PHT and initializes all predictor structures to 0 */
+void init_gshare(Gshare *gshare, uint32_t history_bits, uint32_t pht_size);
+
+/* frees the PHT */
+void destroy_gshare(Gshare *gshare);
 
 /* returns PHT index for the given PC */
 uint32_t get_pht_index(Gshare *gshare, uint32_t PC);
 
-/* update predictor for the given PC */
-void update_gshare(Gshare *gshare, uint32_t PC, uint8_t is_taken);
+/* returns 1 if the branch at PC is predicted taken */
+int predict_gshare(Gshare *gshare, uint32_t PC, Bpred_Info *info);
+
+/* trains the PHT counter at pht_index */
+void update_gshare(Gshare *gshare, uint32_t pht_index, uint8_t is_taken);
+
+/* shifts a branch outcome into the GHR */
+void shift_gshare_history(Gshare *gshare, uint8_t is_taken);
+
+/* returns the number of bits of predictor state */
+uint32_t gshare_storage_bits(Gshare *gshare);
 
 #endif
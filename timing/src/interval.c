@@ -0,0 +1,157 @@
+#include "interval.h"
+#include "config.h"
+#include "pipe.h"
+#include "shell.h"
+#include "writer.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* fields of a record; all but the first are counted within the interval */
+enum {
+    IV_CYCLE,           /* cycle at the end of the interval */
+    IV_CYCLES,
+    IV_INSTRUCTIONS,
+    IV_L1I_MISSES,
+    IV_L1D_MISSES,
+    IV_MISPREDICTS,     /* conditional branch direction mispredicts */
+    IV_FLUSHES,         /* all branch recoveries */
+    IV_CPI,             /* CPI_NUM_CAUSES stack entries */
+    IV_NUM_FIELDS = IV_CPI + CPI_NUM_CAUSES
+};
+
+static const char *field_names[IV_CPI] = {
+    "cycle", "cycles", "instructions", "l1i_misses", "l1d_misses", "mispredicts", "flushes"
+};
+
+static struct {
+    int active;
+    Buffered_Writer out;
+    const uint64_t *clock;      /* stat_cycles or stat_inst_retire */
+    uint64_t period, next;
+    uint64_t last[IV_NUM_FIELDS];   /* counters at the end of the last interval */
+} interval;
+
+/* reads the running totals of all fields */
+static void interval_read(uint64_t *values, int final)
+{
+    values[IV_CYCLE] = stat_cycles;
+    values[IV_CYCLES] = stat_cycles;
+    values[IV_INSTRUCTIONS] = stat_inst_retire;
+    values[IV_L1I_MISSES] = pipe.l1i_cache.stat_misses;
+    values[IV_L1D_MISSES] = pipe.l1d_cache.stat_misses;
+    values[IV_MISPREDICTS] = pipe.bpred.stat_mispredicts;
+    values[IV_FLUSHES] = stat_squash;
+
+    /* the in-order core attributes stall cycles when an instruction retires,
+     * so a breakdown may lag its interval by the cycles of the instruction in
+     * flight; the last interval takes the rest */
+    if (final)
+        pipe_cpi_stack(&values[IV_CPI]);
+    else
+        memcpy(&values[IV_CPI], pipe.stat_cpi, sizeof(pipe.stat_cpi));
+}
+
+static void interval_write(int final)
+{
+    uint64_t now[IV_NUM_FIELDS], delta[IV_NUM_FIELDS];
+
+    interval_read(now, final);
+    for (int f = 0; f < IV_NUM_FIELDS; ++f)
+        delta[f] = now[f] - interval.last[f];
+    delta[IV_CYCLE] = now[IV_CYCLE];
+    memcpy(interval.last, now, sizeof(now));
+
+    if (sim_config.interval_format == INTERVAL_BINARY) {
+        for (int f = 0; f < IV_NUM_FIELDS; ++f)
+            writer_write_varint(&interval.out, delta[f]);
+        return;
+    }
+
+    writer_printf(&interval.out, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.4f", delta[IV_CYCLE],
+                  delta[IV_CYCLES], delta[IV_INSTRUCTIONS],
+                  delta[IV_CYCLES] ? (double) delta[IV_INSTRUCTIONS] / delta[IV_CYCLES] : 0.0);
+    for (int f = IV_L1I_MISSES; f < IV_NUM_FIELDS; ++f)
+        writer_printf(&interval.out, ",%" PRIu64, delta[f]);
+    writer_printf(&interval.out, "\n");
+}
+
+static void interval_write_header()
+{
+    if (sim_config.interval_format == INTERVAL_BINARY) {
+        writer_write(&interval.out, "MIPSIVL2", 8);
+        writer_write_varint(&interval.out, IV_NUM_FIELDS);
+        for (int f = 0; f < IV_NUM_FIELDS; ++f) {
+            const char *name = f < IV_CPI ? field_names[f] : cpi_cause_names[f - IV_CPI];
+            writer_write(&interval.out, name, strlen(name) + 1);
+        }
+        return;
+    }
+
+    writer_printf(&interval.out, "cycle,cycles,instructions,ipc");
+    for (int f = IV_L1I_MISSES; f < IV_CPI; ++f)
+        writer_printf(&interval.out, ",%s", field_names[f]);
+    for (int c = 0; c < CPI_NUM_CAUSES; ++c)
+        writer_printf(&interval.out, ",cpi_%s", cpi_cause_names[c]);
+    writer_printf(&interval.out, "\n");
+}
+
+void interval_init()
+{
+    if (sim_config.interval_cycles <= 0 && sim_config.interval_insts <= 0)
+        return;
+    if (sim_config.interval_cycles > 0 && sim_config.interval_insts > 0) {
+        printf("Error: --interval-cycles and --interval-insts cannot both be set\n");
+        exit(-1);
+    }
+
+    if (sim_config.interval_cycles > 0) {
+        interval.clock = &stat_cycles;
+        interval.period = sim_config.interval_cycles;
+    }
+    else {
+        interval.clock = &stat_inst_retire;
+        interval.period = sim_config.interval_insts;
+    }
+    interval.next = (*interval.clock / interval.period + 1) * interval.period;
+
+    const char *filename = sim_config.interval_file;
+    if (filename[0] == '\0')
+        filename = sim_config.interval_format == INTERVAL_BINARY ? "intervals.bin"
+                                                                 : "intervals.csv";
+    init_writer(&interval.out, filename, WRITER_BUFFER_SIZE);
+    interval_write_header();
+    interval_read(interval.last, 0);
+    interval.active = 1;
+
+    /* the shell may exit before the program halts */
+    atexit(interval_finish);
+}
+
+void interval_cycle()
+{
+    if (!interval.active)
+        return;
+
+    if (!RUN_BIT) {
+        interval_finish();
+        return;
+    }
+
+    /* an OoO core can retire past a boundary; the next one stays aligned */
+    if (*interval.clock >= interval.next) {
+        interval_write(0);
+        interval.next = (*interval.clock / interval.period + 1) * interval.period;
+    }
+}
+
+void interval_finish()
+{
+    if (!interval.active)
+        return;
+
+    if (stat_cycles > interval.last[IV_CYCLES])
+        interval_write(1);
+    destroy_writer(&interval.out);
+    interval.active = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef _INTERVAL_H_
+#define _INTERVAL_H_
+
+/* Periodic statistics samples. When --interval-cycles or --interval-insts is
+ * set, every period appends one record to the interval file: the cycles,
+ * retired instructions, IPC, L1 misses, branch mispredicts and CPI stack of
+ * that interval. The last record covers the rest of the run.
+ *
+ * The CSV file has a header line. The binary file starts with the magic
+ * "MIPSIVL2", the number of fields and the NUL-terminated field names, followed
+ * by the records; all numbers are varints (see writer_write_varint()), and the
+ * IPC is left out. */
+
+/* opens the interval file if sampling is enabled */
+void interval_init();
+
+/* called at the end of every cycle; writes a record at the end of a period
+ * and closes the file once the simulator halts */
+void interval_cycle();
+
+/* writes the last, partial interval and closes the file */
+void interval_finish();
+
+#endif
@@ -0,0 +1,139 @@
+#include "lz.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH   4
+#define LZ_MAX_OFFSET  65535
+#define LZ_HASH_BITS   14
+
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* writes a length that did not fit in its 4-bit token field */
+static uint8_t *lz_put_length(uint8_t *out, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *out++ = 255;
+    *out++ = (uint8_t) len;
+    return out;
+}
+
+/* writes a sequence: literals, then a match (match_len 0 for the last one) */
+static uint8_t *lz_put_sequence(uint8_t *out, const uint8_t *literals, size_t num_literals,
+                                size_t match_len, size_t offset)
+{
+    uint8_t *token = out++;
+    size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+
+    *token = (uint8_t) ((num_literals < 15 ? num_literals : 15) << 4);
+    if (num_literals >= 15)
+        out = lz_put_length(out, num_literals - 15);
+    memcpy(out, literals, num_literals);
+    out += num_literals;
+
+    if (match_len == 0)
+        return out;
+
+    *out++ = (uint8_t) offset;
+    *out++ = (uint8_t) (offset >> 8);
+    *token |= (uint8_t) (match_code < 15 ? match_code : 15);
+    if (match_code >= 15)
+        out = lz_put_length(out, match_code - 15);
+    return out;
+}
+
+size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst)
+{
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0xFF, sizeof(table));
+
+    uint8_t *out = dst;
+    size_t anchor = 0, i = 0;
+
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t v = lz_read32(src + i);
+        uint32_t h = lz_hash(v);
+        uint32_t candidate = table[h];
+        table[h] = (uint32_t) i;
+
+        if (candidate == 0xFFFFFFFF || i - candidate > LZ_MAX_OFFSET ||
+            lz_read32(src + candidate) != v) {
+            i++;
+            continue;
+        }
+
+        size_t len = LZ_MIN_MATCH;
+        while (i + len < n && src[candidate + len] == src[i + len])
+            len++;
+
+        out = lz_put_sequence(out, src + anchor, i - anchor, len, i - candidate);
+        i += len;
+        anchor = i;
+    }
+
+    out = lz_put_sequence(out, src + anchor, n - anchor, 0, 0);
+    return out - dst;
+}
+
+/* reads a length continued after its token field */
+static int lz_get_length(const uint8_t **in, const uint8_t *end, size_t *len)
+{
+    uint8_t b;
+    do {
+        if (*in >= end)
+            return -1;
+        b = *(*in)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+size_t lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t capacity)
+{
+    const uint8_t *in = src, *end = src + n;
+    uint8_t *out = dst, *out_end = dst + capacity;
+
+    while (in < end) {
+        uint8_t token = *in++;
+
+        size_t num_literals = token >> 4;
+        if (num_literals == 15 && lz_get_length(&in, end, &num_literals))
+            return 0;
+        if (num_literals > (size_t) (end - in) || num_literals > (size_t) (out_end - out))
+            return 0;
+        memcpy(out, in, num_literals);
+        in += num_literals;
+        out += num_literals;
+
+        /* the last sequence has no match */
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return 0;
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        size_t len = token & 15;
+        if (len == 15 && lz_get_length(&in, end, &len))
+            return 0;
+        len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t) (out - dst) || len > (size_t) (out_end - out))
+            return 0;
+
+        /* byte by byte: the copy may overlap its source */
+        const uint8_t *from = out - offset;
+        for (size_t k = 0; k < len; ++k)
+            out[k] = from[k];
+        out += len;
+    }
+
+    return out - dst;
+}
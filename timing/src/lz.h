@@ -0,0 +1,23 @@
+#ifndef _LZ_H_
+#define _LZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Byte-oriented LZ77 block compression in the style of LZ4: a block is a
+ * series of sequences, each a run of literal bytes followed by a copy of up to
+ * 64 KB back. It trades ratio for speed, so that it can run while a trace is
+ * being written. */
+
+/* upper bound of the compressed size of n bytes */
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+/* compresses n bytes of src into dst (of at least LZ_BOUND(n) bytes);
+ * returns the compressed size */
+size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst);
+
+/* decompresses n bytes of src into dst (of capacity bytes); returns the
+ * decompressed size, or 0 if the data is corrupt */
+size_t lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t capacity);
+
+#endif
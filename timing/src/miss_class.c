@@ -0,0 +1,126 @@
+#include "miss_class.h"
+#include "cache.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LINE_BITS (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)
+
+void init_miss_classifier(Miss_Classifier *mc, int num_lines)
+{
+    mc->num_lines = num_lines;
+    mc->lines = (Shadow_Line*) calloc(num_lines, sizeof(Shadow_Line));
+    mc->count = 0;
+    mc->mru = mc->lru = -1;
+
+    uint32_t buckets = 1;
+    while (buckets < 2 * (uint32_t) num_lines)
+        buckets <<= 1;
+    mc->hash = (int*) malloc(buckets * sizeof(int));
+    for (uint32_t i = 0; i < buckets; ++i)
+        mc->hash[i] = -1;
+    mc->hash_mask = buckets - 1;
+
+    mc->touched = (uint8_t*) calloc((1u << (32 - LINE_BITS)) / 8, 1);
+
+    for (int i = 0; i < MISS_CLASSES; ++i)
+        mc->stat_misses[i] = mc->stat_victim_hits[i] = 0;
+}
+
+void destroy_miss_classifier(Miss_Classifier *mc)
+{
+    free(mc->lines);
+    free(mc->hash);
+    free(mc->touched);
+}
+
+static uint32_t bucket(Miss_Classifier *mc, uint32_t line)
+{
+    return (line * 2654435761u) & mc->hash_mask;
+}
+
+static void list_unlink(Miss_Classifier *mc, int n)
+{
+    Shadow_Line *l = &mc->lines[n];
+    if (l->prev != -1) mc->lines[l->prev].next = l->next;
+    else mc->mru = l->next;
+    if (l->next != -1) mc->lines[l->next].prev = l->prev;
+    else mc->lru = l->prev;
+}
+
+static void list_push_mru(Miss_Classifier *mc, int n)
+{
+    mc->lines[n].prev = -1;
+    mc->lines[n].next = mc->mru;
+    if (mc->mru != -1) mc->lines[mc->mru].prev = n;
+    mc->mru = n;
+    if (mc->lru == -1) mc->lru = n;
+}
+
+static void hash_remove(Miss_Classifier *mc, int n)
+{
+    int *link = &mc->hash[bucket(mc, mc->lines[n].line)];
+    while (*link != n)
+        link = &mc->lines[*link].hash_next;
+    *link = mc->lines[n].hash_next;
+}
+
+/* looks up the shadow cache and makes the line MRU; returns 1 on a hit */
+static int shadow_access(Miss_Classifier *mc, uint32_t line)
+{
+    for (int n = mc->hash[bucket(mc, line)]; n != -1; n = mc->lines[n].hash_next) {
+        if (mc->lines[n].line == line) {
+            list_unlink(mc, n);
+            list_push_mru(mc, n);
+            return 1;
+        }
+    }
+
+    /* miss: take a free node or replace the LRU line */
+    int n;
+    if (mc->count < mc->num_lines) {
+        n = mc->count++;
+    }
+    else {
+        n = mc->lru;
+        list_unlink(mc, n);
+        hash_remove(mc, n);
+    }
+
+    mc->lines[n].line = line;
+    mc->lines[n].hash_next = mc->hash[bucket(mc, line)];
+    mc->hash[bucket(mc, line)] = n;
+    list_push_mru(mc, n);
+    return 0;
+}
+
+int miss_classify(Miss_Classifier *mc, uint32_t addr, int miss)
+{
+    uint32_t line = addr >> LINE_BITS;
+    int first_touch = !(mc->touched[line / 8] & (1 << (line % 8)));
+    int shadow_hit = shadow_access(mc, line);
+
+    mc->touched[line / 8] |= 1 << (line % 8);
+    if (!miss)
+        return -1;
+
+    int class = first_touch ? MISS_COMPULSORY : shadow_hit ? MISS_CONFLICT : MISS_CAPACITY;
+    mc->stat_misses[class]++;
+    return class;
+}
+
+void miss_classifier_register_stats(Miss_Classifier *mc, const char *name, int victim_cache)
+{
+    static const char *class_names[MISS_CLASSES] = { "Compulsory", "Capacity", "Conflict" };
+    char stat_name[64];
+
+    for (int i = 0; i < MISS_CLASSES; ++i) {
+        snprintf(stat_name, sizeof(stat_name), "%s%sMisses", name, class_names[i]);
+        stats_register_counter(stat_name, &mc->stat_misses[i], "misses of this class");
+        if (victim_cache) {
+            snprintf(stat_name, sizeof(stat_name), "%s%sVictimHits", name, class_names[i]);
+            stats_register_counter(stat_name, &mc->stat_victim_hits[i],
+                                   "misses of this class served by the victim cache");
+        }
+    }
+}
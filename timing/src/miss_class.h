@@ -0,0 +1,50 @@
+#ifndef _MISS_CLASS_H_
+#define _MISS_CLASS_H_
+
+#include <stdint.h>
+
+/* miss classes */
+#define MISS_COMPULSORY 0   /* first access to the line */
+#define MISS_CAPACITY   1   /* also misses in a fully-associative cache */
+#define MISS_CONFLICT   2   /* hits in a fully-associative cache */
+#define MISS_CLASSES    3
+
+/* A node of the shadow cache: an entry of the LRU list and of a hash chain. */
+typedef struct Shadow_Line {
+    uint32_t line;
+    int prev, next;         /* LRU list, -1 terminated */
+    int hash_next;
+} Shadow_Line;
+
+/* Classifies the misses of a cache into the 3Cs. It keeps a bitmap of the
+ * lines touched so far and a fully-associative LRU shadow cache with the
+ * same number of lines, which sees the same accesses. */
+typedef struct Miss_Classifier {
+    int num_lines;
+    Shadow_Line *lines;
+    int count;
+    int mru, lru;
+    int *hash;              /* chain heads, -1 if empty */
+    uint32_t hash_mask;
+    uint8_t *touched;       /* one bit per line of the address space */
+
+    /* statistics */
+    uint64_t stat_misses[MISS_CLASSES];
+    uint64_t stat_victim_hits[MISS_CLASSES]; /* misses served by a victim cache */
+} Miss_Classifier;
+
+/* allocates a classifier for a cache with num_lines lines */
+void init_miss_classifier(Miss_Classifier *mc, int num_lines);
+
+/* frees the classifier */
+void destroy_miss_classifier(Miss_Classifier *mc);
+
+/* records an access to the line holding addr. Returns the class of the miss
+ * if miss is set, and -1 otherwise. */
+int miss_classify(Miss_Classifier *mc, uint32_t addr, int miss);
+
+/* registers the miss breakdown, including the victim cache hits of each
+ * class if victim_cache is set; name prefixes every statistic */
+void miss_classifier_register_stats(Miss_Classifier *mc, const char *name, int victim_cache);
+
+#endif
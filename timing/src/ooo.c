@@ -0,0 +1,715 @@
+/*
+ * Out-of-order core model
+ *
+ * Ops are fetched with the same I-cache and gshare/BTB front end as the
+ * in-order pipeline, renamed onto a physical register file, and held in a
+ * reorder buffer until they commit in program order. Ready ops are selected
+ * oldest-first from a unified issue queue and computed with pipe_execute_op(),
+ * so results and latencies match pipe_stage_execute(). Loads and stores go
+ * through a load/store queue: loads wait for all older store addresses, take
+ * their value from the youngest older store that covers them, and otherwise
+ * read the D-cache. Stores write the D-cache when they commit.
+ */
+
+#include "ooo.h"
+#include "config.h"
+#include "frontend.h"
+#include "shell.h"
+#include "mips.h"
+#include "profile.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* global out-of-order core state */
+OoO_State ooo;
+
+/* results of the store-to-load forwarding search */
+#define OOO_FWD_NONE 0  /* no older store overlaps; read the cache */
+#define OOO_FWD_HIT  1  /* value taken from an older store */
+#define OOO_FWD_WAIT 2  /* unknown or partially overlapping older store */
+
+static int rob_index(int offset)
+{
+    return (ooo.rob_head + offset) % sim_config.ooo_rob_size;
+}
+
+static int lsq_index(int offset)
+{
+    return (ooo.lsq_head + offset) % sim_config.ooo_lsq_size;
+}
+
+static void free_list_push(int preg)
+{
+    ooo.free_list[(ooo.fl_head + ooo.fl_count) % sim_config.ooo_num_pregs] = preg;
+    ooo.fl_count++;
+}
+
+static int free_list_pop()
+{
+    int preg = ooo.free_list[ooo.fl_head];
+    ooo.fl_head = (ooo.fl_head + 1) % sim_config.ooo_num_pregs;
+    ooo.fl_count--;
+
+    return preg;
+}
+
+void ooo_init()
+{
+    if (sim_config.ooo_width < 1 || sim_config.ooo_fetch_queue_size < 1 ||
+        sim_config.ooo_rob_size < 1 || sim_config.ooo_iq_size < 1 ||
+        sim_config.ooo_lsq_size < 1) {
+        printf("Error: out-of-order core structures need at least one entry\n");
+        exit(-1);
+    }
+    if (sim_config.ooo_num_pregs < OOO_NUM_ARCH_REGS + OOO_MAX_DST) {
+        printf("Error: need at least %d physical registers\n", OOO_NUM_ARCH_REGS + OOO_MAX_DST);
+        exit(-1);
+    }
+
+    memset(&ooo, 0, sizeof(OoO_State));
+
+    ooo.fetch_queue = calloc(sim_config.ooo_fetch_queue_size, sizeof(Pipe_Op*));
+    ooo.preg_value = calloc(sim_config.ooo_num_pregs, sizeof(uint32_t));
+    ooo.preg_ready = calloc(sim_config.ooo_num_pregs, sizeof(uint8_t));
+    ooo.free_list = calloc(sim_config.ooo_num_pregs, sizeof(int));
+    ooo.rob = calloc(sim_config.ooo_rob_size, sizeof(ROB_Entry));
+    ooo.iq = calloc(sim_config.ooo_iq_size, sizeof(IQ_Entry));
+    ooo.lsq = calloc(sim_config.ooo_lsq_size, sizeof(LSQ_Entry));
+
+    /* architectural register i starts out in physical register i; physical
+     * register 0 holds $0 and is never renamed */
+    for (int i = 0; i < OOO_NUM_ARCH_REGS; ++i) {
+        ooo.rat[i] = i;
+        ooo.preg_ready[i] = 1;
+    }
+    for (int i = OOO_NUM_ARCH_REGS; i < sim_config.ooo_num_pregs; ++i) {
+        free_list_push(i);
+    }
+}
+
+void ooo_stop()
+{
+    for (int i = 0; i < ooo.rob_count; ++i) {
+        free(ooo.rob[rob_index(i)].op);
+    }
+    for (int i = 0; i < ooo.fq_count; ++i) {
+        free(ooo.fetch_queue[(ooo.fq_head + i) % sim_config.ooo_fetch_queue_size]);
+    }
+
+    free(ooo.fetch_queue);
+    free(ooo.preg_value);
+    free(ooo.preg_ready);
+    free(ooo.free_list);
+    free(ooo.rob);
+    free(ooo.iq);
+    free(ooo.lsq);
+    ooo.rob_count = ooo.fq_count = ooo.iq_count = ooo.lsq_count = 0;
+}
+
+int ooo_drained()
+{
+    return ooo.rob_count == 0 && ooo.fq_count == 0 && !ooo.dcache_miss;
+}
+
+/* The committed state in pipe.REGS/HI/LO can be changed from the shell while
+ * the core is idle; copy it into the mapped physical registers. */
+static void ooo_sync_arch_state()
+{
+    for (int i = 1; i < 32; ++i) {
+        ooo.preg_value[ooo.rat[i]] = pipe.REGS[i];
+    }
+    ooo.preg_value[ooo.rat[OOO_REG_HI]] = pipe.HI;
+    ooo.preg_value[ooo.rat[OOO_REG_LO]] = pipe.LO;
+}
+
+/* advances an outstanding D-cache refill */
+static void ooo_dcache_tick()
+{
+    ooo.dcache_port_used = 0;
+
+    if (!ooo.dcache_miss)
+        return;
+
+    ooo.stat_dcache_miss_cycles++;
+    if (pipe.mem_stall > 0) {
+        pipe.mem_stall--;
+        return;
+    }
+
+    /* the refill completes now; the waiting access retries this cycle. After
+     * a page walk, the access may still miss in the cache. */
+    d_cache_load(ooo.dcache_miss_addr);
+    if (pipe.is_mem_stalled)
+        return;
+    ooo.dcache_miss = 0;
+    pipe.mem_replay = 1;
+}
+
+/* Reads the word at addr through the D-cache port. Returns 1 on a hit. Returns
+ * 0 if the port is taken this cycle or the access missed, in which case the
+ * access has to be retried. */
+static int ooo_dcache_access(Pipe_Op *op, uint32_t *val)
+{
+    uint32_t addr = op->mem_addr & ~3;
+    if (ooo.dcache_port_used || ooo.dcache_miss)
+        return 0;
+
+    ooo.dcache_port_used = 1;
+    uint64_t misses = pipe.l1d_cache.stat_misses;
+    *val = d_cache_load(addr);
+    profile_count(op->pc, PROF_DCACHE_MISSES, pipe.l1d_cache.stat_misses - misses);
+    if (pipe.is_mem_stalled) {
+        ooo.dcache_miss = 1;
+        ooo.dcache_miss_addr = addr;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void ooo_stage_commit()
+{
+    for (int n = 0; n < sim_config.ooo_width && ooo.rob_count > 0; ++n) {
+        ROB_Entry *e = &ooo.rob[ooo.rob_head];
+        Pipe_Op *op = e->op;
+
+        if (!e->done)
+            return;
+
+        /* stores update the cache in program order */
+        if (op->is_mem && op->mem_write) {
+            uint32_t val;
+            if (!ooo_dcache_access(op, &val))
+                return;
+
+            d_cache_store(op->mem_addr & ~3, pipe_store_merge(op, val));
+        }
+
+        /* update architectural state and release the previous mappings */
+        for (int d = 0; d < OOO_MAX_DST; ++d) {
+            if (e->dst_arch[d] == -1)
+                continue;
+
+            if (e->dst_arch[d] == OOO_REG_HI)
+                pipe.HI = op->hi_value;
+            else if (e->dst_arch[d] == OOO_REG_LO)
+                pipe.LO = op->lo_value;
+            else
+                pipe.REGS[e->dst_arch[d]] = op->reg_dst_value;
+
+            free_list_push(e->old_preg[d]);
+        }
+
+        /* train the predictor in program order; a non-branch predicted
+         * taken hit a partial-tag alias in the BTB */
+        if (op->is_branch)
+            pipe_update_branch_pred(op);
+        else if (op->predicted_branch_taken)
+            btb_invalidate(&pipe.btb, op->pc);
+
+        if (e->lsq_index != -1) {
+            ooo.lsq_head = (ooo.lsq_head + 1) % sim_config.ooo_lsq_size;
+            ooo.lsq_count--;
+        }
+
+        ooo.rob_head = (ooo.rob_head + 1) % sim_config.ooo_rob_size;
+        ooo.rob_count--;
+        stat_inst_retire++;
+        profile_count(op->pc, PROF_EXECUTED, 1);
+        profile_count(op->pc, PROF_STALL_CYCLES, ooo.profile_pending);
+        ooo.profile_pending = 0;
+        if (trace.active)
+            pipe_trace_op(op);
+
+        /* if this was a syscall, perform action */
+        if (op->opcode == OP_SPECIAL && op->subop == SUBOP_SYSCALL &&
+            op->reg_src1_value == 0xA) {
+            pipe.PC = op->pc; /* fetch will do pc += 4, then we stop with correct PC */
+            free(op);
+            RUN_BIT = 0;
+            pipe_stop();  /* close down pipe and free all structures */
+            return;
+        }
+
+        free(op);
+    }
+}
+
+/* marks a physical register ready and wakes up its consumers */
+static void ooo_wakeup(int preg)
+{
+    ooo.preg_ready[preg] = 1;
+
+    for (int i = 0; i < ooo.iq_count; ++i) {
+        ROB_Entry *e = &ooo.rob[ooo.iq[i].rob_index];
+        for (int s = 0; s < OOO_MAX_SRC; ++s) {
+            if (e->src_preg[s] == preg)
+                ooo.iq[i].src_ready[s] = 1;
+        }
+    }
+}
+
+static void ooo_stage_writeback()
+{
+    for (int i = 0; i < ooo.rob_count; ++i) {
+        ROB_Entry *e = &ooo.rob[rob_index(i)];
+        Pipe_Op *op = e->op;
+
+        if (!e->issued || e->done || e->done_cycle > ooo.cycle)
+            continue;
+
+        /* loads are completed by the memory stage */
+        if (op->is_mem && !op->mem_write && !ooo.lsq[e->lsq_index].done)
+            continue;
+
+        e->done = 1;
+        for (int d = 0; d < OOO_MAX_DST; ++d) {
+            if (e->dst_arch[d] == -1)
+                continue;
+
+            if (e->dst_arch[d] == OOO_REG_HI)
+                ooo.preg_value[e->dst_preg[d]] = op->hi_value;
+            else if (e->dst_arch[d] == OOO_REG_LO)
+                ooo.preg_value[e->dst_preg[d]] = op->lo_value;
+            else
+                ooo.preg_value[e->dst_preg[d]] = op->reg_dst_value;
+
+            ooo_wakeup(e->dst_preg[d]);
+        }
+
+        /* schedule recovery for the oldest mispredicted branch */
+        if (pipe_branch_mispredicted(op) &&
+            (!ooo.recover || e->seq < ooo.recover_seq)) {
+            ooo.recover = 1;
+            ooo.recover_seq = e->seq;
+            ooo.recover_dest = op->branch_taken ? op->branch_dest : op->pc + 4;
+            ooo.recover_pc = op->pc;
+            if (pipe.ras.depth > 0)
+                ooo.recover_ras = ras_resolve(&pipe.ras, &op->ras_checkpoint, op->ras_type,
+                                              op->branch_taken, op->pc + 4);
+            if (pipe.bpred.speculative) {
+                ooo.recover_history = op->bpred_history;
+                ooo.recover_outcome = op->branch_cond ? op->branch_taken : -1;
+            }
+        }
+    }
+}
+
+/* looks for older stores that overlap the load in the given LSQ slot */
+static int ooo_load_forward(int offset, Pipe_Op *load, uint32_t *val)
+{
+    uint8_t load_mask = pipe_mem_byte_mask(load);
+
+    for (int i = offset - 1; i >= 0; --i) {
+        LSQ_Entry *s = &ooo.lsq[lsq_index(i)];
+        Pipe_Op *store = ooo.rob[s->rob_index].op;
+
+        if (!store->mem_write)
+            continue;
+        if (!s->addr_ready)
+            return OOO_FWD_WAIT;
+        if ((store->mem_addr & ~3) != (load->mem_addr & ~3))
+            continue;
+
+        uint8_t store_mask = pipe_mem_byte_mask(store);
+        if ((store_mask & load_mask) == 0)
+            continue;
+        if ((load_mask & ~store_mask) != 0)
+            return OOO_FWD_WAIT;  /* partial overlap: wait for the store to commit */
+
+        *val = pipe_store_merge(store, 0);
+        return OOO_FWD_HIT;
+    }
+
+    return OOO_FWD_NONE;
+}
+
+static void ooo_stage_memory()
+{
+    int loads = 0;
+
+    for (int i = 0; i < ooo.lsq_count && loads < sim_config.ooo_width; ++i) {
+        LSQ_Entry *l = &ooo.lsq[lsq_index(i)];
+        ROB_Entry *e = &ooo.rob[l->rob_index];
+        Pipe_Op *op = e->op;
+        uint32_t val;
+
+        if (op->mem_write || !l->addr_ready || l->done)
+            continue;
+
+        int fwd = ooo_load_forward(i, op, &val);
+        if (fwd == OOO_FWD_WAIT) {
+            ooo.stat_load_wait_store++;
+            continue;
+        }
+        if (fwd == OOO_FWD_HIT)
+            ooo.stat_load_forward++;
+        else if (!ooo_dcache_access(op, &val))
+            continue;
+
+        op->reg_dst_value = pipe_load_extract(op, val);
+        op->reg_dst_value_ready = 1;
+        l->done = 1;
+        e->done_cycle = ooo.cycle + 1;
+        loads++;
+    }
+}
+
+static uint32_t ooo_src_value(ROB_Entry *e, int s)
+{
+    return ooo.preg_value[e->src_preg[s]];
+}
+
+static void ooo_stage_issue()
+{
+    int issued = 0, kept = 0;
+
+    /* select the oldest ready ops; the queue is compacted as we go */
+    for (int i = 0; i < ooo.iq_count; ++i) {
+        IQ_Entry *q = &ooo.iq[i];
+        int ready = q->src_ready[0] && q->src_ready[1] && q->src_ready[2];
+
+        if (!ready || issued == sim_config.ooo_width) {
+            ooo.iq[kept++] = *q;
+            continue;
+        }
+
+        ROB_Entry *e = &ooo.rob[q->rob_index];
+        Pipe_Op *op = e->op;
+
+        /* a multiply/divide waits until its unit accepts a new op */
+        if (op->is_muldiv && ooo.cycle < (pipe_is_mul(op) ? ooo.mul_free_cycle :
+                                                            ooo.div_free_cycle)) {
+            pipe.stat_muldiv_busy++;
+            ooo.iq[kept++] = *q;
+            continue;
+        }
+
+        op->reg_src1_value = ooo_src_value(e, 0);
+        op->reg_src2_value = ooo_src_value(e, 1);
+        if (op->reads_hi)
+            op->hi_value = ooo_src_value(e, 2);
+        if (op->reads_lo)
+            op->lo_value = ooo_src_value(e, 2);
+
+        pipe_execute_op(op);
+
+        e->issued = 1;
+        e->done_cycle = ooo.cycle + pipe_op_latency(op);
+        if (op->is_muldiv) {
+            if (pipe_is_mul(op))
+                ooo.mul_free_cycle = ooo.cycle + pipe_muldiv_busy_cycles(op);
+            else
+                ooo.div_free_cycle = ooo.cycle + pipe_muldiv_busy_cycles(op);
+        }
+        if (op->is_mem)
+            ooo.lsq[e->lsq_index].addr_ready = 1;
+
+        issued++;
+    }
+
+    ooo.iq_count = kept;
+}
+
+static int ooo_rename_src(int arch)
+{
+    return (arch <= 0) ? 0 : ooo.rat[arch];
+}
+
+static void ooo_stage_dispatch()
+{
+    for (int n = 0; n < sim_config.ooo_width && ooo.fq_count > 0; ++n) {
+        Pipe_Op *op = ooo.fetch_queue[ooo.fq_head];
+        int num_dst = (op->reg_dst > 0) + op->writes_hi + op->writes_lo;
+
+        /* stall on full structures */
+        if (ooo.rob_count == sim_config.ooo_rob_size) {
+            ooo.stat_rob_full++;
+            return;
+        }
+        if (ooo.iq_count == sim_config.ooo_iq_size) {
+            ooo.stat_iq_full++;
+            return;
+        }
+        if (op->is_mem && ooo.lsq_count == sim_config.ooo_lsq_size) {
+            ooo.stat_lsq_full++;
+            return;
+        }
+        if (ooo.fl_count < num_dst) {
+            ooo.stat_preg_full++;
+            return;
+        }
+
+        ooo.fq_head = (ooo.fq_head + 1) % sim_config.ooo_fetch_queue_size;
+        ooo.fq_count--;
+
+        int index = rob_index(ooo.rob_count);
+        ROB_Entry *e = &ooo.rob[index];
+        memset(e, 0, sizeof(ROB_Entry));
+        e->op = op;
+        e->seq = ooo.next_seq++;
+        ooo.rob_count++;
+        ooo.cpi_after_flush = 0;
+
+        /* rename sources */
+        e->src_preg[0] = ooo_rename_src(op->reg_src1);
+        e->src_preg[1] = ooo_rename_src(op->reg_src2);
+        e->src_preg[2] = op->reads_hi ? ooo.rat[OOO_REG_HI] :
+                         op->reads_lo ? ooo.rat[OOO_REG_LO] : 0;
+
+        /* rename destinations */
+        e->dst_arch[0] = (op->reg_dst > 0) ? op->reg_dst : -1;
+        e->dst_arch[1] = op->writes_hi ? OOO_REG_HI : -1;
+        e->dst_arch[2] = op->writes_lo ? OOO_REG_LO : -1;
+        for (int d = 0; d < OOO_MAX_DST; ++d) {
+            if (e->dst_arch[d] == -1)
+                continue;
+
+            e->dst_preg[d] = free_list_pop();
+            e->old_preg[d] = ooo.rat[e->dst_arch[d]];
+            ooo.rat[e->dst_arch[d]] = e->dst_preg[d];
+            ooo.preg_ready[e->dst_preg[d]] = 0;
+        }
+
+        /* allocate a load/store queue entry */
+        e->lsq_index = -1;
+        if (op->is_mem) {
+            e->lsq_index = lsq_index(ooo.lsq_count);
+            LSQ_Entry *l = &ooo.lsq[e->lsq_index];
+            memset(l, 0, sizeof(LSQ_Entry));
+            l->rob_index = index;
+            l->seq = e->seq;
+            ooo.lsq_count++;
+        }
+
+        /* insert into the issue queue */
+        IQ_Entry *q = &ooo.iq[ooo.iq_count++];
+        q->rob_index = index;
+        q->seq = e->seq;
+        for (int s = 0; s < OOO_MAX_SRC; ++s) {
+            q->src_ready[s] = ooo.preg_ready[e->src_preg[s]];
+        }
+    }
+}
+
+static void ooo_stage_fetch()
+{
+    /* if execution halted, increment PC and return */
+    if (!RUN_BIT) {
+        pipe.PC += 4;
+        return;
+    }
+
+    /* decoupled front end: move up to width instructions from the IB */
+    if (sim_config.fe_ftq_size > 0) {
+        frontend_cycle();
+        for (int n = 0; n < sim_config.ooo_width; ++n) {
+            if (ooo.fq_count == sim_config.ooo_fetch_queue_size)
+                return;
+
+            Pipe_Op *op = frontend_pop();
+            if (op == NULL)
+                return;
+            pipe_decode_op(op);
+
+            int tail = (ooo.fq_head + ooo.fq_count) % sim_config.ooo_fetch_queue_size;
+            ooo.fetch_queue[tail] = op;
+            ooo.fq_count++;
+        }
+        return;
+    }
+
+    if (pipe.fetch_stopped)
+        return;
+
+    /* if an icache miss is in progress, decrement cycles and return */
+    if (pipe.fetch_stall > 0) {
+        pipe.fetch_stall--;
+        return;
+    }
+
+    /* if a taken branch was found in the L1 BTB, wait for the bubble */
+    if (pipe.btb_bubble > 0) {
+        pipe.btb_bubble--;
+        pipe.btb.stat_bubble_cycles++;
+        return;
+    }
+
+    for (int n = 0; n < sim_config.ooo_width; ++n) {
+        if (ooo.fq_count == sim_config.ooo_fetch_queue_size)
+            return;
+
+        uint32_t next_instruction = i_cache_load();
+
+        /* return on cache miss */
+        if (pipe.is_fetch_stalled)
+            return;
+
+        Pipe_Op *op = pipe_alloc_op(pipe.PC, next_instruction);
+        pipe_decode_op(op);
+
+        int tail = (ooo.fq_head + ooo.fq_count) % sim_config.ooo_fetch_queue_size;
+        ooo.fetch_queue[tail] = op;
+        ooo.fq_count++;
+
+        pipe.PC = predict_next_PC(op);
+        stat_inst_fetch++;
+
+        /* a predicted-taken branch ends the fetch group */
+        if (op->predicted_branch_taken)
+            return;
+    }
+}
+
+/* squashes all ops younger than the mispredicted branch and redirects fetch */
+static void ooo_recover()
+{
+    while (ooo.rob_count > 0) {
+        ROB_Entry *e = &ooo.rob[rob_index(ooo.rob_count - 1)];
+        if (e->seq <= ooo.recover_seq)
+            break;
+
+        /* undo renaming, youngest first */
+        for (int d = OOO_MAX_DST - 1; d >= 0; --d) {
+            if (e->dst_arch[d] == -1)
+                continue;
+
+            ooo.rat[e->dst_arch[d]] = e->old_preg[d];
+            free_list_push(e->dst_preg[d]);
+        }
+
+        if (e->lsq_index != -1)
+            ooo.lsq_count--;
+
+        free(e->op);
+        ooo.rob_count--;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < ooo.iq_count; ++i) {
+        if (ooo.iq[i].seq <= ooo.recover_seq)
+            ooo.iq[kept++] = ooo.iq[i];
+    }
+    ooo.iq_count = kept;
+
+    while (ooo.fq_count > 0) {
+        free(ooo.fetch_queue[ooo.fq_head]);
+        ooo.fq_head = (ooo.fq_head + 1) % sim_config.ooo_fetch_queue_size;
+        ooo.fq_count--;
+    }
+
+    // "unstall" the fetch stage on misprediction
+    if (pipe.PC != ooo.recover_dest) {
+        i_cache_abandon_fill();
+        pipe.fetch_stall = 0;
+        pipe.is_fetch_stalled = 0;
+    }
+
+    pipe.PC = ooo.recover_dest;
+    pipe.btb_bubble = 0;
+    if (sim_config.fe_ftq_size > 0)
+        frontend_flush();
+    if (pipe.ras.depth > 0)
+        ras_restore(&pipe.ras, &ooo.recover_ras);
+    if (pipe.bpred.speculative)
+        bpred_repair_history(&pipe.bpred, &ooo.recover_history, ooo.recover_outcome);
+    ooo.recover = 0;
+    ooo.cpi_after_flush = 1;
+    profile_count(ooo.recover_pc, PROF_MISPREDICTS, 1);
+
+    stat_squash++;
+}
+
+/* Returns the cause of the current cycle for the CPI stack. A cycle without
+ * commits is charged to the op at the head of the ROB; its sources were
+ * produced by committed ops, so it never waits for a load. With an empty ROB,
+ * the front end is to blame. */
+static int ooo_cpi_cause(int committed)
+{
+    if (committed)
+        return CPI_BASE;
+
+    if (ooo.rob_count == 0) {
+        if (ooo.cpi_after_flush)
+            return CPI_MISPREDICT;
+        if (pipe.fetch_stall > 0 || pipe.is_fetch_stalled ||
+            (sim_config.fe_ftq_size > 0 && fe.ib_count == 0 &&
+             (fe.fill_active || fe.walk_cycles > 0)))
+            return CPI_ICACHE;
+        return CPI_FRONTEND;
+    }
+
+    Pipe_Op *op = ooo.rob[ooo.rob_head].op;
+    if (op->is_mem && ooo.dcache_miss)
+        return CPI_DCACHE;
+    if (op->is_muldiv)
+        return CPI_MULDIV;
+    return CPI_BASE;
+}
+
+/* charges a cycle without commits to the op at the head of the ROB, or with
+ * an empty ROB, to the next op to commit */
+static void ooo_profile_stall(int cause)
+{
+    if (ooo.rob_count == 0) {
+        ooo.profile_pending++;
+        return;
+    }
+
+    uint32_t pc = ooo.rob[ooo.rob_head].op->pc;
+    profile_count(pc, PROF_STALL_CYCLES, 1);
+    if (cause == CPI_DCACHE)
+        profile_count(pc, PROF_MEM_STALL_CYCLES, 1);
+}
+
+void ooo_cycle()
+{
+    if (ooo.rob_count == 0)
+        ooo_sync_arch_state();
+
+    uint64_t retired = stat_inst_retire;
+    ooo_dcache_tick();
+    ooo_stage_commit();
+    int cause = ooo_cpi_cause(stat_inst_retire != retired);
+    pipe.stat_cpi[cause]++;
+    if (stat_inst_retire == retired && profile.num_words > 0)
+        ooo_profile_stall(cause);
+    stats_sample(ooo.stat_rob_occupancy, ooo.rob_count);
+
+    /* the core shuts down when a syscall halts the program */
+    if (RUN_BIT) {
+        ooo_stage_writeback();
+        ooo_stage_memory();
+        ooo_stage_issue();
+        ooo_stage_dispatch();
+    }
+    ooo_stage_fetch();
+
+    if (ooo.recover && RUN_BIT)
+        ooo_recover();
+
+    ooo.cycle++;
+}
+
+void ooo_register_stats()
+{
+    stats_register_counter("ROBFullStalls", &ooo.stat_rob_full,
+                           "cycles dispatch waited for the ROB");
+    stats_register_counter("IQFullStalls", &ooo.stat_iq_full,
+                           "cycles dispatch waited for the issue queue");
+    stats_register_counter("LSQFullStalls", &ooo.stat_lsq_full,
+                           "cycles dispatch waited for the LSQ");
+    stats_register_counter("PregFullStalls", &ooo.stat_preg_full,
+                           "cycles dispatch waited for a physical register");
+    stats_register_counter("LoadsForwarded", &ooo.stat_load_forward,
+                           "loads served by an older store");
+    stats_register_counter("LoadStoreWaits", &ooo.stat_load_wait_store,
+                           "times a load waited for an older store");
+    stats_register_counter("DCacheMissCycles", &ooo.stat_dcache_miss_cycles,
+                           "cycles with a D-cache refill outstanding");
+    ooo.stat_rob_occupancy = stats_register_histogram("ROBOccupancy", 16,
+                                                      (sim_config.ooo_rob_size + 15) / 16,
+                                                      "ROB entries in use, every cycle");
+}
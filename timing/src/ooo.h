@@ -0,0 +1,120 @@
+#ifndef _OOO_H_
+#define _OOO_H_
+
+#include <stdint.h>
+#include "pipe.h"
+#include "stats.h"
+
+/* renamed architectural registers: 32 GPRs followed by HI and LO */
+#define OOO_NUM_ARCH_REGS 34
+#define OOO_REG_HI 32
+#define OOO_REG_LO 33
+
+/* register operands of an op: two GPR sources plus HI/LO for MFHI/MFLO, and a
+ * GPR destination plus HI/LO for multiplies, divides and MTHI/MTLO */
+#define OOO_MAX_SRC 3
+#define OOO_MAX_DST 3
+
+/* Reorder buffer entry. Holds an op from dispatch until it commits, along with
+ * its renamed registers. */
+typedef struct ROB_Entry {
+    Pipe_Op *op;
+    uint64_t seq;                   /* position in program order */
+
+    int src_preg[OOO_MAX_SRC];      /* physical sources (0 if unused) */
+    int dst_arch[OOO_MAX_DST];      /* architectural destinations, -1 if unused */
+    int dst_preg[OOO_MAX_DST];      /* physical destinations */
+    int old_preg[OOO_MAX_DST];      /* previous mappings, freed on commit */
+
+    int lsq_index;                  /* -1 if not a load/store */
+    int issued, done;
+    uint64_t done_cycle;            /* cycle in which results are written back */
+} ROB_Entry;
+
+/* Issue queue entry. Source ready bits are set by wakeup broadcasts. */
+typedef struct IQ_Entry {
+    int rob_index;
+    uint64_t seq;
+    uint8_t src_ready[OOO_MAX_SRC];
+} IQ_Entry;
+
+/* Load/store queue entry. Entries are allocated in program order. */
+typedef struct LSQ_Entry {
+    int rob_index;
+    uint64_t seq;
+    int addr_ready;                 /* address (and store data) computed? */
+    int done;                       /* load value obtained? */
+} LSQ_Entry;
+
+typedef struct OoO_State {
+    uint64_t cycle;
+    uint64_t next_seq;
+
+    /* fetched and decoded ops waiting for dispatch (circular) */
+    Pipe_Op **fetch_queue;
+    int fq_head, fq_count;
+
+    /* register renaming */
+    int rat[OOO_NUM_ARCH_REGS];     /* register alias table */
+    uint32_t *preg_value;
+    uint8_t *preg_ready;
+    int *free_list;                 /* free physical registers (circular) */
+    int fl_head, fl_count;
+
+    /* reorder buffer (circular) */
+    ROB_Entry *rob;
+    int rob_head, rob_count;
+
+    /* issue queue, oldest first */
+    IQ_Entry *iq;
+    int iq_count;
+
+    /* load/store queue (circular) */
+    LSQ_Entry *lsq;
+    int lsq_head, lsq_count;
+
+    /* single D-cache port; a miss blocks the port until the refill is done */
+    int dcache_port_used;
+    int dcache_miss;
+    uint32_t dcache_miss_addr;
+
+    /* first cycles in which the multiplier and the divider are free */
+    uint64_t mul_free_cycle, div_free_cycle;
+
+    /* branch recovery scheduled for the end of the cycle */
+    int recover;
+    uint64_t recover_seq;
+    uint32_t recover_dest;
+    uint32_t recover_pc;            /* the mispredicted branch */
+    RAS_Checkpoint recover_ras;
+    Bpred_History recover_history;
+    int recover_outcome;
+    int cpi_after_flush;            /* no op dispatched since the last recovery? */
+    uint64_t profile_pending;       /* empty-ROB cycles, charged to the next commit */
+
+    /* statistics */
+    uint64_t stat_rob_full, stat_iq_full, stat_lsq_full, stat_preg_full;
+    uint64_t stat_load_forward, stat_load_wait_store;
+    uint64_t stat_dcache_miss_cycles;
+    Stat_Histogram *stat_rob_occupancy;
+} OoO_State;
+
+/* global variable -- out-of-order core state */
+extern OoO_State ooo;
+
+/* called from pipe_init() when the out-of-order core is selected */
+void ooo_init();
+
+/* simulates one cycle of the out-of-order core */
+void ooo_cycle();
+
+/* frees all structures */
+void ooo_stop();
+
+/* returns 1 if no op is in flight and no D-cache refill is outstanding */
+int ooo_drained();
+
+/* registers out-of-order core statistics */
+void ooo_register_stats();
+
+#endif
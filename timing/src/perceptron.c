@@ -0,0 +1,69 @@
+#include "perceptron.h"
+#include <stdlib.h>
+
+void init_perceptron(Perceptron *perceptron, uint32_t size, uint32_t history_bits)
+{
+    perceptron->size = size;
+    perceptron->history_bits = history_bits;
+    perceptron->threshold = (int32_t) (1.93 * history_bits + 14);
+    perceptron->history = 0;
+    perceptron->weights = (int8_t*) calloc(size * (history_bits + 1), sizeof(int8_t));
+}
+
+void destroy_perceptron(Perceptron *perceptron)
+{
+    free(perceptron->weights);
+}
+
+int predict_perceptron(Perceptron *perceptron, uint32_t PC, Bpred_Info *info)
+{
+    info->index[0] = (PC >> 2) & (perceptron->size - 1);
+    info->history = perceptron->history;
+
+    int8_t *w = &perceptron->weights[info->index[0] * (perceptron->history_bits + 1)];
+    int32_t output = w[0];
+    for (uint32_t i = 0; i < perceptron->history_bits; ++i) {
+        output += ((info->history >> i) & 1) ? w[i + 1] : -w[i + 1];
+    }
+
+    info->output = output;
+    info->taken = output >= 0;
+
+    return info->taken;
+}
+
+static void train_weight(int8_t *weight, int agree)
+{
+    if (agree) {
+        *weight += (*weight == 127 ? 0 : 1);
+    }
+    else {
+        *weight -= (*weight == -128 ? 0 : 1);
+    }
+}
+
+void update_perceptron(Perceptron *perceptron, uint32_t PC, uint8_t is_taken, Bpred_Info *info)
+{
+    int32_t magnitude = info->output < 0 ? -info->output : info->output;
+
+    if (info->taken != is_taken || magnitude <= perceptron->threshold) {
+        int8_t *w = &perceptron->weights[info->index[0] * (perceptron->history_bits + 1)];
+
+        train_weight(&w[0], is_taken);
+        for (uint32_t i = 0; i < perceptron->history_bits; ++i) {
+            train_weight(&w[i + 1], ((info->history >> i) & 1) == is_taken);
+        }
+    }
+}
+
+void shift_perceptron_history(Perceptron *perceptron, uint8_t is_taken)
+{
+    perceptron->history = (perceptron->history << 1) | is_taken;
+    perceptron->history &= (1ull << perceptron->history_bits) - 1;
+}
+
+uint32_t perceptron_storage_bits(Perceptron *perceptron)
+{
+    return perceptron->size * (perceptron->history_bits + 1) * PERCEPTRON_WEIGHT_BITS +
+           perceptron->history_bits;
+}
@@ -0,0 +1,41 @@
+#ifndef _PERCEPTRON_H_
+#define _PERCEPTRON_H_
+
+#include <stdint.h>
+#include "bpred_info.h"
+
+#define PERCEPTRON_SIZE 256
+#define PERCEPTRON_HISTORY 24
+#define PERCEPTRON_MAX_HISTORY 63
+#define PERCEPTRON_WEIGHT_BITS 8
+
+/* A table of perceptrons indexed by PC. Each perceptron has a bias weight and
+ * one weight per global history bit; the sign of the dot product with the
+ * history (taken = +1, not taken = -1) gives the prediction. */
+typedef struct Perceptron {
+    uint32_t size;          /* number of perceptrons (power of two) */
+    uint32_t history_bits;
+    int32_t threshold;      /* training threshold */
+    uint64_t history;       /* global history, newest branch in bit 0 */
+    int8_t *weights;        /* size x (history_bits + 1) weights */
+} Perceptron;
+
+/* allocates the weights and sets them to 0 */
+void init_perceptron(Perceptron *perceptron, uint32_t size, uint32_t history_bits);
+
+/* frees the weights */
+void destroy_perceptron(Perceptron *perceptron);
+
+/* returns 1 if the branch at PC is predicted taken */
+int predict_perceptron(Perceptron *perceptron, uint32_t PC, Bpred_Info *info);
+
+/* trains the perceptron on a misprediction or a low-confidence output */
+void update_perceptron(Perceptron *perceptron, uint32_t PC, uint8_t is_taken, Bpred_Info *info);
+
+/* shifts a branch outcome into the global history */
+void shift_perceptron_history(Perceptron *perceptron, uint8_t is_taken);
+
+/* returns the number of bits of predictor state */
+uint32_t perceptron_storage_bits(Perceptron *perceptron);
+
+#endif
@@ -9,10 +9,16 @@
 #include "pipe.h"
 #include "shell.h"
 #include "mips.h"
+#include "config.h"
+#include "ooo.h"
+#include "frontend.h"
+#include "profile.h"
+#include "trace.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <inttypes.h>
 
 //#define DEBUG
 
@@ -30,6 +36,48 @@ void print_op(Pipe_Op *op)
 /* global pipeline state */
 Pipe_State pipe;
 
+/* registers the statistics of the core and of the structures it uses */
+static void pipe_register_stats()
+{
+    static const char *cpi_names[CPI_NUM_CAUSES] = {
+        "CPIBaseCycles", "CPIICacheCycles", "CPIDCacheCycles", "CPILoadUseCycles",
+        "CPIMulDivCycles", "CPIMispredictCycles", "CPIFrontendCycles"
+    };
+
+    stats_register_counter("HILOStalls", &pipe.stat_hilo_stalls,
+                           "cycles MFHI/MFLO waited for a result");
+    stats_register_counter("MulDivBusyStalls", &pipe.stat_muldiv_busy,
+                           "cycles a multiply/divide waited for its unit");
+    cache_register_stats(&pipe.l1i_cache, "L1I");
+    cache_register_stats(&pipe.l1d_cache, "L1D");
+    pipe.stat_l1d_miss_latency = stats_register_histogram("L1DMissLatency", 16, 8,
+                                                          "cycles until an L1D miss restarts");
+    bpred_register_stats(&pipe.bpred);
+    btb_register_stats(&pipe.btb);
+    if (sim_config.fe_ftq_size > 0)
+        frontend_register_stats();
+    if (pipe.ras.depth > 0)
+        ras_register_stats(&pipe.ras);
+    if (pipe.sb.size > 0)
+        store_buffer_register_stats(&pipe.sb);
+    if (sim_config.vc_entries > 0) {
+        stats_register_constant("VictimCacheEntries", sim_config.vc_entries,
+                                "L1D victim cache lines");
+        stats_register_counter("VCHits", &pipe.stat_vc_hits,
+                               "L1D misses served by the victim cache");
+    }
+    if (sim_config.l1d_3c)
+        miss_classifier_register_stats(&pipe.l1d_3c, "L1D", sim_config.vc_entries > 0);
+    if (sim_config.itlb_entries > 0 || sim_config.dtlb_entries > 0)
+        mmu_register_stats(&pipe.mmu);
+    if (sim_config.core == CORE_OOO)
+        ooo_register_stats();
+
+    /* counted when instructions retire */
+    for (int c = 0; c < CPI_NUM_CAUSES; ++c)
+        stats_register_counter(cpi_names[c], &pipe.stat_cpi[c], "CPI stack cycles");
+}
+
 void pipe_init()
 {
     memset(&pipe, 0, sizeof(Pipe_State));
@@ -47,11 +95,60 @@ void pipe_init()
     pipe.mem_stall = 0;
     pipe.is_mem_stalled = 0;
 
+    if (sim_config.pipe_fetch_stages < 1 || sim_config.pipe_fetch_stages > PIPE_MAX_SUBSTAGES ||
+        sim_config.pipe_decode_stages < 1 || sim_config.pipe_decode_stages > PIPE_MAX_SUBSTAGES ||
+        sim_config.pipe_execute_stages < 1 || sim_config.pipe_execute_stages > PIPE_MAX_SUBSTAGES ||
+        sim_config.pipe_mem_stages < 1 || sim_config.pipe_mem_stages > PIPE_MAX_SUBSTAGES) {
+        printf("Error: every stage needs between 1 and %d sub-stages\n", PIPE_MAX_SUBSTAGES);
+        exit(-1);
+    }
+
+    if (sim_config.mul_latency < 1 || sim_config.div_latency < 1) {
+        printf("Error: multiply and divide latencies must be at least 1\n");
+        exit(-1);
+    }
+
+    if (sim_config.mem_latency < 1 || sim_config.mem_bus_bytes < WORD_SIZE ||
+        sim_config.mem_bus_bytes > BLOCK_SIZE * WORD_SIZE ||
+        (sim_config.mem_bus_bytes & (sim_config.mem_bus_bytes - 1)) != 0) {
+        printf("Error: the memory latency must be at least 1 and the bus width a power of two from %d to %d bytes\n",
+               WORD_SIZE, BLOCK_SIZE * WORD_SIZE);
+        exit(-1);
+    }
+
+    if (sim_config.sb_entries < 0) {
+        printf("Error: the store buffer size cannot be negative\n");
+        exit(-1);
+    }
+    if (sim_config.vc_entries < 0 || sim_config.vc_entries > 256 || sim_config.vc_latency < 1) {
+        printf("Error: the victim cache needs 0 to 256 entries and a latency of at least 1\n");
+        exit(-1);
+    }
+    victim_cache_init(&pipe.l1d_victim, sim_config.vc_entries);
+    if (sim_config.l1d_3c)
+        init_miss_classifier(&pipe.l1d_3c, L1D_NUM_SETS * L1D_NUM_WAYS);
+
+    init_mmu(&pipe.mmu);
+    init_store_buffer(&pipe.sb, sim_config.core == CORE_INORDER ? sim_config.sb_entries : 0);
+
     init_branch_pred();
+
+    if (sim_config.fe_ftq_size > 0)
+        frontend_init();
+
+    if (sim_config.core == CORE_OOO)
+        ooo_init();
+
+    pipe_register_stats();
 }
 
 void pipe_cycle()
 {
+    if (sim_config.core == CORE_OOO) {
+        ooo_cycle();
+        return;
+    }
+
 #ifdef DEBUG
     printf("\n\n----\n\nPIPELINE:\n");
     printf("DCODE: "); print_op(pipe.decode_op);
@@ -62,43 +159,68 @@ void pipe_cycle()
 #endif
 
     pipe_stage_wb();
+    /* a halting syscall has torn down the pipeline; fetch only advances the
+     * PC */
+    if (!RUN_BIT) {
+        pipe_stage_fetch();
+        return;
+    }
     pipe_stage_mem();
+    if (pipe.sb.size > 0)
+        pipe_drain_store_buffer();
     pipe_stage_execute();
     pipe_stage_decode();
     pipe_stage_fetch();
 
     /* handle branch recoveries */
-    if (pipe.branch_recover) {
+    if (pipe.branch_recover && RUN_BIT) {
 #ifdef DEBUG
         printf("branch recovery: new dest %08x flush %d stages\n", pipe.branch_dest, pipe.branch_flush);
 #endif
 
         // "unstall" the fetch stage on misprediction
         if (pipe.PC != pipe.branch_dest) {
+            i_cache_abandon_fill();
             pipe.fetch_stall = 0;
             pipe.is_fetch_stalled = 0;
         }
 
         pipe.PC = pipe.branch_dest;
-
+        pipe.btb_bubble = 0;
+        if (sim_config.fe_ftq_size > 0)
+            frontend_flush();
+        memset(pipe.cpi_pending, 0, sizeof(pipe.cpi_pending));
+        pipe.cpi_after_flush = 1;
+
+        if (pipe.ras.depth > 0)
+            ras_restore(&pipe.ras, &pipe.branch_ras);
+        if (pipe.bpred.speculative)
+            bpred_repair_history(&pipe.bpred, &pipe.branch_history, pipe.branch_outcome);
+
+        /* the input of a stage is flushed along with the sub-stages of the
+         * stage in front of it */
         if (pipe.branch_flush >= 2) {
             if (pipe.decode_op) free(pipe.decode_op);
             pipe.decode_op = NULL;
+            pipe_flush_latches(pipe.fetch_latch, sim_config.pipe_fetch_stages);
         }
 
         if (pipe.branch_flush >= 3) {
             if (pipe.execute_op) free(pipe.execute_op);
             pipe.execute_op = NULL;
+            pipe_flush_latches(pipe.decode_latch, sim_config.pipe_decode_stages);
         }
 
         if (pipe.branch_flush >= 4) {
             if (pipe.mem_op) free(pipe.mem_op);
             pipe.mem_op = NULL;
+            pipe_flush_latches(pipe.execute_latch, sim_config.pipe_execute_stages);
         }
 
         if (pipe.branch_flush >= 5) {
             if (pipe.wb_op) free(pipe.wb_op);
             pipe.wb_op = NULL;
+            pipe_flush_latches(pipe.mem_latch, sim_config.pipe_mem_stages);
         }
 
         pipe.branch_recover = 0;
@@ -109,6 +231,36 @@ void pipe_cycle()
     }
 }
 
+Pipe_Op **pipe_stage_output(Pipe_Op **latches, int stages, Pipe_Op **next)
+{
+    return stages > 1 ? &latches[0] : next;
+}
+
+void pipe_advance_latches(Pipe_Op **latches, int stages, Pipe_Op **next)
+{
+    if (stages <= 1)
+        return;
+
+    if (*next == NULL) {
+        *next = latches[stages - 2];
+        latches[stages - 2] = NULL;
+    }
+    for (int i = stages - 2; i > 0; --i) {
+        if (latches[i] == NULL) {
+            latches[i] = latches[i - 1];
+            latches[i - 1] = NULL;
+        }
+    }
+}
+
+void pipe_flush_latches(Pipe_Op **latches, int stages)
+{
+    for (int i = 0; i < stages - 1; ++i) {
+        if (latches[i]) free(latches[i]);
+        latches[i] = NULL;
+    }
+}
+
 void pipe_recover(int flush, uint32_t dest)
 {
     /* if there is already a recovery scheduled, it must have come from a later
@@ -122,6 +274,126 @@ void pipe_recover(int flush, uint32_t dest)
     pipe.branch_dest = dest;
 }
 
+/* charges a stall cycle to an op for the CPI stack */
+static void pipe_cpi_charge(Pipe_Op *op, int cause)
+{
+    if (op)
+        op->cpi_stall[cause]++;
+}
+
+/* Splits the cycles in which no op retired ahead of op among the causes it
+ * was held up by, back end first. Whatever is left was spent refilling the
+ * pipeline. */
+static void pipe_cpi_attribute(uint64_t *stack, const uint32_t *stall, int after_flush,
+                               uint64_t cycles)
+{
+    static const int order[] = { CPI_DCACHE, CPI_MULDIV, CPI_LOAD_USE, CPI_ICACHE, CPI_FRONTEND };
+
+    for (int i = 0; i < (int) (sizeof(order) / sizeof(order[0])); ++i) {
+        uint64_t n = stall[order[i]] < cycles ? stall[order[i]] : cycles;
+        stack[order[i]] += n;
+        cycles -= n;
+    }
+    stack[after_flush ? CPI_MISPREDICT : CPI_FRONTEND] += cycles;
+}
+
+void pipe_cpi_retire(Pipe_Op *op)
+{
+    if (stat_cycles < pipe.cpi_next_cycle)
+        return;
+
+    uint64_t cycles = stat_cycles - pipe.cpi_next_cycle;
+    uint64_t dcache = pipe.stat_cpi[CPI_DCACHE];
+    pipe_cpi_attribute(pipe.stat_cpi, op->cpi_stall, op->cpi_after_flush, cycles);
+    pipe.stat_cpi[CPI_BASE]++;
+    profile_count(op->pc, PROF_STALL_CYCLES, cycles);
+    profile_count(op->pc, PROF_MEM_STALL_CYCLES, pipe.stat_cpi[CPI_DCACHE] - dcache);
+    pipe.cpi_next_cycle = stat_cycles + 1;
+}
+
+/* returns the oldest op in the in-order pipeline, or NULL */
+static Pipe_Op *pipe_oldest_op()
+{
+    struct { Pipe_Op **latches; int stages; Pipe_Op *input; } stages[] = {
+        { pipe.mem_latch,     sim_config.pipe_mem_stages,     pipe.mem_op },
+        { pipe.execute_latch, sim_config.pipe_execute_stages, pipe.execute_op },
+        { pipe.decode_latch,  sim_config.pipe_decode_stages,  pipe.decode_op },
+        { pipe.fetch_latch,   sim_config.pipe_fetch_stages,   NULL },
+    };
+
+    if (pipe.wb_op)
+        return pipe.wb_op;
+    for (int s = 0; s < 4; ++s) {
+        for (int i = stages[s].stages - 2; i >= 0; --i) {
+            if (stages[s].latches[i])
+                return stages[s].latches[i];
+        }
+        if (stages[s].input)
+            return stages[s].input;
+    }
+    return NULL;
+}
+
+void pipe_cpi_stack(uint64_t *stack)
+{
+    memcpy(stack, pipe.stat_cpi, sizeof(pipe.stat_cpi));
+    if (sim_config.core == CORE_OOO || stat_cycles <= pipe.cpi_next_cycle)
+        return;
+
+    /* the cycles since the last retirement are charged to the op that will
+     * retire next, as far as it is known */
+    Pipe_Op *op = RUN_BIT ? pipe_oldest_op() : NULL;
+    if (op)
+        pipe_cpi_attribute(stack, op->cpi_stall, op->cpi_after_flush,
+                           stat_cycles - pipe.cpi_next_cycle);
+    else
+        pipe_cpi_attribute(stack, pipe.cpi_pending, pipe.cpi_after_flush,
+                           stat_cycles - pipe.cpi_next_cycle);
+}
+
+const char *cpi_cause_names[CPI_NUM_CAUSES] = {
+    "base", "icache", "dcache", "loaduse", "muldiv", "mispredict", "frontend"
+};
+
+void pipe_cpi_print()
+{
+    uint64_t stack[CPI_NUM_CAUSES];
+    pipe_cpi_stack(stack);
+
+    printf("cycles,instructions");
+    for (int c = 0; c < CPI_NUM_CAUSES; ++c)
+        printf(",%s", cpi_cause_names[c]);
+    printf("\n%" PRIu64 ",%" PRIu64, stat_cycles, stat_inst_retire);
+    for (int c = 0; c < CPI_NUM_CAUSES; ++c)
+        printf(",%" PRIu64, stack[c]);
+    printf("\n");
+}
+
+void pipe_trace_op(Pipe_Op *op)
+{
+    Trace_Record record;
+
+    record.pc = op->pc;
+    record.instruction = op->instruction;
+    record.num_reg_writes = 0;
+    if (op->reg_dst > 0) {
+        record.reg[record.num_reg_writes] = op->reg_dst;
+        record.value[record.num_reg_writes++] = op->reg_dst_value;
+    }
+    if (op->writes_hi) {
+        record.reg[record.num_reg_writes] = TRACE_REG_HI;
+        record.value[record.num_reg_writes++] = op->hi_value;
+    }
+    if (op->writes_lo) {
+        record.reg[record.num_reg_writes] = TRACE_REG_LO;
+        record.value[record.num_reg_writes++] = op->lo_value;
+    }
+    record.mem = !op->is_mem ? TRACE_MEM_NONE : op->mem_write ? TRACE_MEM_STORE : TRACE_MEM_LOAD;
+    record.mem_addr = op->mem_addr;
+
+    trace_write(&record);
+}
+
 void pipe_stage_wb()
 {
     /* if there is no instruction in this pipeline stage, we are done */
@@ -140,6 +412,9 @@ void pipe_stage_wb()
 #endif
     }
 
+    if (trace.active)
+        pipe_trace_op(op);
+
     /* if this was a syscall, perform action */
     if (op->opcode == OP_SPECIAL && op->subop == SUBOP_SYSCALL) {
         if (op->reg_src1_value == 0xA) {
@@ -149,22 +424,41 @@ void pipe_stage_wb()
         }
     }
 
+    pipe_cpi_retire(op);
+    profile_count(op->pc, PROF_EXECUTED, 1);
+
     /* free the op */
     free(op);
 
     stat_inst_retire++;
 }
 
+/* reads the word at the op's address through the L1D, charging any miss to
+ * the op's PC */
+static uint32_t pipe_dcache_read(Pipe_Op *op)
+{
+    uint64_t misses = pipe.l1d_cache.stat_misses;
+    uint32_t val = d_cache_load(op->mem_addr);
+    profile_count(op->pc, PROF_DCACHE_MISSES, pipe.l1d_cache.stat_misses - misses);
+    return val;
+}
+
 void pipe_stage_mem()
 {
+    pipe_advance_latches(pipe.mem_latch, sim_config.pipe_mem_stages, &pipe.wb_op);
+    Pipe_Op **out = pipe_stage_output(pipe.mem_latch, sim_config.pipe_mem_stages, &pipe.wb_op);
+
+    pipe.dcache_port_used = 0;
+
     /* if a dcache miss is in progress, decrement cycles and return */
     if (pipe.mem_stall > 0) {
         pipe.mem_stall--;
+        pipe_cpi_charge(pipe.mem_op, CPI_DCACHE);
         return;
     }
 
     /* if there is no instruction in this pipeline stage, we are done */
-    if (!pipe.mem_op)
+    if (!pipe.mem_op || *out != NULL)
         return;
 
     /* grab the op out of our input slot */
@@ -172,106 +466,139 @@ void pipe_stage_mem()
 
     uint32_t val = 0;
 
+    /* with a store buffer, stores only wait for a free entry, and loads read
+     * the dcache only for bytes the buffer does not hold */
+    if (op->is_mem && pipe.sb.size > 0) {
+        if (op->mem_write) {
+            if (d_tlb_translate(op->mem_addr)) {
+                pipe_cpi_charge(op, CPI_DCACHE);
+                return;
+            }
+            if (!store_buffer_can_insert(&pipe.sb, op->mem_addr & ~3)) {
+                pipe.sb.stat_full++;
+                pipe_cpi_charge(op, CPI_DCACHE);
+                return;
+            }
+            store_buffer_insert(&pipe.sb, op->pc, op->mem_addr & ~3, pipe_store_merge(op, 0),
+                                pipe_mem_byte_mask(op));
+        }
+        else {
+            uint8_t mask = pipe_mem_byte_mask(op);
+            uint32_t buffered = 0;
+            uint8_t found = store_buffer_forward(&pipe.sb, op->mem_addr & ~3, &buffered);
+
+            if ((found & mask) == mask) {
+                val = buffered;
+                pipe.sb.stat_forwarded++;
+            }
+            else {
+                /* the dcache is blocked while a drain miss is being served */
+                if (pipe.sb.fill_active) {
+                    pipe.sb.stat_fill_wait++;
+                    pipe_cpi_charge(op, CPI_DCACHE);
+                    return;
+                }
+                pipe.dcache_port_used = 1;
+                val = pipe_dcache_read(op);
+                if (pipe.is_mem_stalled) {
+                    pipe_cpi_charge(op, CPI_DCACHE);
+                    return;
+                }
+                if (found & mask)
+                    pipe.sb.stat_partial++;
+                val = store_buffer_merge(val, buffered, found);
+            }
+
+            op->reg_dst_value = pipe_load_extract(op, val);
+            op->reg_dst_value_ready = 1;
+        }
+
+        pipe.mem_op = NULL;
+        *out = op;
+        return;
+    }
+
     /* access dcache */
     if (op->is_mem) {
-        val = d_cache_load(op->mem_addr);
+        val = pipe_dcache_read(op);
         if (pipe.is_mem_stalled) {
+            pipe_cpi_charge(op, CPI_DCACHE);
             return;
         }
     }
 
-    switch (op->opcode) {
-        case OP_LW:
-        case OP_LH:
-        case OP_LHU:
-        case OP_LB:
-        case OP_LBU:
-            {
-                /* extract needed value */
-                op->reg_dst_value_ready = 1;
-                if (op->opcode == OP_LW) {
-                    op->reg_dst_value = val;
-                }
-                else if (op->opcode == OP_LH || op->opcode == OP_LHU) {
-                    if (op->mem_addr & 2)
-                        val = (val >> 16) & 0xFFFF;
-                    else
-                        val = val & 0xFFFF;
-
-                    if (op->opcode == OP_LH)
-                        val |= (val & 0x8000) ? 0xFFFF8000 : 0;
-
-                    op->reg_dst_value = val;
-                }
-                else if (op->opcode == OP_LB || op->opcode == OP_LBU) {
-                    switch (op->mem_addr & 3) {
-                        case 0:
-                            val = val & 0xFF;
-                            break;
-                        case 1:
-                            val = (val >> 8) & 0xFF;
-                            break;
-                        case 2:
-                            val = (val >> 16) & 0xFF;
-                            break;
-                        case 3:
-                            val = (val >> 24) & 0xFF;
-                            break;
-                    }
-
-                    if (op->opcode == OP_LB)
-                        val |= (val & 0x80) ? 0xFFFFFF80 : 0;
-
-                    op->reg_dst_value = val;
-                }
-            }
-            break;
-
-        case OP_SB:
-            switch (op->mem_addr & 3) {
-                case 0: val = (val & 0xFFFFFF00) | ((op->mem_value & 0xFF) << 0); break;
-                case 1: val = (val & 0xFFFF00FF) | ((op->mem_value & 0xFF) << 8); break;
-                case 2: val = (val & 0xFF00FFFF) | ((op->mem_value & 0xFF) << 16); break;
-                case 3: val = (val & 0x00FFFFFF) | ((op->mem_value & 0xFF) << 24); break;
-            }
+    if (op->is_mem) {
+        if (op->mem_write) {
+            d_cache_store(op->mem_addr & ~3, pipe_store_merge(op, val));
+        }
+        else {
+            op->reg_dst_value = pipe_load_extract(op, val);
+            op->reg_dst_value_ready = 1;
+        }
+    }
 
-            d_cache_store(op->mem_addr & ~3, val);
-            break;
+    /* clear stage input and transfer to next stage */
+    pipe.mem_op = NULL;
+    *out = op;
+}
 
-        case OP_SH:
-#ifdef DEBUG
-            printf("SH: addr %08x val %04x old word %08x\n", op->mem_addr, op->mem_value & 0xFFFF, val);
-#endif
-            if (op->mem_addr & 2)
-                val = (val & 0x0000FFFF) | (op->mem_value) << 16;
-            else
-                val = (val & 0xFFFF0000) | (op->mem_value & 0xFFFF);
-#ifdef DEBUG
-            printf("new word %08x\n", val);
-#endif
+/* Reads source register reg for the op in execute, bypassing from the
+ * youngest older op that writes it. Returns 1 if the value is not available
+ * yet: results become available once an op has left the execute stage, and
+ * loaded values once it has left the memory stage. */
+static int pipe_read_source(int reg, uint32_t *value)
+{
+    if (reg == 0) {
+        *value = 0;
+        return 0;
+    }
 
-            d_cache_store(op->mem_addr & ~3, val);
-            break;
+    for (int i = 0; i < sim_config.pipe_execute_stages - 1; ++i) {
+        if (pipe.execute_latch[i] && pipe.execute_latch[i]->reg_dst == reg)
+            return 1;
+    }
 
-        case OP_SW:
-            val = op->mem_value;
-            d_cache_store(op->mem_addr & ~3, val);
-            break;
+    /* still in its last execute cycle (with one execute stage, the memory
+     * stage is stalled and so is execute) */
+    if (pipe.mem_op && pipe.mem_op->reg_dst == reg)
+        return 1;
+
+    for (int i = 0; i < sim_config.pipe_mem_stages - 1; ++i) {
+        Pipe_Op *producer = pipe.mem_latch[i];
+        if (producer && producer->reg_dst == reg) {
+            if (producer->is_mem && !producer->mem_write)
+                return 1;
+            *value = producer->reg_dst_value;
+            return 0;
+        }
     }
 
-    /* clear stage input and transfer to next stage */
-    pipe.mem_op = NULL;
-    pipe.wb_op = op;
+    if (pipe.wb_op && pipe.wb_op->reg_dst == reg)
+        *value = pipe.wb_op->reg_dst_value;
+    else
+        *value = pipe.REGS[reg];
+
+    return 0;
 }
 
 void pipe_stage_execute()
 {
     /* if a multiply/divide is in progress, decrement cycles until value is ready */
-    if (pipe.multiplier_stall > 0)
-        pipe.multiplier_stall--;
+    if (pipe.hi_stall > 0)
+        pipe.hi_stall--;
+    if (pipe.lo_stall > 0)
+        pipe.lo_stall--;
+    if (pipe.mul_busy > 0)
+        pipe.mul_busy--;
+    if (pipe.div_busy > 0)
+        pipe.div_busy--;
+
+    pipe_advance_latches(pipe.execute_latch, sim_config.pipe_execute_stages, &pipe.mem_op);
+    Pipe_Op **out = pipe_stage_output(pipe.execute_latch, sim_config.pipe_execute_stages,
+                                      &pipe.mem_op);
 
     /* if downstream stall, return (and leave any input we had) */
-    if (pipe.mem_op != NULL)
+    if (*out != NULL)
         return;
 
     /* if no op to execute, return */
@@ -283,328 +610,209 @@ void pipe_stage_execute()
 
     /* read register values, and check for bypass; stall if necessary */
     int stall = 0;
-    if (op->reg_src1 != -1) {
-        if (op->reg_src1 == 0)
-            op->reg_src1_value = 0;
-        else if (pipe.mem_op && pipe.mem_op->reg_dst == op->reg_src1) {
-            if (!pipe.mem_op->reg_dst_value_ready)
-                stall = 1;
-            else
-                op->reg_src1_value = pipe.mem_op->reg_dst_value;
-        }
-        else if (pipe.wb_op && pipe.wb_op->reg_dst == op->reg_src1) {
-            op->reg_src1_value = pipe.wb_op->reg_dst_value;
-        }
-        else
-            op->reg_src1_value = pipe.REGS[op->reg_src1];
-    }
-    if (op->reg_src2 != -1) {
-        if (op->reg_src2 == 0)
-            op->reg_src2_value = 0;
-        else if (pipe.mem_op && pipe.mem_op->reg_dst == op->reg_src2) {
-            if (!pipe.mem_op->reg_dst_value_ready)
-                stall = 1;
-            else
-                op->reg_src2_value = pipe.mem_op->reg_dst_value;
-        }
-        else if (pipe.wb_op && pipe.wb_op->reg_dst == op->reg_src2) {
-            op->reg_src2_value = pipe.wb_op->reg_dst_value;
-        }
-        else
-            op->reg_src2_value = pipe.REGS[op->reg_src2];
-    }
+    if (op->reg_src1 != -1)
+        stall |= pipe_read_source(op->reg_src1, &op->reg_src1_value);
+    if (op->reg_src2 != -1)
+        stall |= pipe_read_source(op->reg_src2, &op->reg_src2_value);
 
     /* if bypassing requires a stall (e.g. use immediately after load),
      * return without clearing stage input */
-    if (stall) 
+    if (stall) {
+        pipe_cpi_charge(op, CPI_LOAD_USE);
         return;
+    }
 
-    /* execute the op */
-    switch (op->opcode) {
-        case OP_SPECIAL:
-            op->reg_dst_value_ready = 1;
-            switch (op->subop) {
-                case SUBOP_SLL:
-                    op->reg_dst_value = op->reg_src2_value << op->shamt;
-                    break;
-                case SUBOP_SLLV:
-                    op->reg_dst_value = op->reg_src2_value << op->reg_src1_value;
-                    break;
-                case SUBOP_SRL:
-                    op->reg_dst_value = op->reg_src2_value >> op->shamt;
-                    break;
-                case SUBOP_SRLV:
-                    op->reg_dst_value = op->reg_src2_value >> op->reg_src1_value;
-                    break;
-                case SUBOP_SRA:
-                    op->reg_dst_value = (int32_t)op->reg_src2_value >> op->shamt;
-                    break;
-                case SUBOP_SRAV:
-                    op->reg_dst_value = (int32_t)op->reg_src2_value >> op->reg_src1_value;
-                    break;
-                case SUBOP_JR:
-                case SUBOP_JALR:
-                    op->reg_dst_value = op->pc + 4;
-                    op->branch_dest = op->reg_src1_value;
-                    op->branch_taken = 1;
-                    break;
+    /* MFHI/MFLO wait until the register they read has been written */
+    if ((op->reads_hi && pipe.hi_stall > 0) || (op->reads_lo && pipe.lo_stall > 0)) {
+        pipe.stat_hilo_stalls++;
+        pipe_cpi_charge(op, CPI_MULDIV);
+        return;
+    }
 
-                case SUBOP_MULT:
-                    {
-                        /* we set a result value right away; however, we will
-                         * model a stall if the program tries to read the value
-                         * before it's ready (or overwrite HI/LO). Also, if
-                         * another multiply comes down the pipe later, it will
-                         * update the values and re-set the stall cycle count
-                         * for a new operation.
-                         */
-                        int64_t val = (int64_t)((int32_t)op->reg_src1_value) * (int64_t)((int32_t)op->reg_src2_value);
-                        uint64_t uval = (uint64_t)val;
-                        pipe.HI = (uval >> 32) & 0xFFFFFFFF;
-                        pipe.LO = (uval >>  0) & 0xFFFFFFFF;
+    /* a multiply/divide waits until its unit accepts a new op */
+    if (op->is_muldiv && (pipe_is_mul(op) ? pipe.mul_busy : pipe.div_busy) > 0) {
+        pipe.stat_muldiv_busy++;
+        pipe_cpi_charge(op, CPI_MULDIV);
+        return;
+    }
 
-                        /* four-cycle multiplier latency */
-                        pipe.multiplier_stall = 4;
-                    }
-                    break;
-                case SUBOP_MULTU:
-                    {
-                        uint64_t val = (uint64_t)op->reg_src1_value * (uint64_t)op->reg_src2_value;
-                        pipe.HI = (val >> 32) & 0xFFFFFFFF;
-                        pipe.LO = (val >>  0) & 0xFFFFFFFF;
+    /* execute the op */
+    op->hi_value = pipe.HI;
+    op->lo_value = pipe.LO;
+    pipe_execute_op(op);
+
+    /* we set HI/LO right away; however, we will model a stall if the program
+     * tries to read the value before it's ready. HI/LO are written in program
+     * order, so a result is not ready before that of an older multiply/divide.
+     * MTHI/MTLO supersede the pending result of an older multiply/divide. */
+    if (op->writes_hi)
+        pipe.HI = op->hi_value;
+    if (op->writes_lo)
+        pipe.LO = op->lo_value;
+    if (op->is_muldiv) {
+        int latency = pipe_op_latency(op);
+        if (pipe.hi_stall < latency)
+            pipe.hi_stall = latency;
+        if (pipe.lo_stall < latency)
+            pipe.lo_stall = latency;
+
+        if (pipe_is_mul(op))
+            pipe.mul_busy = pipe_muldiv_busy_cycles(op);
+        else
+            pipe.div_busy = pipe_muldiv_busy_cycles(op);
+    }
+    else {
+        if (op->writes_hi)
+            pipe.hi_stall = 0;
+        if (op->writes_lo)
+            pipe.lo_stall = 0;
+    }
 
-                        /* four-cycle multiplier latency */
-                        pipe.multiplier_stall = 4;
-                    }
-                    break;
+    /* update branch predictor and perform branch recovery (with partial BTB
+     * tags, a non-branch can also be predicted taken) */
+    if (op->is_branch || op->predicted_branch_taken) {
+        /* flush pipeline */
+        if (pipe_branch_mispredicted(op)) {
+            profile_count(op->pc, PROF_MISPREDICTS, 1);
+            if (pipe.ras.depth > 0)
+                pipe.branch_ras = ras_resolve(&pipe.ras, &op->ras_checkpoint, op->ras_type,
+                                              op->branch_taken, op->pc + 4);
+            if (pipe.bpred.speculative) {
+                pipe.branch_history = op->bpred_history;
+                pipe.branch_outcome = op->branch_cond ? op->branch_taken : -1;
+            }
 
-                case SUBOP_DIV:
-                    if (op->reg_src2_value != 0) {
+            if (op->branch_taken) {
+                pipe_recover(3, op->branch_dest);
+            }
+            else {
+                pipe_recover(3, op->pc + 4);
+            }
+        }
 
-                        int32_t val1 = (int32_t)op->reg_src1_value;
-                        int32_t val2 = (int32_t)op->reg_src2_value;
-                        int32_t div, mod;
+        if (op->is_branch)
+            pipe_update_branch_pred(op);
+        else
+            btb_invalidate(&pipe.btb, op->pc);
+    }
 
-                        div = val1 / val2;
-                        mod = val1 % val2;
+    /* remove from upstream stage and place in downstream stage */
+    pipe.execute_op = NULL;
+    *out = op;
+}
 
-                        pipe.LO = div;
-                        pipe.HI = mod;
-                    } else {
-                        // really this would be a div-by-0 exception
-                        pipe.HI = pipe.LO = 0;
-                    }
+void pipe_stage_decode()
+{
+    pipe_advance_latches(pipe.decode_latch, sim_config.pipe_decode_stages, &pipe.execute_op);
+    Pipe_Op **out = pipe_stage_output(pipe.decode_latch, sim_config.pipe_decode_stages,
+                                      &pipe.execute_op);
 
-                    /* 32-cycle divider latency */
-                    pipe.multiplier_stall = 32;
-                    break;
+    /* if downstream stall, return (and leave any input we had) */
+    if (*out != NULL)
+        return;
 
-                case SUBOP_DIVU:
-                    if (op->reg_src2_value != 0) {
-                        pipe.HI = (uint32_t)op->reg_src1_value % (uint32_t)op->reg_src2_value;
-                        pipe.LO = (uint32_t)op->reg_src1_value / (uint32_t)op->reg_src2_value;
-                    } else {
-                        /* really this would be a div-by-0 exception */
-                        pipe.HI = pipe.LO = 0;
-                    }
+    /* if no op to decode, return */
+    if (pipe.decode_op == NULL)
+        return;
 
-                    /* 32-cycle divider latency */
-                    pipe.multiplier_stall = 32;
-                    break;
+    /* grab op and remove from stage input */
+    Pipe_Op *op = pipe.decode_op;
+    pipe.decode_op = NULL;
 
-                case SUBOP_MFHI:
-                    /* stall until value is ready */
-                    if (pipe.multiplier_stall > 0)
-                        return;
+    /* set up info fields (source/dest regs, immediate, jump dest) as necessary */
+    pipe_decode_op(op);
 
-                    op->reg_dst_value = pipe.HI;
-                    break;
-                case SUBOP_MTHI:
-                    /* stall to respect WAW dependence */
-                    if (pipe.multiplier_stall > 0)
-                        return;
-
-                    pipe.HI = op->reg_src1_value;
-                    break;
-
-                case SUBOP_MFLO:
-                    /* stall until value is ready */
-                    if (pipe.multiplier_stall > 0)
-                        return;
-
-                    op->reg_dst_value = pipe.LO;
-                    break;
-                case SUBOP_MTLO:
-                    /* stall to respect WAW dependence */
-                    if (pipe.multiplier_stall > 0)
-                        return;
-
-                    pipe.LO = op->reg_src1_value;
-                    break;
-
-                case SUBOP_ADD:
-                case SUBOP_ADDU:
-                    op->reg_dst_value = op->reg_src1_value + op->reg_src2_value;
-                    break;
-                case SUBOP_SUB:
-                case SUBOP_SUBU:
-                    op->reg_dst_value = op->reg_src1_value - op->reg_src2_value;
-                    break;
-                case SUBOP_AND:
-                    op->reg_dst_value = op->reg_src1_value & op->reg_src2_value;
-                    break;
-                case SUBOP_OR:
-                    op->reg_dst_value = op->reg_src1_value | op->reg_src2_value;
-                    break;
-                case SUBOP_NOR:
-                    op->reg_dst_value = ~(op->reg_src1_value | op->reg_src2_value);
-                    break;
-                case SUBOP_XOR:
-                    op->reg_dst_value = op->reg_src1_value ^ op->reg_src2_value;
-                    break;
-                case SUBOP_SLT:
-                    op->reg_dst_value = ((int32_t)op->reg_src1_value <
-                            (int32_t)op->reg_src2_value) ? 1 : 0;
-                    break;
-                case SUBOP_SLTU:
-                    op->reg_dst_value = (op->reg_src1_value < op->reg_src2_value) ? 1 : 0;
-                    break;
-            }
-            break;
-
-        case OP_BRSPEC:
-            switch (op->subop) {
-                case BROP_BLTZ:
-                case BROP_BLTZAL:
-                    if ((int32_t)op->reg_src1_value < 0) op->branch_taken = 1;
-                    break;
-
-                case BROP_BGEZ:
-                case BROP_BGEZAL:
-                    if ((int32_t)op->reg_src1_value >= 0) op->branch_taken = 1;
-                    break;
-            }
-            break;
+    /* we will handle reg-read together with bypass in the execute stage */
 
-        case OP_BEQ:
-            if (op->reg_src1_value == op->reg_src2_value) op->branch_taken = 1;
-            break;
+    /* place op in downstream slot */
+    *out = op;
+}
 
-        case OP_BNE:
-            if (op->reg_src1_value != op->reg_src2_value) op->branch_taken = 1;
-            break;
+void pipe_stage_fetch()
+{
+    /* if execution halted, increment PC and return */
+    if (!RUN_BIT) {
+        pipe.PC += 4;
+        return;
+    }
 
-        case OP_BLEZ:
-            if ((int32_t)op->reg_src1_value <= 0) op->branch_taken = 1;
-            break;
+    pipe_advance_latches(pipe.fetch_latch, sim_config.pipe_fetch_stages, &pipe.decode_op);
+    Pipe_Op **out = pipe_stage_output(pipe.fetch_latch, sim_config.pipe_fetch_stages,
+                                      &pipe.decode_op);
 
-        case OP_BGTZ:
-            if ((int32_t)op->reg_src1_value > 0) op->branch_taken = 1;
-            break;
+    /* decoupled front end: decode takes instructions from the IB */
+    if (sim_config.fe_ftq_size > 0) {
+        frontend_cycle();
+        if (*out == NULL)
+            *out = frontend_pop();
+        return;
+    }
 
-        case OP_ADDI:
-        case OP_ADDIU:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value + op->se_imm16;
-            break;
-        case OP_SLTI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = (int32_t)op->reg_src1_value < (int32_t)op->se_imm16 ? 1 : 0;
-            break;
-        case OP_SLTIU:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = (uint32_t)op->reg_src1_value < (uint32_t)op->se_imm16 ? 1 : 0;
-            break;
-        case OP_ANDI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value & op->imm16;
-            break;
-        case OP_ORI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value | op->imm16;
-            break;
-        case OP_XORI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value ^ op->imm16;
-            break;
-        case OP_LUI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->imm16 << 16;
-            break;
+    if (pipe.fetch_stopped)
+        return;
 
-        case OP_LW:
-        case OP_LH:
-        case OP_LHU:
-        case OP_LB:
-        case OP_LBU:
-            op->mem_addr = op->reg_src1_value + op->se_imm16;
-            break;
+    /* if an icache miss is in progress, decrement cycles and return */
+    if (pipe.fetch_stall > 0) {
+        pipe.fetch_stall--;
+        pipe.cpi_pending[CPI_ICACHE]++;
+        return;
+    }
 
-        case OP_SW:
-        case OP_SH:
-        case OP_SB:
-            op->mem_addr = op->reg_src1_value + op->se_imm16;
-            op->mem_value = op->reg_src2_value;
-            break;
+    /* if a taken branch was found in the L1 BTB, wait for the bubble */
+    if (pipe.btb_bubble > 0) {
+        pipe.btb_bubble--;
+        pipe.btb.stat_bubble_cycles++;
+        pipe.cpi_pending[CPI_FRONTEND]++;
+        return;
     }
+    
+    /* if pipeline is stalled (our output slot is not empty), return */
+    if (*out != NULL) {
+        return;
+    }
+    
+    uint32_t next_instruction = i_cache_load();
 
-    /* update branch predictor and perform branch recovery */
-    if (op->is_branch) {
-        /* flush pipeline
-         * cond 1: mispredicted direction
-         * cond 2: if taken, mispredicted target
-         * cond 3: BTB miss
-         */
-        if ((op->branch_taken != op->predicted_branch_taken) || \
-            (op->branch_taken && (op->branch_dest != op->predicted_branch_dest)) || \
-            (!op->predicted_is_branch)) {
-            if (op->branch_taken) {
-                pipe_recover(3, op->branch_dest);
-            }
-            else {
-                pipe_recover(3, op->pc + 4);
-            }
-        }
+    /* return on cache miss */
+    if (pipe.is_fetch_stalled) {
+        pipe.cpi_pending[CPI_ICACHE]++;
+        return;
+    }
 
-        // update GHR and PHT for conditional branches
-        if (op->branch_cond) {
-            update_gshare(&pipe.gshare_predictor, op->pc, op->branch_taken);
-        }
+    /* Allocate an op and send it down the pipeline. */
+    Pipe_Op *op = pipe_alloc_op(pipe.PC, next_instruction);
+    *out = op;
 
-        // update BTB
-        uint32_t btb_index = get_btb_index(op->pc);
-        pipe.BTB[btb_index].address = op->pc;
-        pipe.BTB[btb_index].branch_target = op->branch_dest;
-        pipe.BTB[btb_index].valid = 1;
-        pipe.BTB[btb_index].is_unconditional = !(op->branch_cond);
-    }
+    /* update PC */
+    pipe.PC = predict_next_PC(op);
 
-    /* remove from upstream stage and place in downstream stage */
-    pipe.execute_op = NULL;
-    pipe.mem_op = op;
+    stat_inst_fetch++;
 }
 
-void pipe_stage_decode()
+Pipe_Op *pipe_alloc_op(uint32_t pc, uint32_t instruction)
 {
-    /* if downstream stall, return (and leave any input we had) */
-    if (pipe.execute_op != NULL)
-        return;
+    Pipe_Op *op = malloc(sizeof(Pipe_Op));
+    memset(op, 0, sizeof(Pipe_Op));
+    op->reg_src1 = op->reg_src2 = op->reg_dst = -1;
+    op->instruction = instruction;
+    op->pc = pc;
 
-    /* if no op to decode, return */
-    if (pipe.decode_op == NULL)
-        return;
+    /* the op inherits the fetch stalls that preceded it */
+    memcpy(op->cpi_stall, pipe.cpi_pending, sizeof(pipe.cpi_pending));
+    op->cpi_after_flush = pipe.cpi_after_flush;
+    memset(pipe.cpi_pending, 0, sizeof(pipe.cpi_pending));
+    pipe.cpi_after_flush = 0;
 
-    /* grab op and remove from stage input */
-    Pipe_Op *op = pipe.decode_op;
-    pipe.decode_op = NULL;
+    return op;
+}
 
-    /* set up info fields (source/dest regs, immediate, jump dest) as necessary */
+void pipe_decode_op(Pipe_Op *op)
+{
     uint32_t opcode = (op->instruction >> 26) & 0x3F;
     uint32_t rs = (op->instruction >> 21) & 0x1F;
     uint32_t rt = (op->instruction >> 16) & 0x1F;
     uint32_t rd = (op->instruction >> 11) & 0x1F;
     uint32_t shamt = (op->instruction >> 6) & 0x1F;
-    uint32_t funct1 = (op->instruction >> 0) & 0x1F;
     uint32_t funct2 = (op->instruction >> 0) & 0x3F;
     uint32_t imm16 = (op->instruction >> 0) & 0xFFFF;
     uint32_t se_imm16 = imm16 | ((imm16 & 0x8000) ? 0xFFFF8000 : 0);
@@ -631,6 +839,17 @@ void pipe_stage_decode()
                 op->is_branch = 1;
                 op->branch_cond = 0;
             }
+            if (funct2 == SUBOP_MULT || funct2 == SUBOP_MULTU ||
+                funct2 == SUBOP_DIV || funct2 == SUBOP_DIVU) {
+                op->is_muldiv = 1;
+                op->writes_hi = op->writes_lo = 1;
+            }
+            op->reads_hi = (funct2 == SUBOP_MFHI);
+            op->reads_lo = (funct2 == SUBOP_MFLO);
+            if (funct2 == SUBOP_MTHI)
+                op->writes_hi = 1;
+            if (funct2 == SUBOP_MTLO)
+                op->writes_lo = 1;
 
             break;
 
@@ -718,68 +937,472 @@ void pipe_stage_decode()
             break;
     }
 
-    /* we will handle reg-read together with bypass in the execute stage */
-
-    /* place op in downstream slot */
-    pipe.execute_op = op;
 }
 
-void pipe_stage_fetch()
+void pipe_execute_op(Pipe_Op *op)
 {
-    /* if execution halted, increment PC and return */
-    if (!RUN_BIT) {
-        pipe.PC += 4;
-        return;
-    }
+    switch (op->opcode) {
+        case OP_SPECIAL:
+            op->reg_dst_value_ready = 1;
+            switch (op->subop) {
+                case SUBOP_SLL:
+                    op->reg_dst_value = op->reg_src2_value << op->shamt;
+                    break;
+                case SUBOP_SLLV:
+                    op->reg_dst_value = op->reg_src2_value << op->reg_src1_value;
+                    break;
+                case SUBOP_SRL:
+                    op->reg_dst_value = op->reg_src2_value >> op->shamt;
+                    break;
+                case SUBOP_SRLV:
+                    op->reg_dst_value = op->reg_src2_value >> op->reg_src1_value;
+                    break;
+                case SUBOP_SRA:
+                    op->reg_dst_value = (int32_t)op->reg_src2_value >> op->shamt;
+                    break;
+                case SUBOP_SRAV:
+                    op->reg_dst_value = (int32_t)op->reg_src2_value >> op->reg_src1_value;
+                    break;
+                case SUBOP_JR:
+                case SUBOP_JALR:
+                    op->reg_dst_value = op->pc + 4;
+                    op->branch_dest = op->reg_src1_value;
+                    op->branch_taken = 1;
+                    break;
 
-    /* if an icache miss is in progress, decrement cycles and return */
-    if (pipe.fetch_stall > 0) {
-        pipe.fetch_stall--;
-        return;
-    }
-    
-    /* if pipeline is stalled (our output slot is not empty), return */
-    if (pipe.decode_op != NULL) {
-        return;
-    }
-    
-    uint32_t next_instruction = i_cache_load();
+                case SUBOP_MULT:
+                    {
+                        int64_t val = (int64_t)((int32_t)op->reg_src1_value) * (int64_t)((int32_t)op->reg_src2_value);
+                        uint64_t uval = (uint64_t)val;
+                        op->hi_value = (uval >> 32) & 0xFFFFFFFF;
+                        op->lo_value = (uval >>  0) & 0xFFFFFFFF;
+                    }
+                    break;
+                case SUBOP_MULTU:
+                    {
+                        uint64_t val = (uint64_t)op->reg_src1_value * (uint64_t)op->reg_src2_value;
+                        op->hi_value = (val >> 32) & 0xFFFFFFFF;
+                        op->lo_value = (val >>  0) & 0xFFFFFFFF;
+                    }
+                    break;
 
-    /* return on cache miss */
-    if (pipe.is_fetch_stalled) {
-        return;
-    }
+                case SUBOP_DIV:
+                    if (op->reg_src2_value != 0) {
 
-    /* Allocate an op and send it down the pipeline. */
-    Pipe_Op *op = malloc(sizeof(Pipe_Op));
-    memset(op, 0, sizeof(Pipe_Op));
-    op->reg_src1 = op->reg_src2 = op->reg_dst = -1;
-    op->instruction = next_instruction;
-    op->pc = pipe.PC;
-    pipe.decode_op = op;
+                        int32_t val1 = (int32_t)op->reg_src1_value;
+                        int32_t val2 = (int32_t)op->reg_src2_value;
+                        int32_t div, mod;
 
-    /* update PC */
-    pipe.PC = predict_next_PC(op);
+                        div = val1 / val2;
+                        mod = val1 % val2;
 
-    stat_inst_fetch++;
-}
+                        op->lo_value = div;
+                        op->hi_value = mod;
+                    } else {
+                        // really this would be a div-by-0 exception
+                        op->hi_value = op->lo_value = 0;
+                    }
+                    break;
 
-void pipe_stop()
-{
-    cache_destroy(&pipe.l1i_cache);
-    cache_destroy(&pipe.l1d_cache);
-}
+                case SUBOP_DIVU:
+                    if (op->reg_src2_value != 0) {
+                        op->hi_value = (uint32_t)op->reg_src1_value % (uint32_t)op->reg_src2_value;
+                        op->lo_value = (uint32_t)op->reg_src1_value / (uint32_t)op->reg_src2_value;
+                    } else {
+                        /* really this would be a div-by-0 exception */
+                        op->hi_value = op->lo_value = 0;
+                    }
+                    break;
+
+                case SUBOP_MFHI:
+                    op->reg_dst_value = op->hi_value;
+                    break;
+                case SUBOP_MTHI:
+                    op->hi_value = op->reg_src1_value;
+                    break;
+
+                case SUBOP_MFLO:
+                    op->reg_dst_value = op->lo_value;
+                    break;
+                case SUBOP_MTLO:
+                    op->lo_value = op->reg_src1_value;
+                    break;
+
+                case SUBOP_ADD:
+                case SUBOP_ADDU:
+                    op->reg_dst_value = op->reg_src1_value + op->reg_src2_value;
+                    break;
+                case SUBOP_SUB:
+                case SUBOP_SUBU:
+                    op->reg_dst_value = op->reg_src1_value - op->reg_src2_value;
+                    break;
+                case SUBOP_AND:
+                    op->reg_dst_value = op->reg_src1_value & op->reg_src2_value;
+                    break;
+                case SUBOP_OR:
+                    op->reg_dst_value = op->reg_src1_value | op->reg_src2_value;
+                    break;
+                case SUBOP_NOR:
+                    op->reg_dst_value = ~(op->reg_src1_value | op->reg_src2_value);
+                    break;
+                case SUBOP_XOR:
+                    op->reg_dst_value = op->reg_src1_value ^ op->reg_src2_value;
+                    break;
+                case SUBOP_SLT:
+                    op->reg_dst_value = ((int32_t)op->reg_src1_value <
+                            (int32_t)op->reg_src2_value) ? 1 : 0;
+                    break;
+                case SUBOP_SLTU:
+                    op->reg_dst_value = (op->reg_src1_value < op->reg_src2_value) ? 1 : 0;
+                    break;
+            }
+            break;
+
+        case OP_BRSPEC:
+            switch (op->subop) {
+                case BROP_BLTZ:
+                case BROP_BLTZAL:
+                    if ((int32_t)op->reg_src1_value < 0) op->branch_taken = 1;
+                    break;
+
+                case BROP_BGEZ:
+                case BROP_BGEZAL:
+                    if ((int32_t)op->reg_src1_value >= 0) op->branch_taken = 1;
+                    break;
+            }
+            break;
+
+        case OP_BEQ:
+            if (op->reg_src1_value == op->reg_src2_value) op->branch_taken = 1;
+            break;
+
+        case OP_BNE:
+            if (op->reg_src1_value != op->reg_src2_value) op->branch_taken = 1;
+            break;
+
+        case OP_BLEZ:
+            if ((int32_t)op->reg_src1_value <= 0) op->branch_taken = 1;
+            break;
+
+        case OP_BGTZ:
+            if ((int32_t)op->reg_src1_value > 0) op->branch_taken = 1;
+            break;
+
+        case OP_ADDI:
+        case OP_ADDIU:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value + op->se_imm16;
+            break;
+        case OP_SLTI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = (int32_t)op->reg_src1_value < (int32_t)op->se_imm16 ? 1 : 0;
+            break;
+        case OP_SLTIU:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = (uint32_t)op->reg_src1_value < (uint32_t)op->se_imm16 ? 1 : 0;
+            break;
+        case OP_ANDI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value & op->imm16;
+            break;
+        case OP_ORI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value | op->imm16;
+            break;
+        case OP_XORI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value ^ op->imm16;
+            break;
+        case OP_LUI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->imm16 << 16;
+            break;
+
+        case OP_LW:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LB:
+        case OP_LBU:
+            op->mem_addr = op->reg_src1_value + op->se_imm16;
+            break;
+
+        case OP_SW:
+        case OP_SH:
+        case OP_SB:
+            op->mem_addr = op->reg_src1_value + op->se_imm16;
+            op->mem_value = op->reg_src2_value;
+            break;
+    }
+
+}
+
+int pipe_op_latency(Pipe_Op *op)
+{
+    if (!op->is_muldiv)
+        return 1;
+
+    if (pipe_is_mul(op))
+        return sim_config.mul_latency;
+
+    if (!sim_config.div_early_out)
+        return sim_config.div_latency;
+
+    /* early out: the divider stops once it has shifted in the significant
+     * bits of the dividend */
+    uint32_t dividend = op->reg_src1_value;
+    if (op->subop == SUBOP_DIV && (int32_t) dividend < 0)
+        dividend = -dividend;
+
+    int bits = 0;
+    while (dividend) {
+        bits++;
+        dividend >>= 1;
+    }
+
+    int latency = (sim_config.div_latency * bits + 31) / 32;
+    return latency > 1 ? latency : 1;
+}
+
+int pipe_muldiv_busy_cycles(Pipe_Op *op)
+{
+    /* a pipelined multiplier accepts a new op every cycle; the divider is
+     * busy until it is done */
+    if (pipe_is_mul(op) && sim_config.mul_pipelined)
+        return 1;
+
+    return pipe_op_latency(op);
+}
+
+int pipe_is_mul(Pipe_Op *op)
+{
+    return op->subop == SUBOP_MULT || op->subop == SUBOP_MULTU;
+}
+
+uint32_t pipe_load_extract(Pipe_Op *op, uint32_t val)
+{
+    if (op->opcode == OP_LH || op->opcode == OP_LHU) {
+        if (op->mem_addr & 2)
+            val = (val >> 16) & 0xFFFF;
+        else
+            val = val & 0xFFFF;
+
+        if (op->opcode == OP_LH)
+            val |= (val & 0x8000) ? 0xFFFF8000 : 0;
+    }
+    else if (op->opcode == OP_LB || op->opcode == OP_LBU) {
+        switch (op->mem_addr & 3) {
+            case 0:
+                val = val & 0xFF;
+                break;
+            case 1:
+                val = (val >> 8) & 0xFF;
+                break;
+            case 2:
+                val = (val >> 16) & 0xFF;
+                break;
+            case 3:
+                val = (val >> 24) & 0xFF;
+                break;
+        }
+
+        if (op->opcode == OP_LB)
+            val |= (val & 0x80) ? 0xFFFFFF80 : 0;
+    }
+
+    return val;
+}
+
+uint32_t pipe_store_merge(Pipe_Op *op, uint32_t val)
+{
+    switch (op->opcode) {
+        case OP_SB:
+            switch (op->mem_addr & 3) {
+                case 0: val = (val & 0xFFFFFF00) | ((op->mem_value & 0xFF) << 0); break;
+                case 1: val = (val & 0xFFFF00FF) | ((op->mem_value & 0xFF) << 8); break;
+                case 2: val = (val & 0xFF00FFFF) | ((op->mem_value & 0xFF) << 16); break;
+                case 3: val = (val & 0x00FFFFFF) | ((op->mem_value & 0xFF) << 24); break;
+            }
+            break;
+
+        case OP_SH:
+            if (op->mem_addr & 2)
+                val = (val & 0x0000FFFF) | (op->mem_value) << 16;
+            else
+                val = (val & 0xFFFF0000) | (op->mem_value & 0xFFFF);
+            break;
+
+        case OP_SW:
+            val = op->mem_value;
+            break;
+    }
+
+    return val;
+}
+
+uint8_t pipe_mem_byte_mask(Pipe_Op *op)
+{
+    switch (op->opcode) {
+        case OP_LB:
+        case OP_LBU:
+        case OP_SB:
+            return 1 << (op->mem_addr & 3);
+        case OP_LH:
+        case OP_LHU:
+        case OP_SH:
+            return (op->mem_addr & 2) ? 0xC : 0x3;
+        default:
+            return 0xF;
+    }
+}
+
+int pipe_branch_mispredicted(Pipe_Op *op)
+{
+    /* a partial-tag BTB hit redirected a non-branch */
+    if (!op->is_branch)
+        return op->predicted_branch_taken;
+
+    /* cond 1: mispredicted direction
+     * cond 2: if taken, mispredicted target
+     * cond 3: BTB miss
+     */
+    return (op->branch_taken != op->predicted_branch_taken) ||
+           (op->branch_taken && (op->branch_dest != op->predicted_branch_dest)) ||
+           (!op->predicted_is_branch);
+}
+
+void pipe_update_branch_pred(Pipe_Op *op)
+{
+    // train the direction predictor with conditional branches
+    if (op->branch_cond) {
+        bpred_resolve(&pipe.bpred, op->pc, op->branch_taken, &op->bpred_info);
+    }
+
+    // return prediction accuracy
+    if (op->ras_type == RAS_RETURN) {
+        pipe.ras.stat_returns++;
+        if (op->ras_predicted) {
+            pipe.ras.stat_predictions++;
+            if (op->branch_dest == op->predicted_branch_dest)
+                pipe.ras.stat_correct++;
+        }
+    }
+
+    // update BTB
+    if (op->branch_taken) {
+        pipe.btb.stat_taken_branches++;
+        if (!op->predicted_is_branch)
+            pipe.btb.stat_taken_misses++;
+    }
+    btb_update(&pipe.btb, op->pc, op->branch_dest, !(op->branch_cond));
+}
+
+void pipe_stop_fetch()
+{
+    pipe.fetch_stopped = 1;
+}
+
+/* returns 1 if any latch of a stage holds an op */
+static int pipe_latches_busy(Pipe_Op **latches, int stages)
+{
+    for (int i = 0; i < stages - 1; ++i) {
+        if (latches[i])
+            return 1;
+    }
+    return 0;
+}
+
+int pipe_drained()
+{
+    if (sim_config.fe_ftq_size > 0 && (fe.ftq_count > 0 || fe.ib_count > 0 || fe.fill_active))
+        return 0;
+
+    if (sim_config.core == CORE_OOO)
+        return ooo_drained();
+
+    return !pipe.decode_op && !pipe.execute_op && !pipe.mem_op && !pipe.wb_op &&
+           !pipe_latches_busy(pipe.fetch_latch, sim_config.pipe_fetch_stages) &&
+           !pipe_latches_busy(pipe.decode_latch, sim_config.pipe_decode_stages) &&
+           !pipe_latches_busy(pipe.execute_latch, sim_config.pipe_execute_stages) &&
+           !pipe_latches_busy(pipe.mem_latch, sim_config.pipe_mem_stages) &&
+           pipe.sb.count == 0 && !pipe.sb.fill_active;
+}
+
+void pipe_resume_fetch()
+{
+    /* a fill for the old fetch PC is dropped */
+    i_cache_abandon_fill();
+    pipe.fetch_stall = 0;
+    pipe.is_fetch_stalled = 0;
+    pipe.is_fetch_walking = 0;
+    pipe.btb_bubble = 0;
+    pipe.fetch_stopped = 0;
+}
+
+void pipe_stop()
+{
+    if (sim_config.core == CORE_OOO)
+        ooo_stop();
+
+    /* buffered stores are older than the halting syscall */
+    while (pipe.sb.count > 0) {
+        Store_Buffer_Entry *entry = store_buffer_head(&pipe.sb);
+        pipe_write_store(entry, 1);
+        store_buffer_pop(&pipe.sb);
+    }
+    destroy_store_buffer(&pipe.sb);
+    destroy_mmu(&pipe.mmu);
+
+    /* write dirty lines back so that memory holds the final state, whichever
+     * lines happened to be evicted */
+    for (uint16_t set = 0; set < pipe.l1d_cache.NUM_SET; ++set) {
+        for (uint16_t way = 0; way < pipe.l1d_cache.NUM_WAY; ++way)
+            writeback_if_dirty(set, way);
+    }
+    for (uint16_t i = 0; i < pipe.l1d_victim.NUM_ENTRIES; ++i) {
+        if (pipe.l1d_victim.block[i].valid && pipe.l1d_victim.block[i].dirty)
+            writeback_line(pipe.l1d_victim.block[i].tag, &pipe.l1d_victim.block[i]);
+    }
+    victim_cache_destroy(&pipe.l1d_victim);
+    if (sim_config.l1d_3c)
+        destroy_miss_classifier(&pipe.l1d_3c);
+
+    cache_destroy(&pipe.l1i_cache);
+    cache_destroy(&pipe.l1d_cache);
+    destroy_bpred(&pipe.bpred);
+    destroy_ras(&pipe.ras);
+    destroy_btb(&pipe.btb);
+    if (sim_config.fe_ftq_size > 0)
+        frontend_stop();
+}
 
 uint32_t i_cache_load()
 {
+    /* translate the PC; an I-TLB miss stalls fetch for the walk. Fetch is
+     * still stalled when it retries the same PC after a walk or a miss, and
+     * the PC is then translated already. */
+    int translated = pipe.is_fetch_stalled;
+    if (pipe.is_fetch_walking) {
+        pipe.is_fetch_walking = 0;
+        pipe.is_fetch_stalled = 0;
+    }
+    if (pipe.mmu.itlb.entries && !translated) {
+        uint32_t cycles = mmu_translate(&pipe.mmu, &pipe.mmu.itlb, pipe.PC);
+        if (cycles > 0) {
+            pipe.fetch_stall = cycles - 1;
+            pipe.is_fetch_stalled = 1;
+            pipe.is_fetch_walking = 1;
+            return 0;
+        }
+    }
+    int retry = pipe.is_fetch_stalled;
+
     uint32_t l1i_cache_tag = pipe.PC >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1I_LOG2_NUM_SETS);
     uint16_t l1i_cache_set = (pipe.PC >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1I_NUM_SETS - 1);
     uint8_t l1i_cache_offset = (pipe.PC >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1);
     uint16_t l1i_cache_way = cache_get_way(&pipe.l1i_cache, l1i_cache_set, l1i_cache_tag);
 
-    /* serve L1I cache miss */
-    if (pipe.is_fetch_stalled) {
-        pipe.is_fetch_stalled = 0;
+    /* serve L1I cache miss (unless only a word of a filled line was late) */
+    if (pipe.is_fetch_stalled && l1i_cache_way == pipe.l1i_cache.NUM_WAY) {
 
         /* access main memory */
         uint32_t l1i_cache_data[BLOCK_SIZE];
@@ -794,9 +1417,21 @@ uint32_t i_cache_load()
                           l1i_cache_data);
     }
 
+    pipe.is_fetch_stalled = 0;
+    if (!retry)
+        pipe.l1i_cache.stat_accesses++;
+
     /* stall on L1I cache miss */
     if (l1i_cache_way == pipe.l1i_cache.NUM_WAY) {
-        pipe.fetch_stall = L1I_MISS_STALL_CYCLE_COUNT;
+        pipe.l1i_cache.stat_misses++;
+        profile_count(pipe.PC, PROF_ICACHE_MISSES, 1);
+        pipe.fetch_stall = line_fill_start(&pipe.l1i_fill, pipe.PC) - 1;
+        pipe.is_fetch_stalled = 1;
+        return 0;
+    }
+    /* stall until the word arrives if the line is still being filled */
+    else if (line_fill_wait(&pipe.l1i_fill, pipe.PC) > 0) {
+        pipe.fetch_stall = line_fill_wait(&pipe.l1i_fill, pipe.PC) - 1;
         pipe.is_fetch_stalled = 1;
         return 0;
     }
@@ -808,37 +1443,66 @@ uint32_t i_cache_load()
     return pipe.l1i_cache.block[l1i_cache_set][l1i_cache_way].data[l1i_cache_offset];
 }
 
+void i_cache_abandon_fill()
+{
+    uint32_t l1i_cache_tag = pipe.l1i_fill.addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1I_LOG2_NUM_SETS);
+    uint16_t l1i_cache_set = (pipe.l1i_fill.addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1I_NUM_SETS - 1);
+
+    if (pipe.is_fetch_stalled && !pipe.is_fetch_walking &&
+        cache_get_way(&pipe.l1i_cache, l1i_cache_set, l1i_cache_tag) == pipe.l1i_cache.NUM_WAY)
+        line_fill_cancel(&pipe.l1i_fill);
+}
+
+int d_tlb_translate(uint32_t mem_addr)
+{
+    if (pipe.is_mem_walking) {
+        pipe.is_mem_walking = 0;
+        pipe.is_mem_stalled = 0;
+    }
+    if (!pipe.mmu.dtlb.entries)
+        return 0;
+
+    uint32_t cycles = mmu_translate(&pipe.mmu, &pipe.mmu.dtlb, mem_addr);
+    if (cycles == 0)
+        return 0;
+
+    pipe.mem_stall = cycles - 1;
+    pipe.is_mem_stalled = 1;
+    pipe.is_mem_walking = 1;
+    return 1;
+}
+
 uint32_t d_cache_load(uint32_t mem_addr)
 {
+    if (d_tlb_translate(mem_addr))
+        return 0;
+    int retry = pipe.is_mem_stalled || pipe.mem_replay;
+    pipe.mem_replay = 0;
+
     /* L1D cache fields */
     uint32_t l1d_cache_tag = mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
     uint16_t l1d_cache_set = (mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
     uint8_t l1d_cache_offset = (mem_addr >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1);
     uint16_t l1d_cache_way = cache_get_way(&pipe.l1d_cache, l1d_cache_set, l1d_cache_tag);
 
-    /* serve L1D cache miss */
-    if (pipe.is_mem_stalled) {
-        pipe.is_mem_stalled = 0;
-        l1d_cache_way = cache_find_victim(&pipe.l1d_cache, l1d_cache_set);
-
-        /* perform writeback if block is dirty */
-        writeback_if_dirty(l1d_cache_set, l1d_cache_way);
-
-        /* access main memory */
-        uint32_t l1d_cache_data[BLOCK_SIZE];
-        uint32_t address_mask = 0xffffffff << (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE);
-        for (uint8_t index = 0; index < BLOCK_SIZE; ++index) {
-            l1d_cache_data[index] = mem_read_32((mem_addr & address_mask) + \
-                                                (index << LOG2_WORD_SIZE));
-        }
-        
-        cache_insert_data(&pipe.l1d_cache, l1d_cache_set, l1d_cache_way, l1d_cache_tag, \
-                          l1d_cache_data);
+    /* serve L1D cache miss (unless only a word of a filled line was late) */
+    if (pipe.is_mem_stalled && l1d_cache_way == pipe.l1d_cache.NUM_WAY) {
+        l1d_cache_way = d_cache_fill(mem_addr);
     }
+    pipe.is_mem_stalled = 0;
 
     /* stall on L1D cache miss */
     if (l1d_cache_way == pipe.l1d_cache.NUM_WAY) {
-        pipe.mem_stall = L1D_MISS_STALL_CYCLE_COUNT;
+        pipe.mem_stall = d_cache_miss(mem_addr, d_cache_record(mem_addr, 1)) - 1;
+        pipe.is_mem_stalled = 1;
+        return 0;
+    }
+    if (!retry)
+        d_cache_record(mem_addr, 0);
+
+    /* stall until the word arrives if the line is still being filled */
+    if (line_fill_wait(&pipe.l1d_fill, mem_addr) > 0) {
+        pipe.mem_stall = line_fill_wait(&pipe.l1d_fill, mem_addr) - 1;
         pipe.is_mem_stalled = 1;
         return 0;
     }
@@ -850,6 +1514,177 @@ uint32_t d_cache_load(uint32_t mem_addr)
     return pipe.l1d_cache.block[l1d_cache_set][l1d_cache_way].data[l1d_cache_offset];
 }
 
+int d_cache_record(uint32_t mem_addr, int miss)
+{
+    pipe.l1d_cache.stat_accesses++;
+    if (miss)
+        pipe.l1d_cache.stat_misses++;
+
+    if (!sim_config.l1d_3c)
+        return -1;
+
+    return miss_classify(&pipe.l1d_3c, mem_addr, miss);
+}
+
+void writeback_line(uint32_t line, Block *block)
+{
+    uint32_t base_address = line << (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE);
+    for (uint8_t offset = 0; offset < BLOCK_SIZE; ++offset) {
+        mem_write_32(base_address + (offset << LOG2_WORD_SIZE), block->data[offset]);
+    }
+}
+
+/* makes room in an L1D way: the block moves to the victim cache, which writes
+ * back the line it replaces if that one is dirty */
+static void d_cache_evict(uint16_t set, uint16_t way, uint16_t vc_slot)
+{
+    Block *block = &pipe.l1d_cache.block[set][way];
+
+    if (pipe.l1d_victim.NUM_ENTRIES == 0 || !block->valid) {
+        writeback_if_dirty(set, way);
+        return;
+    }
+
+    Block replaced;
+    uint32_t line = (block->tag << L1D_LOG2_NUM_SETS) | set;
+    if (victim_cache_insert(&pipe.l1d_victim, block, line, vc_slot, &replaced) && replaced.dirty)
+        writeback_line(replaced.tag, &replaced);
+}
+
+uint32_t d_cache_miss(uint32_t mem_addr, int miss_class)
+{
+    uint16_t entry = victim_cache_find(&pipe.l1d_victim, mem_addr);
+    if (entry == pipe.l1d_victim.NUM_ENTRIES) {
+        uint32_t cycles = line_fill_start(&pipe.l1d_fill, mem_addr);
+        stats_sample(pipe.stat_l1d_miss_latency, cycles);
+        return cycles;
+    }
+
+    uint32_t l1d_cache_tag = mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t l1d_cache_set = (mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint16_t l1d_cache_way = cache_find_victim(&pipe.l1d_cache, l1d_cache_set);
+
+    pipe.stat_vc_hits++;
+    if (miss_class != -1)
+        pipe.l1d_3c.stat_victim_hits[miss_class]++;
+
+    /* swap the line with the L1D victim, which takes its victim cache entry */
+    Block hit = pipe.l1d_victim.block[entry];
+    pipe.l1d_victim.block[entry].valid = 0;
+    if (pipe.l1d_cache.block[l1d_cache_set][l1d_cache_way].valid)
+        d_cache_evict(l1d_cache_set, l1d_cache_way, entry);
+
+    cache_insert_data(&pipe.l1d_cache, l1d_cache_set, l1d_cache_way, l1d_cache_tag, hit.data);
+    pipe.l1d_cache.block[l1d_cache_set][l1d_cache_way].dirty = hit.dirty;
+
+    stats_sample(pipe.stat_l1d_miss_latency, sim_config.vc_latency);
+    return sim_config.vc_latency;
+}
+
+uint16_t d_cache_fill(uint32_t mem_addr)
+{
+    uint32_t l1d_cache_tag = mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t l1d_cache_set = (mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint16_t l1d_cache_way = cache_find_victim(&pipe.l1d_cache, l1d_cache_set);
+
+    /* move the victim to the victim cache, or write it back if it is dirty */
+    d_cache_evict(l1d_cache_set, l1d_cache_way, pipe.l1d_victim.NUM_ENTRIES);
+
+    /* access main memory */
+    uint32_t l1d_cache_data[BLOCK_SIZE];
+    uint32_t address_mask = 0xffffffff << (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE);
+    for (uint8_t index = 0; index < BLOCK_SIZE; ++index) {
+        l1d_cache_data[index] = mem_read_32((mem_addr & address_mask) + \
+                                            (index << LOG2_WORD_SIZE));
+    }
+
+    cache_insert_data(&pipe.l1d_cache, l1d_cache_set, l1d_cache_way, l1d_cache_tag, \
+                      l1d_cache_data);
+
+    return l1d_cache_way;
+}
+
+int pipe_write_store(Store_Buffer_Entry *entry, int fill)
+{
+    uint32_t l1d_cache_tag = entry->addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t l1d_cache_set = (entry->addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint8_t l1d_cache_offset = (entry->addr >> LOG2_WORD_SIZE) & (BLOCK_SIZE - 1);
+    uint16_t l1d_cache_way = cache_get_way(&pipe.l1d_cache, l1d_cache_set, l1d_cache_tag);
+
+    if (l1d_cache_way == pipe.l1d_cache.NUM_WAY) {
+        if (!fill)
+            return 0;
+        l1d_cache_way = d_cache_fill(entry->addr);
+    }
+    cache_update_lru_state(&pipe.l1d_cache, l1d_cache_set, l1d_cache_way);
+
+    Block *block = &pipe.l1d_cache.block[l1d_cache_set][l1d_cache_way];
+    block->data[l1d_cache_offset] = store_buffer_merge(block->data[l1d_cache_offset],
+                                                       entry->data, entry->mask);
+    block->dirty = 1;
+
+    return 1;
+}
+
+void pipe_drain_store_buffer()
+{
+    /* a drain miss blocks the dcache until its block has been filled */
+    if (pipe.sb.fill_active) {
+        if (pipe.sb.fill_cycles > 0) {
+            pipe.sb.fill_cycles--;
+            return;
+        }
+        pipe_write_store(store_buffer_head(&pipe.sb), 1);
+        store_buffer_pop(&pipe.sb);
+        pipe.sb.fill_active = 0;
+        return;
+    }
+
+    /* the port is taken by a load, or a load miss is being served */
+    if (pipe.sb.count == 0 || pipe.dcache_port_used || pipe.mem_stall > 0 || pipe.is_mem_stalled)
+        return;
+
+    /* the word is still on its way from memory */
+    if (line_fill_wait(&pipe.l1d_fill, store_buffer_head(&pipe.sb)->addr) > 0)
+        return;
+
+    if (pipe_write_store(store_buffer_head(&pipe.sb), 0)) {
+        d_cache_record(store_buffer_head(&pipe.sb)->addr, 0);
+        store_buffer_pop(&pipe.sb);
+    }
+    else {
+        pipe.sb.fill_active = 1;
+        uint32_t addr = store_buffer_head(&pipe.sb)->addr;
+        pipe.sb.fill_cycles = d_cache_miss(addr, d_cache_record(addr, 1)) - 1;
+        pipe.sb.stat_drain_misses++;
+        profile_count(store_buffer_head(&pipe.sb)->pc, PROF_DCACHE_MISSES, 1);
+    }
+}
+
+uint32_t d_cache_walk_access(uint32_t mem_addr, uint32_t cycles)
+{
+    uint32_t l1d_cache_tag = mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + L1D_LOG2_NUM_SETS);
+    uint16_t l1d_cache_set = (mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (L1D_NUM_SETS - 1);
+    uint16_t l1d_cache_way = cache_get_way(&pipe.l1d_cache, l1d_cache_set, l1d_cache_tag);
+    uint32_t ready;
+
+    /* a miss fills the line after any fill in progress, unless it is found
+     * in the victim cache */
+    if (l1d_cache_way == pipe.l1d_cache.NUM_WAY) {
+        ready = d_cache_miss(mem_addr, d_cache_record(mem_addr, 1));
+        l1d_cache_way = cache_get_way(&pipe.l1d_cache, l1d_cache_set, l1d_cache_tag);
+        if (l1d_cache_way == pipe.l1d_cache.NUM_WAY)
+            l1d_cache_way = d_cache_fill(mem_addr);
+    }
+    else {
+        d_cache_record(mem_addr, 0);
+        ready = line_fill_wait(&pipe.l1d_fill, mem_addr);
+    }
+    cache_update_lru_state(&pipe.l1d_cache, l1d_cache_set, l1d_cache_way);
+
+    return cycles + 1 > ready ? cycles + 1 : ready;
+}
+
 void d_cache_store(uint32_t mem_addr, uint32_t data)
 {
     /* L1D cache fields */
@@ -879,19 +1714,9 @@ void writeback_if_dirty(uint16_t set, uint16_t way)
 
 void init_branch_pred()
 {
-    init_gshare(&pipe.gshare_predictor);
-
-    for (int i = 0; i < BTB_SIZE; ++i) {
-        pipe.BTB[i].address = 0;
-        pipe.BTB[i].branch_target = 0;
-        pipe.BTB[i].valid = 0;
-        pipe.BTB[i].is_unconditional = 0;
-    }
-}
-
-uint32_t get_btb_index(uint32_t PC)
-{
-    return ((PC >> 2) & (BTB_SIZE - 1));
+    init_bpred(&pipe.bpred, sim_config.bp);
+    init_ras(&pipe.ras, sim_config.ras_depth);
+    init_btb(&pipe.btb);
 }
 
 uint32_t predict_next_PC(Pipe_Op *op)
@@ -900,18 +1725,45 @@ uint32_t predict_next_PC(Pipe_Op *op)
     op->predicted_branch_taken = 0;
     op->predicted_is_branch = 0;
     
-    uint32_t btb_index = get_btb_index(pipe.PC);
-    uint32_t pht_index = get_pht_index(&pipe.gshare_predictor, pipe.PC);
+    int bubble;
+    BTB_Entry *btb_entry = btb_lookup(&pipe.btb, pipe.PC, &bubble);
+    int predict_taken = bpred_predict(&pipe.bpred, pipe.PC, &op->bpred_info);
 
-    if ((pipe.BTB[btb_index].address == pipe.PC) && pipe.BTB[btb_index].valid) {
+    if (btb_entry) {
         op->predicted_is_branch = 1;
         
-        if (pipe.BTB[btb_index].is_unconditional || (pipe.gshare_predictor.PHT[pht_index] > 1)) {
-            next_PC = pipe.BTB[btb_index].branch_target;
+        if (btb_entry->is_unconditional || predict_taken) {
+            next_PC = btb_entry->branch_target;
             op->predicted_branch_taken = 1;
+            pipe.btb_bubble = bubble;
         }
     }
 
+    /* returns take their target from the return address stack; calls push
+     * their return address if they are predicted taken */
+    if (pipe.ras.depth > 0) {
+        op->ras_type = ras_classify(op->instruction);
+        ras_save(&pipe.ras, &op->ras_checkpoint);
+
+        if (op->ras_type == RAS_RETURN && pipe.ras.count > 0) {
+            next_PC = ras_pop(&pipe.ras);
+            op->predicted_is_branch = 1;
+            op->predicted_branch_taken = 1;
+            op->ras_predicted = 1;
+        }
+        else if (op->ras_type == RAS_CALL &&
+                 (op->predicted_branch_taken || ((op->instruction >> 26) & 0x3F) != OP_BRSPEC)) {
+            ras_push(&pipe.ras, pipe.PC + 4);
+        }
+    }
+
+    /* speculative history: shift in the direction that fetch follows */
+    if (pipe.bpred.speculative) {
+        bpred_save_history(&pipe.bpred, &op->bpred_history);
+        if (bpred_is_cond_branch(op->instruction))
+            bpred_update_history(&pipe.bpred, op->predicted_branch_taken);
+    }
+
     op->predicted_branch_dest = next_PC;
 
     return next_PC;
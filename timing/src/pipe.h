@@ -12,10 +12,33 @@
 #include "shell.h"
 #include "block.h"
 #include "cache.h"
-#include "gshare.h"
-#include "btb_entry.h"
-
-#define BTB_SIZE 1024
+#include "bpred.h"
+#include "btb.h"
+#include "ras.h"
+#include "store_buffer.h"
+#include "tlb.h"
+#include "miss_class.h"
+#include "stats.h"
+
+#define PIPE_MAX_SUBSTAGES 8  /* cycles per stage (see --pipe-*-stages) */
+
+#define MULT_LATENCY 4
+#define DIV_LATENCY 32
+
+/* causes to which the CPI stack attributes every cycle */
+enum {
+    CPI_BASE,         /* an instruction retired */
+    CPI_ICACHE,       /* I-cache miss or I-TLB walk */
+    CPI_DCACHE,       /* D-cache miss, D-TLB walk or full store buffer */
+    CPI_LOAD_USE,     /* load-use interlock in execute */
+    CPI_MULDIV,       /* busy multiply/divide unit or HI/LO not ready */
+    CPI_MISPREDICT,   /* refilling the pipeline after a branch mispredict */
+    CPI_FRONTEND,     /* other front-end bubbles (BTB bubbles, pipeline fill) */
+    CPI_NUM_CAUSES
+};
+
+/* short names of the causes, as used in CSV headers */
+extern const char *cpi_cause_names[CPI_NUM_CAUSES];
 
 /* Pipeline ops (instances of this structure) are high-level representations of
  * the instructions that actually flow through the pipeline. This struct does
@@ -53,6 +76,12 @@ typedef struct Pipe_Op {
     uint32_t reg_dst_value; /* value to write into dest reg. */
     int reg_dst_value_ready; /* destination value produced yet? */
 
+    /* HI/LO access information */
+    int is_muldiv;              /* multiply/divide (uses the multiplier)? */
+    int reads_hi, reads_lo;     /* MFHI/MFLO */
+    int writes_hi, writes_lo;   /* MULT(U)/DIV(U), MTHI/MTLO */
+    uint32_t hi_value, lo_value; /* value read from or to be written to HI/LO */
+
     /* branch information */
     int is_branch;        /* is this a branch? */
     uint32_t branch_dest; /* branch destination (if taken) */
@@ -64,6 +93,15 @@ typedef struct Pipe_Op {
     int predicted_is_branch;
     uint32_t predicted_branch_dest;
     int predicted_branch_taken;
+    Bpred_Info bpred_info;  /* direction predictor state at fetch */
+    Bpred_History bpred_history; /* global history before this op was fetched */
+    int ras_type;           /* RAS_CALL, RAS_RETURN or RAS_NONE */
+    int ras_predicted;      /* target predicted by the return address stack? */
+    RAS_Checkpoint ras_checkpoint; /* return address stack state at fetch */
+
+    /* cycles this op was held up by each cause (CPI stack) */
+    uint32_t cpi_stall[CPI_NUM_CAUSES];
+    int cpi_after_flush;  /* first op fetched after a mispredict? */
 
 } Pipe_Op;
 
@@ -80,6 +118,15 @@ typedef struct Pipe_State {
     /* pipe op currently at the input of the given stage (NULL for none) */
     Pipe_Op *decode_op, *execute_op, *mem_op, *wb_op;
 
+    /* Stages with more than one sub-stage place their output in the first of
+     * their latches; an op moves one latch further every cycle and leaves the
+     * last one for the next stage's input. Decode, execute and memory do
+     * their work in their first sub-stage. */
+    Pipe_Op *fetch_latch[PIPE_MAX_SUBSTAGES - 1];
+    Pipe_Op *decode_latch[PIPE_MAX_SUBSTAGES - 1];
+    Pipe_Op *execute_latch[PIPE_MAX_SUBSTAGES - 1];
+    Pipe_Op *mem_latch[PIPE_MAX_SUBSTAGES - 1];
+
     /* register file state */
     uint32_t REGS[32];
     uint32_t HI, LO;
@@ -94,8 +141,17 @@ typedef struct Pipe_State {
     uint32_t branch_dest; /* next fetch will be from this PC */
     int branch_flush; /* how many stages to flush during recover? (1 = fetch, 2 = fetch/decode, ...) */
 
-    /* multiplier stall info */
-    int multiplier_stall; /* number of remaining cycles until HI/LO are ready */
+    /* set while the pipeline drains before a switch to functional
+     * simulation: no new instructions are fetched */
+    int fetch_stopped;
+
+    /* multiply/divide unit: remaining cycles until in-flight results are
+     * written to HI and LO (scoreboard), and until the multiplier and the
+     * divider accept a new op */
+    int hi_stall, lo_stall;
+    int mul_busy, div_busy;
+    uint64_t stat_hilo_stalls;      /* cycles MFHI/MFLO waited for a result */
+    uint64_t stat_muldiv_busy;      /* cycles a multiply/divide waited for its unit */
 
     /* place other information here as necessary */
 
@@ -103,14 +159,44 @@ typedef struct Pipe_State {
     Cache l1i_cache, l1d_cache;
 
     /* cache stall info */
-    uint8_t fetch_stall;  // fetch stall on I-Cache miss
+    int fetch_stall;      // fetch stall on I-Cache miss
     uint8_t is_fetch_stalled;
-    uint8_t mem_stall;    // memory stall on D-Cache miss
+    int mem_stall;        // memory stall on D-Cache miss
     uint8_t is_mem_stalled;
+    Line_Fill l1i_fill, l1d_fill; // line fill in progress (or last one)
+
+    /* lines evicted from the L1D, and the 3C classification of its misses */
+    Victim_Cache l1d_victim;
+    uint64_t stat_vc_hits;
+    Stat_Histogram *stat_l1d_miss_latency;
+    Miss_Classifier l1d_3c;
+    uint8_t mem_replay;   // the next access repeats one that was recorded
+
+    /* address translation; the stall flags above are also set while a TLB
+     * miss is being served, in which case these are set as well */
+    MMU mmu;
+    uint8_t is_fetch_walking, is_mem_walking;
+
+    /* stores wait here for the L1D, which has a single port */
+    Store_Buffer sb;
+    int dcache_port_used; // accessed by the memory stage this cycle
 
     /* branch predictor info */
-    Gshare gshare_predictor;
-    BTB_Entry BTB[BTB_SIZE];
+    Branch_Predictor bpred;
+    BTB btb;
+    int btb_bubble;       // fetch bubble after a taken L1 BTB prediction
+    RAS ras;
+    RAS_Checkpoint branch_ras; /* RAS state to restore during branch recovery */
+    Bpred_History branch_history; /* history to restore during branch recovery */
+    int branch_outcome;   /* outcome of the mispredicted branch, -1 if not conditional */
+
+    /* CPI stack. The cycles between two retirements are charged to the
+     * stalls of the younger op; fetch stalls are charged to the next op
+     * to be fetched. */
+    uint32_t cpi_pending[CPI_NUM_CAUSES];
+    int cpi_after_flush;
+    uint64_t cpi_next_cycle;  // cycle after the last retirement
+    uint64_t stat_cpi[CPI_NUM_CAUSES];
 
 } Pipe_State;
 
@@ -135,29 +221,134 @@ void pipe_stage_execute();
 void pipe_stage_mem();
 void pipe_stage_wb();
 
+/* charges the cycles since the previous retirement to the causes that held
+ * up the retiring op, and the current cycle to CPI_BASE. Later calls within
+ * the same cycle do nothing. */
+void pipe_cpi_retire(Pipe_Op *op);
+
+/* fills stack with the cycles attributed to each cause so far, including the
+ * cycles since the last retirement */
+void pipe_cpi_stack(uint64_t *stack);
+
+/* prints the CPI stack as CSV */
+void pipe_cpi_print();
+
+/* appends a retired op to the instruction trace */
+void pipe_trace_op(Pipe_Op *op);
+
+/* stops fetching new instructions so that the ones in flight drain */
+void pipe_stop_fetch();
+
+/* returns 1 once no instruction, store or line fill is in flight; pipe.PC is
+ * then the next instruction to execute */
+int pipe_drained();
+
+/* restarts fetch at pipe.PC, which functional simulation may have moved */
+void pipe_resume_fetch();
+
 /* called when RUN_BIT is set to 0; frees all structures */
 void pipe_stop();
 
+/* allocates a new op for the instruction fetched from the given PC */
+Pipe_Op *pipe_alloc_op(uint32_t pc, uint32_t instruction);
+
+/* fills in the decoded fields (registers, immediates, branch info) of an op */
+void pipe_decode_op(Pipe_Op *op);
+
+/* computes the results of an op whose source values (including HI/LO) have
+ * been read. Does not touch any pipeline state. */
+void pipe_execute_op(Pipe_Op *op);
+
+/* returns the number of cycles until the results of the op are available */
+int pipe_op_latency(Pipe_Op *op);
+
+/* returns the cycles for which a multiply/divide keeps its unit busy */
+int pipe_muldiv_busy_cycles(Pipe_Op *op);
+
+/* returns 1 for MULT/MULTU (multiplier), 0 for DIV/DIVU (divider) */
+int pipe_is_mul(Pipe_Op *op);
+
+/* returns the register value of a load, given the word read from memory */
+uint32_t pipe_load_extract(Pipe_Op *op, uint32_t word);
+
+/* returns the word to be written by a store, given the old word in memory */
+uint32_t pipe_store_merge(Pipe_Op *op, uint32_t word);
+
+/* returns the bytes of its word that a memory op accesses, as a 4-bit mask */
+uint8_t pipe_mem_byte_mask(Pipe_Op *op);
+
+/* returns 1 if the resolved branch was mispredicted in fetch */
+int pipe_branch_mispredicted(Pipe_Op *op);
+
+/* trains the direction predictor and BTB with a resolved branch */
+void pipe_update_branch_pred(Pipe_Op *op);
+
 /* accesses icache and returns the next instruction.
    On a miss, sets is_fetch_stalled and returns 0. */
 uint32_t i_cache_load();
 
+/* drops the icache fill that fetch is waiting for, if its line has not been
+ * installed yet (fetch was redirected) */
+void i_cache_abandon_fill();
+
+/* translates a data address; on a D-TLB miss, sets the memory stall for the
+ * walk (along with is_mem_stalled) and returns 1 */
+int d_tlb_translate(uint32_t mem_addr);
+
 /* accesses dcache and returns the requested data.
  * On a miss, sets is_mem_stalled and returns 0. */
 uint32_t d_cache_load(uint32_t mem_addr);
 
+/* handles an L1D miss to mem_addr, given its 3C class (-1 if not
+ * classified): a line found in the victim cache is moved into the L1D right
+ * away; otherwise a line fill is started. Returns the cycles until the
+ * access can restart. */
+uint32_t d_cache_miss(uint32_t mem_addr, int miss_class);
+
+/* counts an L1D access and, with --l1d-3c, classifies it; returns the class
+ * of the miss or -1 */
+int d_cache_record(uint32_t mem_addr, int miss);
+
+/* fills the block containing mem_addr from memory (moving the victim to the
+ * victim cache, or writing it back if it is dirty) and returns its way */
+uint16_t d_cache_fill(uint32_t mem_addr);
+
+/* writes a store buffer entry into its dcache block. Returns 0 if the block
+ * is not present, unless fill is set, in which case it is filled first. */
+int pipe_write_store(Store_Buffer_Entry *entry, int fill);
+
+/* writes the oldest store buffer entry into the dcache when the port is
+ * free, filling its block on a miss */
+void pipe_drain_store_buffer();
+
+/* reads a page table entry for the page walker, given the cycles the walk
+ * has taken so far, and returns the cycles after which the entry is read */
+uint32_t d_cache_walk_access(uint32_t mem_addr, uint32_t cycles);
+
 /* write the given data into corresponding cache block */
 void d_cache_store(uint32_t mem_addr, uint32_t data);
 
 /* performs writeback for the given block if it is dirty */
 void writeback_if_dirty(uint16_t set, uint16_t way);
 
+/* writes a block back to memory, given its line address (the address
+ * shifted right by the line size) */
+void writeback_line(uint32_t line, Block *block);
+
+/* returns the slot in which a stage with the given number of sub-stages
+ * places its output: its first latch, or the next stage's input */
+Pipe_Op **pipe_stage_output(Pipe_Op **latches, int stages, Pipe_Op **next);
+
+/* moves ops one latch further, and the op in the last latch to next if it
+ * is empty */
+void pipe_advance_latches(Pipe_Op **latches, int stages, Pipe_Op **next);
+
+/* frees the ops in a stage's latches */
+void pipe_flush_latches(Pipe_Op **latches, int stages);
+
 /* initializes all branch prediction info */
 void init_branch_pred();
 
-/* returns BTB index for the given PC */
-uint32_t get_btb_index(uint32_t PC);
-
 /* performs branch prediction, updates prediction info in op, and returns the next PC value */
 uint32_t predict_next_PC(Pipe_Op *op);
 
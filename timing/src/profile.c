@@ -0,0 +1,230 @@
+#include "profile.h"
+#include "disasm.h"
+#include "shell.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Profile profile;
+
+static const char *counter_names[PROF_NUM_COUNTERS] = {
+    "executed", "icache", "dcache", "mispred", "stalls", "memstall"
+};
+
+void init_profile(uint32_t text_start, uint32_t text_size, int num_counters, int sort_counter,
+                  int top, const char *filename)
+{
+    profile.text_start = text_start;
+    profile.num_words = text_size / 4;
+    profile.num_counters = num_counters;
+    profile.counts = calloc(profile.num_words, sizeof(*profile.counts));
+    profile.source = NULL;
+    profile.sort_counter = sort_counter < num_counters ? sort_counter : PROF_EXECUTED;
+    profile.top = top;
+    profile.filename = filename;
+
+    atexit(profile_finish);
+}
+
+/* returns the number of words the assembler emits for an instruction */
+static int source_words(const char *mnemonic, const char *operands)
+{
+    if (strcmp(mnemonic, "la") == 0)
+        return 2;
+
+    /* li takes a single ORI or ADDIU if the value fits in 16 bits */
+    if (strcmp(mnemonic, "li") == 0) {
+        const char *value = strchr(operands, ',');
+        if (value == NULL)
+            return 1;
+        long v = strtol(value + 1, NULL, 0);
+        return v >= -32768 && v <= 0xFFFF ? 1 : 2;
+    }
+
+    return 1;
+}
+
+static void free_source()
+{
+    if (profile.source == NULL)
+        return;
+
+    for (uint32_t i = 0; i < profile.num_words; ++i)
+        free(profile.source[i]);
+    free(profile.source);
+    profile.source = NULL;
+}
+
+void profile_load_source(const char *program_filename, int num_words)
+{
+    if (profile.num_words == 0)
+        return;
+
+    /* a program loaded later overwrites the text of earlier ones */
+    free_source();
+
+    size_t len = strlen(program_filename);
+    if (len < 2 || strcmp(program_filename + len - 2, ".x") != 0)
+        return;
+    char *filename = strdup(program_filename);
+    filename[len - 1] = 's';
+    FILE *in = fopen(filename, "r");
+    if (in == NULL) {
+        free(filename);
+        return;
+    }
+    const char *basename = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+
+    profile.source = calloc(profile.num_words, sizeof(char *));
+
+    char line[256];
+    int line_number = 0, in_data = 0, word = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        /* skip labels and leading blanks */
+        char *text = line;
+        for (;;) {
+            while (isspace((unsigned char) *text))
+                text++;
+            char *end = text;
+            while (isalnum((unsigned char) *end) || *end == '_' || *end == '.')
+                end++;
+            if (end == text || *end != ':')
+                break;
+            text = end + 1;
+        }
+        char *end = text + strlen(text);
+        while (end > text && isspace((unsigned char) end[-1]))
+            *--end = '\0';
+
+        if (*text == '\0')
+            continue;
+        if (*text == '.') {
+            if (strncmp(text, ".data", 5) == 0 || strncmp(text, ".kdata", 6) == 0)
+                in_data = 1;
+            else if (strncmp(text, ".text", 5) == 0 || strncmp(text, ".ktext", 6) == 0)
+                in_data = 0;
+            continue;
+        }
+        if (in_data)
+            continue;
+
+        char mnemonic[16];
+        int n = 0;
+        while (text[n] && !isspace((unsigned char) text[n]) && n < (int) sizeof(mnemonic) - 1) {
+            mnemonic[n] = text[n];
+            n++;
+        }
+        mnemonic[n] = '\0';
+
+        for (int w = source_words(mnemonic, text + n); w > 0; --w, ++word) {
+            if (word >= num_words)
+                continue;
+            size_t size = strlen(basename) + strlen(text) + 16;
+            profile.source[word] = malloc(size);
+            snprintf(profile.source[word], size, "%s:%d: %s", basename, line_number, text);
+        }
+    }
+    fclose(in);
+
+    /* SPIM puts its startup code in front of the program */
+    if (word < num_words) {
+        int offset = num_words - word;
+        memmove(profile.source + offset, profile.source, word * sizeof(char *));
+        memset(profile.source, 0, offset * sizeof(char *));
+    }
+
+    /* more lines than words: not the source of this program, or it uses
+     * pseudo-instructions we do not know */
+    if (word > num_words) {
+        printf("Profile: %s does not match %s; reporting without source lines\n\n", filename,
+               program_filename);
+        free_source();
+    }
+    free(filename);
+}
+
+/* orders rows by the sort counter, largest first, then by PC */
+static int profile_compare(const void *a, const void *b)
+{
+    uint64_t ca = profile.counts[*(const uint32_t *) a][profile.sort_counter];
+    uint64_t cb = profile.counts[*(const uint32_t *) b][profile.sort_counter];
+    if (ca != cb)
+        return ca > cb ? -1 : 1;
+    return *(const uint32_t *) a < *(const uint32_t *) b ? -1 : 1;
+}
+
+void profile_finish()
+{
+    if (profile.num_words == 0)
+        return;
+
+    FILE *out = stdout;
+    if (profile.filename[0] != '\0') {
+        out = fopen(profile.filename, "w");
+        if (out == NULL) {
+            printf("Error: cannot open %s for writing\n", profile.filename);
+            out = stdout;
+        }
+    }
+
+    /* rows of the instructions with any counts */
+    uint32_t *rows = malloc(profile.num_words * sizeof(uint32_t));
+    uint32_t num_rows = 0;
+    uint64_t totals[PROF_NUM_COUNTERS] = { 0 };
+    for (uint32_t i = 0; i < profile.num_words; ++i) {
+        int used = 0;
+        for (int c = 0; c < profile.num_counters; ++c) {
+            totals[c] += profile.counts[i][c];
+            used |= profile.counts[i][c] != 0;
+        }
+        if (used)
+            rows[num_rows++] = i;
+    }
+    qsort(rows, num_rows, sizeof(uint32_t), profile_compare);
+
+    int sort = profile.sort_counter;
+    fprintf(out, "Profile: %u instructions, sorted by %s\n", num_rows, counter_names[sort]);
+    fprintf(out, "%-10s", "pc");
+    for (int c = 0; c < profile.num_counters; ++c)
+        fprintf(out, " %10s", counter_names[c]);
+    fprintf(out, " %7s %7s  %-30s %s\n", "%", "cum%", "instruction", "source");
+
+    uint64_t cumulative = 0;
+    uint32_t shown = profile.top > 0 && (uint32_t) profile.top < num_rows ? profile.top : num_rows;
+    for (uint32_t r = 0; r < shown; ++r) {
+        uint32_t i = rows[r];
+        uint32_t pc = profile.text_start + 4 * i;
+        char text[64];
+        mips_disassemble(pc, mem_read_32(pc), text, sizeof(text));
+
+        cumulative += profile.counts[i][sort];
+        fprintf(out, "0x%08x", pc);
+        for (int c = 0; c < profile.num_counters; ++c)
+            fprintf(out, " %10" PRIu64, profile.counts[i][c]);
+        fprintf(out, " %6.2f%% %6.2f%%  %-30s %s\n",
+                totals[sort] ? 100.0 * profile.counts[i][sort] / totals[sort] : 0.0,
+                totals[sort] ? 100.0 * cumulative / totals[sort] : 0.0, text,
+                profile.source && profile.source[i] ? profile.source[i] : "");
+    }
+
+    fprintf(out, "%-10s", "total");
+    for (int c = 0; c < profile.num_counters; ++c)
+        fprintf(out, " %10" PRIu64, totals[c]);
+    fprintf(out, "\n");
+
+    if (out != stdout)
+        fclose(out);
+    free(rows);
+    free_source();
+    free(profile.counts);
+    profile.counts = NULL;
+    profile.num_words = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+
+/* per-PC counters; the functional simulator only keeps PROF_EXECUTED */
+enum {
+    PROF_EXECUTED,          /* retired instances */
+    PROF_ICACHE_MISSES,     /* L1I misses fetching this instruction */
+    PROF_DCACHE_MISSES,     /* L1D misses of this load or store */
+    PROF_MISPREDICTS,       /* recoveries caused by this branch */
+    PROF_STALL_CYCLES,      /* non-retiring cycles charged to it (CPI stack) */
+    PROF_MEM_STALL_CYCLES,  /* of which D-cache stalls */
+    PROF_NUM_COUNTERS
+};
+
+/* Profile of the static instructions in the text segment, one row of
+ * counters per word. */
+typedef struct Profile {
+    uint32_t text_start;
+    uint32_t num_words;         /* 0 while profiling is off */
+    int num_counters;           /* counters kept (and reported) */
+    uint64_t (*counts)[PROF_NUM_COUNTERS];
+
+    /* "file.s:line: text" of each word, when the source could be matched */
+    char **source;
+
+    /* report */
+    int sort_counter;
+    int top;                    /* rows reported (0 = all) */
+    const char *filename;       /* "" = stdout */
+} Profile;
+
+/* global variable -- the profile */
+extern Profile profile;
+
+/* Starts profiling the text segment. num_counters is the number of leading
+ * PROF_* counters the simulator keeps. The report is written when the
+ * simulator exits. */
+void init_profile(uint32_t text_start, uint32_t text_size, int num_counters, int sort_counter,
+                  int top, const char *filename);
+
+/* matches the words loaded from a .x program file with the lines of the .s
+ * file next to it (if there is one) */
+void profile_load_source(const char *program_filename, int num_words);
+
+/* adds n to a counter of the instruction at pc */
+static inline void profile_count(uint32_t pc, int counter, uint64_t n)
+{
+    uint32_t index = (pc - profile.text_start) >> 2;
+    if (index < profile.num_words)
+        profile.counts[index][counter] += n;
+}
+
+/* writes the report, sorted by the sort counter, and stops profiling */
+void profile_finish();
+
+#endif
@@ -0,0 +1,100 @@
+#include "ras.h"
+#include "mips.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void init_ras(RAS *ras, int depth)
+{
+    ras->depth = depth;
+    ras->tos = 0;
+    ras->count = 0;
+    ras->entries = (uint32_t*) calloc(depth > 0 ? depth : 1, sizeof(uint32_t));
+    ras->stat_returns = ras->stat_predictions = ras->stat_correct = 0;
+}
+
+void destroy_ras(RAS *ras)
+{
+    free(ras->entries);
+}
+
+int ras_classify(uint32_t instruction)
+{
+    uint32_t opcode = (instruction >> 26) & 0x3F;
+    uint32_t rs = (instruction >> 21) & 0x1F;
+    uint32_t rt = (instruction >> 16) & 0x1F;
+    uint32_t funct = instruction & 0x3F;
+
+    if (opcode == OP_JAL)
+        return RAS_CALL;
+    if (opcode == OP_SPECIAL && funct == SUBOP_JALR)
+        return RAS_CALL;
+    if (opcode == OP_BRSPEC && (rt == BROP_BGEZAL || rt == BROP_BLTZAL))
+        return RAS_CALL;
+    if (opcode == OP_SPECIAL && funct == SUBOP_JR && rs == 31)
+        return RAS_RETURN;
+
+    return RAS_NONE;
+}
+
+void ras_push(RAS *ras, uint32_t return_addr)
+{
+    ras->tos = (ras->tos + 1) % ras->depth;
+    ras->entries[ras->tos] = return_addr;
+    if (ras->count < ras->depth)
+        ras->count++;
+}
+
+uint32_t ras_pop(RAS *ras)
+{
+    uint32_t return_addr = ras->entries[ras->tos];
+    ras->tos = (ras->tos + ras->depth - 1) % ras->depth;
+    ras->count--;
+
+    return return_addr;
+}
+
+void ras_save(RAS *ras, RAS_Checkpoint *cp)
+{
+    cp->tos = ras->tos;
+    cp->count = ras->count;
+    cp->top = ras->entries[ras->tos];
+}
+
+RAS_Checkpoint ras_resolve(RAS *ras, RAS_Checkpoint *fetch_cp, int type, int taken,
+                           uint32_t return_addr)
+{
+    RAS_Checkpoint cp = *fetch_cp;
+
+    if (type == RAS_CALL && taken) {
+        cp.tos = (cp.tos + 1) % ras->depth;
+        cp.top = return_addr;
+        if (cp.count < ras->depth)
+            cp.count++;
+    }
+    else if (type == RAS_RETURN && cp.count > 0) {
+        cp.tos = (cp.tos + ras->depth - 1) % ras->depth;
+        cp.top = ras->entries[cp.tos];
+        cp.count--;
+    }
+
+    return cp;
+}
+
+void ras_restore(RAS *ras, RAS_Checkpoint *cp)
+{
+    ras->tos = cp->tos;
+    ras->count = cp->count;
+    ras->entries[ras->tos] = cp->top;
+}
+
+void ras_register_stats(RAS *ras)
+{
+    stats_register_constant("RASDepth", ras->depth, "return address stack entries");
+    stats_register_counter("Returns", &ras->stat_returns, "resolved returns");
+    stats_register_counter("RASPredictions", &ras->stat_predictions,
+                           "returns predicted from the stack");
+    stats_register_counter("RASCorrect", &ras->stat_correct, "correctly predicted returns");
+    stats_register_formula("RASAccuracy", &ras->stat_correct, NULL, &ras->stat_predictions, 1.0,
+                           "return prediction accuracy");
+}
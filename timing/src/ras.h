@@ -0,0 +1,64 @@
+#ifndef _RAS_H_
+#define _RAS_H_
+
+#include <stdint.h>
+
+#define RAS_DEPTH 0     /* disabled by default */
+
+/* instruction classes seen by the return address stack */
+#define RAS_NONE   0
+#define RAS_CALL   1    /* JAL, JALR, BGEZAL, BLTZAL */
+#define RAS_RETURN 2    /* JR $31 */
+
+/* State needed to repair the stack after a misprediction: the top-of-stack
+ * pointer and the entry it points to. */
+typedef struct RAS_Checkpoint {
+    int tos;
+    int count;
+    uint32_t top;
+} RAS_Checkpoint;
+
+/* Circular return address stack. Pushing onto a full stack overwrites the
+ * oldest entry. */
+typedef struct RAS {
+    int depth;
+    int tos;                /* index of the top entry */
+    int count;              /* number of valid entries */
+    uint32_t *entries;
+
+    /* statistics */
+    uint64_t stat_returns;      /* resolved returns */
+    uint64_t stat_predictions;  /* returns predicted from the stack */
+    uint64_t stat_correct;      /* of which the target was right */
+} RAS;
+
+/* allocates the stack */
+void init_ras(RAS *ras, int depth);
+
+/* frees the stack */
+void destroy_ras(RAS *ras);
+
+/* returns RAS_CALL, RAS_RETURN or RAS_NONE for the raw instruction */
+int ras_classify(uint32_t instruction);
+
+/* pushes a return address */
+void ras_push(RAS *ras, uint32_t return_addr);
+
+/* pops and returns the top return address; the stack must not be empty */
+uint32_t ras_pop(RAS *ras);
+
+/* records the current state of the stack */
+void ras_save(RAS *ras, RAS_Checkpoint *cp);
+
+/* returns the state after an instruction of the given class resolved,
+ * starting from the state saved when it was fetched */
+RAS_Checkpoint ras_resolve(RAS *ras, RAS_Checkpoint *fetch_cp, int type, int taken,
+                           uint32_t return_addr);
+
+/* puts the stack back into a saved state */
+void ras_restore(RAS *ras, RAS_Checkpoint *cp);
+
+/* registers return prediction accuracy */
+void ras_register_stats(RAS *ras);
+
+#endif
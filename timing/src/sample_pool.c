@@ -0,0 +1,137 @@
+#include "sample_pool.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* makes room for the result of sample id */
+static void sample_pool_grow(Sample_Pool *pool, int id)
+{
+    if (id < pool->max_samples)
+        return;
+
+    int old = pool->max_samples;
+    while (pool->max_samples <= id)
+        pool->max_samples = pool->max_samples ? 2 * pool->max_samples : 256;
+    pool->results = realloc(pool->results, pool->max_samples * sizeof(Sample_Result));
+    pool->done = realloc(pool->done, pool->max_samples);
+    memset(&pool->results[old], 0, (pool->max_samples - old) * sizeof(Sample_Result));
+    memset(&pool->done[old], 0, pool->max_samples - old);
+}
+
+void init_sample_pool(Sample_Pool *pool, int max_workers)
+{
+    memset(pool, 0, sizeof(Sample_Pool));
+    if (max_workers < 0) {
+        printf("Error: the number of sample workers cannot be negative\n");
+        exit(-1);
+    }
+    pool->max_workers = max_workers;
+    if (max_workers == 0)
+        return;
+
+    pool->worker_pid = calloc(max_workers, sizeof(int));
+    pool->worker_sample = calloc(max_workers, sizeof(int));
+    pool->shared = mmap(NULL, max_workers * sizeof(Sample_Result), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pool->shared == MAP_FAILED) {
+        printf("Error: cannot allocate shared memory for sample workers\n");
+        exit(-1);
+    }
+    pool->num_stats = stats_num_values();
+    pool->stats = calloc(pool->num_stats, sizeof(uint64_t));
+    pool->shared_stats = mmap(NULL, max_workers * pool->num_stats * sizeof(uint64_t) + 1,
+                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pool->shared_stats == MAP_FAILED) {
+        printf("Error: cannot allocate shared memory for sample workers\n");
+        exit(-1);
+    }
+}
+
+void destroy_sample_pool(Sample_Pool *pool)
+{
+    sample_pool_wait(pool, -1);
+    if (pool->max_workers > 0) {
+        stats_add(pool->stats);
+        munmap(pool->shared, pool->max_workers * sizeof(Sample_Result));
+        munmap(pool->shared_stats, pool->max_workers * pool->num_stats * sizeof(uint64_t) + 1);
+        free(pool->stats);
+        free(pool->worker_pid);
+        free(pool->worker_sample);
+    }
+    free(pool->results);
+    free(pool->done);
+}
+
+/* waits for one worker to finish and collects its result */
+static void sample_pool_reap(Sample_Pool *pool)
+{
+    int status;
+    pid_t pid = wait(&status);
+    for (int w = 0; w < pool->max_workers; ++w) {
+        if (pool->worker_pid[w] != pid || pid <= 0)
+            continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("Error: the worker of sample %d failed\n", pool->worker_sample[w]);
+            exit(-1);
+        }
+        int id = pool->worker_sample[w];
+        pool->results[id] = pool->shared[w];
+        uint64_t *stats = &pool->shared_stats[w * pool->num_stats];
+        for (int i = 0; i < pool->num_stats; ++i)
+            pool->stats[i] += stats[i];
+        pool->done[id] = 1;
+        pool->worker_pid[w] = 0;
+        pool->running--;
+        return;
+    }
+    printf("Error: lost track of the sample workers\n");
+    exit(-1);
+}
+
+void sample_pool_start(Sample_Pool *pool, int id, Sample_Measure measure, void *arg)
+{
+    sample_pool_grow(pool, id);
+    if (pool->max_workers == 0) {
+        measure(arg, &pool->results[id]);
+        pool->done[id] = 1;
+        return;
+    }
+
+    while (pool->running == pool->max_workers)
+        sample_pool_reap(pool);
+    int w = 0;
+    while (pool->worker_pid[w] != 0)
+        w++;
+
+    /* buffered output would otherwise be written by both processes */
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Error: cannot fork a sample worker\n");
+        exit(-1);
+    }
+    if (pid == 0) {
+        uint64_t *stats = &pool->shared_stats[w * pool->num_stats];
+        uint64_t *before = malloc(pool->num_stats * sizeof(uint64_t) + 1);
+        memset(&pool->shared[w], 0, sizeof(Sample_Result));
+        stats_save(before);
+        measure(arg, &pool->shared[w]);
+        stats_save(stats);
+        for (int i = 0; i < pool->num_stats; ++i)
+            stats[i] -= before[i];
+        _exit(0);
+    }
+    pool->worker_pid[w] = pid;
+    pool->worker_sample[w] = id;
+    pool->running++;
+}
+
+void sample_pool_wait(Sample_Pool *pool, int id)
+{
+    while (pool->running > 0 && (id < 0 || id >= pool->max_samples || !pool->done[id]))
+        sample_pool_reap(pool);
+}
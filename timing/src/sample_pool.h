@@ -0,0 +1,57 @@
+#ifndef _SAMPLE_POOL_H_
+#define _SAMPLE_POOL_H_
+
+#include <stdint.h>
+
+/* the outcome of one detailed sample */
+typedef struct Sample_Result {
+    uint64_t cycles, insts;         /* of the measured instructions */
+    uint64_t all_cycles, all_insts; /* including detailed warming and the drain */
+} Sample_Result;
+
+/* simulates one sample in detail from the current state */
+typedef void (*Sample_Measure)(void *arg, Sample_Result *result);
+
+/* Runs detailed samples, either one after the other in this process or in
+ * parallel in worker processes. A worker is a fork() of the simulator at
+ * the start of its sample, so it sees a copy-on-write snapshot of the whole
+ * state while the simulator runs ahead functionally to the next sample.
+ * Workers hand their results, and how much they changed every registered
+ * statistic, back through shared memory and exit without flushing any
+ * output. The statistics of all workers are added to this process's when
+ * the pool is destroyed. */
+typedef struct Sample_Pool {
+    int max_workers;            /* 0 = run samples in this process */
+    int *worker_pid;            /* per worker slot, 0 = free */
+    int *worker_sample;
+    Sample_Result *shared;      /* per worker slot, shared with the workers */
+    uint64_t *shared_stats;     /* num_stats per worker slot, likewise */
+    int running;
+
+    /* the statistics of finished workers */
+    int num_stats;
+    uint64_t *stats;
+
+    /* results by sample number */
+    int max_samples;
+    Sample_Result *results;
+    uint8_t *done;
+} Sample_Pool;
+
+/* sets up a pool of up to max_workers worker processes (0 = none) */
+void init_sample_pool(Sample_Pool *pool, int max_workers);
+
+/* waits for all workers, adds their statistics to this process's and frees
+ * everything */
+void destroy_sample_pool(Sample_Pool *pool);
+
+/* simulates sample number id (numbered from 0) with measure(). Without
+ * workers this returns once the sample is done and the state has advanced
+ * past it; otherwise it waits for a free worker, forks, and returns at once
+ * with the state unchanged. */
+void sample_pool_start(Sample_Pool *pool, int id, Sample_Measure measure, void *arg);
+
+/* waits until sample id is done (all samples if id is negative) */
+void sample_pool_wait(Sample_Pool *pool, int id);
+
+#endif
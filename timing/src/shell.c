@@ -16,16 +16,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/mman.h>
 
 #include "shell.h"
 #include "pipe.h"
+#include "config.h"
+#include "ooo.h"
+#include "frontend.h"
+#include "stats.h"
+#include "interval.h"
+#include "profile.h"
+#include "trace.h"
+#include "trace_sim.h"
+#include "sweep.h"
+#include "simpoint.h"
+#include "smarts.h"
+#include "functional.h"
+#include "checkpoint.h"
 
 /***************************************************************/
 /* Statistics.                                                 */
 /***************************************************************/
 
-uint32_t stat_cycles = 0, stat_inst_retire = 0, stat_inst_fetch = 0;
-uint32_t stat_squash = 0;
+uint64_t stat_cycles = 0, stat_inst_retire = 0, stat_inst_fetch = 0;
+uint64_t stat_squash = 0;
 
 /***************************************************************/
 /* Main memory.                                                */
@@ -45,15 +59,16 @@ uint32_t stat_squash = 0;
 typedef struct {
     uint32_t start, size;
     uint8_t *mem;
+    int mapped;     /* mem comes from mmap() rather than malloc() */
 } mem_region_t;
 
 /* memory will be dynamically allocated at initialization */
 mem_region_t MEM_REGIONS[] = {
-    { MEM_TEXT_START, MEM_TEXT_SIZE, NULL },
-    { MEM_DATA_START, MEM_DATA_SIZE, NULL },
-    { MEM_STACK_START, MEM_STACK_SIZE, NULL },
-    { MEM_KDATA_START, MEM_KDATA_SIZE, NULL },
-    { MEM_KTEXT_START, MEM_KTEXT_SIZE, NULL }
+    { MEM_TEXT_START, MEM_TEXT_SIZE, NULL, 0 },
+    { MEM_DATA_START, MEM_DATA_SIZE, NULL, 0 },
+    { MEM_STACK_START, MEM_STACK_SIZE, NULL, 0 },
+    { MEM_KDATA_START, MEM_KDATA_SIZE, NULL, 0 },
+    { MEM_KTEXT_START, MEM_KTEXT_SIZE, NULL, 0 }
 };
 
 #define MEM_NREGIONS (sizeof(MEM_REGIONS)/sizeof(mem_region_t))
@@ -110,6 +125,25 @@ void mem_write_32(uint32_t address, uint32_t value)
     }
 }
 
+uint8_t *mem_region(int i, uint32_t *start, uint32_t *size)
+{
+    if (i < 0 || i >= MEM_NREGIONS)
+        return NULL;
+    *start = MEM_REGIONS[i].start;
+    *size = MEM_REGIONS[i].size;
+    return MEM_REGIONS[i].mem;
+}
+
+void mem_region_map(int i, uint8_t *mapping)
+{
+    if (MEM_REGIONS[i].mapped)
+        munmap(MEM_REGIONS[i].mem, MEM_REGIONS[i].size);
+    else
+        free(MEM_REGIONS[i].mem);
+    MEM_REGIONS[i].mem = mapping;
+    MEM_REGIONS[i].mapped = 1;
+}
+
 /***************************************************************/
 /*                                                             */
 /* Procedure : help                                            */
@@ -123,6 +157,11 @@ void help() {
   printf("run n                  -  execute program for n instructions\n");
   printf("rdump                  -  dump architectural registers      \n");
   printf("mdump low high         -  dump memory from low to high      \n");
+  printf("cpistack               -  print the CPI stack as CSV        \n");
+  printf("stats text|json|csv    -  dump all statistics               \n");
+  printf("stats reset            -  restart all statistics from 0     \n");
+  printf("checkpoint file        -  save the machine state to file    \n");
+  printf("restore file           -  load the machine state from file  \n");
   printf("input reg_no reg_value - set GPR reg_no to reg_value  \n");
   printf("?                      -  display this help menu            \n");
   printf("quit                   -  exit the program                  \n\n");
@@ -135,10 +174,53 @@ void help() {
 /* Purpose   : Execute a cycle                                 */
 /*                                                             */
 /***************************************************************/
+/* functional fast-forward and warming still to be done before the first
+ * cycle, and the retired instruction count that ends detailed simulation
+ * (0 = none) */
+static int skip_pending;
+static uint64_t measure_end;
+
+/* skips to the part of the program that is simulated in detail */
+static void start_measurement() {
+  skip_pending = 0;
+  if (sim_config.simpoint != SIMPOINT_OFF) {
+    simpoint_run();
+    return;
+  }
+  if (sim_config.smarts) {
+    smarts_run();
+    return;
+  }
+  functional_run(sim_config.fast_forward, 0);
+  functional_run(sim_config.warmup, 1);
+  if (sim_config.checkpoint_file[0] && RUN_BIT)
+    checkpoint_save(sim_config.checkpoint_file, sim_config.checkpoint_uarch);
+  if (sim_config.measure > 0)
+    measure_end = stat_inst_retire + sim_config.measure;
+}
+
+/* ends detailed simulation: drains the pipeline and finishes the program
+ * functionally */
+static void end_measurement() {
+  measure_end = 0;
+  detailed_drain();
+  functional_run(UINT64_MAX, 0);
+}
+
 void cycle() {                                                
+  if (skip_pending) {
+    start_measurement();
+    if (!RUN_BIT)
+      return;
+  }
+
   pipe_cycle();
 
   stat_cycles++;
+  interval_cycle();
+
+  if (measure_end && stat_inst_retire >= measure_end && RUN_BIT)
+    end_measurement();
 }
 
 /***************************************************************/
@@ -203,11 +285,7 @@ void rdump() {
 
     printf("HI: 0x%08x\n", pipe.HI);
     printf("LO: 0x%08x\n", pipe.LO);
-    printf("Cycles: %u\n", stat_cycles);
-    printf("FetchedInstr: %u\n", stat_inst_fetch);
-    printf("RetiredInstr: %u\n", stat_inst_retire);
-    printf("IPC: %0.3f\n", ((float) stat_inst_retire) / stat_cycles);
-    printf("Flushes: %u\n", stat_squash);
+    stats_dump(stdout, STATS_TEXT);
 }
 
 /***************************************************************/ 
@@ -228,6 +306,35 @@ void mdump(int start, int stop) {
   printf("\n");
 }
 
+/***************************************************************/
+/*                                                             */
+/* Procedure : save_checkpoint / restore_checkpoint            */
+/*                                                             */
+/* Purpose   : Save or load the machine state                  */
+/*                                                             */
+/***************************************************************/
+void save_checkpoint(const char *filename) {
+  if (RUN_BIT == FALSE) {
+    printf("Can't checkpoint, Simulator is halted\n\n");
+    return;
+  }
+
+  /* instructions in flight finish first */
+  detailed_drain();
+  if (RUN_BIT)
+    checkpoint_save(filename, sim_config.checkpoint_uarch);
+  pipe_resume_fetch();
+}
+
+void restore_checkpoint(const char *filename) {
+  if (stat_cycles > 0 || stat_inst_fast_forward > 0 || stat_inst_warm > 0) {
+    printf("Can't restore, the simulation has started\n\n");
+    return;
+  }
+  checkpoint_restore(filename);
+  RUN_BIT = TRUE;
+}
+
 /***************************************************************/
 /*                                                             */
 /* Procedure : get_command                                     */
@@ -236,7 +343,7 @@ void mdump(int start, int stop) {
 /*                                                             */
 /***************************************************************/
 void get_command() {
-  char buffer[20];
+  char buffer[20], filename[256];
   int start, stop, cycles;
   int register_no, register_value;
 
@@ -261,6 +368,34 @@ void get_command() {
     mdump(start, stop);
     break;
 
+  case 'C':
+  case 'c':
+    if (buffer[1] == 'h' || buffer[1] == 'H') {
+      if (scanf("%255s", filename) != 1)
+        break;
+      save_checkpoint(filename);
+    }
+    else
+      pipe_cpi_print();
+    break;
+
+  case 'S':
+  case 's':
+    if (scanf("%19s", buffer) != 1)
+        break;
+
+    if (strcmp(buffer, "text") == 0)
+        stats_dump(stdout, STATS_TEXT);
+    else if (strcmp(buffer, "json") == 0)
+        stats_dump(stdout, STATS_JSON);
+    else if (strcmp(buffer, "csv") == 0)
+        stats_dump(stdout, STATS_CSV);
+    else if (strcmp(buffer, "reset") == 0)
+        stats_reset();
+    else
+        printf("Invalid Command\n");
+    break;
+
   case '?':
     help();
     break;
@@ -273,6 +408,11 @@ void get_command() {
   case 'r':
     if (buffer[1] == 'd' || buffer[1] == 'D')
         rdump();
+    else if (buffer[1] == 'e' || buffer[1] == 'E') {
+      if (scanf("%255s", filename) != 1)
+        break;
+      restore_checkpoint(filename);
+    }
     else {
 	    if (scanf("%d", &cycles) != 1) break;
 	    run(cycles);
@@ -352,6 +492,7 @@ void load_program(char *program_filename) {
   }
 
   printf("Read %d words from program into memory.\n\n", ii/4);
+  profile_load_source(program_filename, ii/4);
 }
 
 /************************************************************/
@@ -366,13 +507,51 @@ void initialize(char *program_filename, int num_prog_files) {
   int i;
 
   init_memory();
+
+  stats_register_counter("Cycles", &stat_cycles, "simulated cycles");
+  stats_register_counter("FetchedInstr", &stat_inst_fetch,
+                         "fetched instructions, including squashed ones");
+  stats_register_counter("RetiredInstr", &stat_inst_retire, "retired instructions");
+  stats_register_formula("IPC", &stat_inst_retire, NULL, &stat_cycles, 1.0,
+                         "retired instructions per cycle");
+  stats_register_counter("Flushes", &stat_squash, "branch recoveries");
   pipe_init();
+  if (sim_config.profile)
+    init_profile(MEM_TEXT_START, MEM_TEXT_SIZE, PROF_NUM_COUNTERS, sim_config.profile_sort,
+                 sim_config.profile_top, sim_config.profile_file);
+  if (sim_config.trace_file[0] != '\0')
+    init_trace(sim_config.trace_file, sim_config.trace_compress, MEM_TEXT_START, MEM_TEXT_SIZE);
   for ( i = 0; i < num_prog_files; i++ ) {
     load_program(program_filename);
     while(*program_filename++ != '\0');
   }
+  interval_init();
     
   RUN_BIT = TRUE;
+  if (sim_config.restore[0])
+    checkpoint_restore(sim_config.restore);
+
+  /* the first cycle skips to the part simulated in detail (after the
+   * commands that set up the program's inputs) */
+  if (sim_config.fast_forward > 0 || sim_config.warmup > 0 || sim_config.measure > 0 ||
+      sim_config.simpoint != SIMPOINT_OFF || sim_config.smarts || sim_config.checkpoint_file[0]) {
+    if (sim_config.simpoint != SIMPOINT_OFF && sim_config.smarts) {
+      printf("Error: SimPoint and SMARTS sampling cannot be combined\n");
+      exit(-1);
+    }
+    if (sim_config.simpoint != SIMPOINT_OFF && sim_config.warmup > 0) {
+      printf("Error: SimPoint simulation warms with --simpoint-warmup, not --warmup\n");
+      exit(-1);
+    }
+    if (sim_config.sample_workers > 0 &&
+        (sim_config.interval_cycles > 0 || sim_config.interval_insts > 0 || sim_config.profile ||
+         sim_config.trace_file[0] != '\0')) {
+      printf("Error: sample workers cannot write intervals, profiles or traces\n");
+      exit(-1);
+    }
+    functional_register_stats();
+    skip_pending = 1;
+  }
 }
 
 /***************************************************************/
@@ -381,17 +560,39 @@ void initialize(char *program_filename, int num_prog_files) {
 /*                                                             */
 /***************************************************************/
 int main(int argc, char *argv[]) {                              
+  int first_prog = 1;
+
+  /* Options come before the program files */
+  config_init();
+  while (first_prog < argc && strncmp(argv[first_prog], "--", 2) == 0) {
+    if (config_parse_option(argv[first_prog]) != 0) {
+      printf("Error: invalid option %s\n", argv[first_prog]);
+      config_print();
+      exit(1);
+    }
+    first_prog++;
+  }
+
+  /* Trace-driven mode needs no program */
+  if (sim_config.trace_input[0]) {
+    if (sim_config.sweep)
+      sweep_run(sim_config.trace_input);
+    else
+      trace_sim_run(sim_config.trace_input);
+    exit(0);
+  }
 
-  /* Error Checking */
-  if (argc < 2) {
-    printf("Error: usage: %s <program_file_1> <program_file_2> ...\n",
+  /* Error Checking (a checkpoint holds the program) */
+  if (first_prog >= argc && !sim_config.restore[0]) {
+    printf("Error: usage: %s [--option=value ...] <program_file_1> <program_file_2> ...\n",
            argv[0]);
+    config_print();
     exit(1);
   }
 
   printf("MIPS Simulator\n\n");
 
-  initialize(argv[1], argc - 1);
+  initialize(argv[first_prog], argc - first_prog);
 
   while (1)
     get_command();
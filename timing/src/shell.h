@@ -26,7 +26,14 @@ extern int RUN_BIT;	/* run bit */
 uint32_t mem_read_32(uint32_t address);
 void     mem_write_32(uint32_t address, uint32_t value);
 
+/* memory regions, for checkpoints: returns the bytes of region i (NULL
+ * past the last region) along with its start address and size */
+uint8_t *mem_region(int i, uint32_t *start, uint32_t *size);
+
+/* replaces the bytes of region i with a mapping of its size from mmap() */
+void mem_region_map(int i, uint8_t *mapping);
+
 /* statistics */
-extern uint32_t stat_cycles, stat_inst_retire, stat_inst_fetch, stat_squash;
+extern uint64_t stat_cycles, stat_inst_retire, stat_inst_fetch, stat_squash;
 
 #endif
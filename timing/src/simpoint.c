@@ -0,0 +1,731 @@
+#include "simpoint.h"
+#include "config.h"
+#include "functional.h"
+#include "pipe.h"
+#include "sample_pool.h"
+#include "shell.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPOINT_SEEDS      5       /* k-means runs per k; the best one is kept */
+#define SIMPOINT_MAX_ITERS  100
+#define SIMPOINT_BIC_THRESHOLD 0.9  /* smallest k within 90% of the best BIC */
+
+int simpoint_profiling;
+
+/* basic-block vectors of the profiled intervals */
+static struct {
+    uint64_t interval_length;
+    int dims;
+
+    /* basic blocks by start PC (open addressing), with their random vectors
+     * and the instructions they executed in the current interval */
+    int num_blocks, max_blocks;
+    uint32_t *block_pc;
+    double *block_vector;
+    uint64_t *block_insts;
+    int *hash;
+    uint32_t hash_mask;
+    int *touched;               /* blocks executed in the current interval */
+    int num_touched;
+
+    /* current block and interval */
+    uint32_t block_start, block_len;
+    uint64_t interval_insts;
+
+    /* projected intervals */
+    int num_intervals, max_intervals;
+    double *points;
+    uint64_t *insts;
+
+    FILE *bbv;                  /* SimPoint .bb file, or NULL */
+} sp;
+
+/* representative intervals, as read from the simpoint file */
+typedef struct Simpoint_File {
+    uint64_t interval_length;
+    int num_points;
+    uint64_t *interval;         /* per cluster */
+    double *weight;
+    int num_labels;
+    int *label;                 /* per interval */
+} Simpoint_File;
+
+static uint32_t xorshift(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/* a uniform random number in [0, 1) */
+static double random_unit(uint32_t *state)
+{
+    return xorshift(state) / 4294967296.0;
+}
+
+static uint32_t simpoint_hash(uint32_t pc)
+{
+    return ((pc >> 2) * 2654435761u) & sp.hash_mask;
+}
+
+static void simpoint_grow_blocks()
+{
+    sp.max_blocks = sp.max_blocks ? 2 * sp.max_blocks : 1024;
+    sp.block_pc = realloc(sp.block_pc, sp.max_blocks * sizeof(uint32_t));
+    sp.block_vector = realloc(sp.block_vector, (size_t) sp.max_blocks * sp.dims * sizeof(double));
+    sp.block_insts = realloc(sp.block_insts, sp.max_blocks * sizeof(uint64_t));
+    sp.touched = realloc(sp.touched, sp.max_blocks * sizeof(int));
+
+    /* the table stays at most half full */
+    free(sp.hash);
+    sp.hash_mask = 2 * sp.max_blocks - 1;
+    sp.hash = malloc(2 * sp.max_blocks * sizeof(int));
+    memset(sp.hash, -1, 2 * sp.max_blocks * sizeof(int));
+    for (int b = 0; b < sp.num_blocks; ++b) {
+        uint32_t slot = simpoint_hash(sp.block_pc[b]);
+        while (sp.hash[slot] >= 0)
+            slot = (slot + 1) & sp.hash_mask;
+        sp.hash[slot] = b;
+    }
+}
+
+/* returns the block starting at pc, adding it if it is new; the random
+ * vector of a block only depends on its PC */
+static int simpoint_find_block(uint32_t pc)
+{
+    uint32_t slot = simpoint_hash(pc);
+    while (sp.hash[slot] >= 0) {
+        if (sp.block_pc[sp.hash[slot]] == pc)
+            return sp.hash[slot];
+        slot = (slot + 1) & sp.hash_mask;
+    }
+
+    if (sp.num_blocks == sp.max_blocks) {
+        simpoint_grow_blocks();
+        return simpoint_find_block(pc);
+    }
+
+    int b = sp.num_blocks++;
+    sp.block_pc[b] = pc;
+    sp.block_insts[b] = 0;
+    sp.hash[slot] = b;
+
+    uint32_t state = (pc * 2654435761u) ^ 0x5bd1e995u;
+    if (state == 0)
+        state = 1;
+    for (int d = 0; d < sp.dims; ++d)
+        sp.block_vector[(size_t) b * sp.dims + d] = 2.0 * random_unit(&state) - 1.0;
+    return b;
+}
+
+static void simpoint_end_block()
+{
+    int b = simpoint_find_block(sp.block_start);
+    if (sp.block_insts[b] == 0)
+        sp.touched[sp.num_touched++] = b;
+    sp.block_insts[b] += sp.block_len;
+    sp.block_len = 0;
+}
+
+/* projects the basic-block vector of the current interval */
+static void simpoint_end_interval()
+{
+    if (sp.interval_insts == 0)
+        return;
+
+    if (sp.num_intervals == sp.max_intervals) {
+        sp.max_intervals = sp.max_intervals ? 2 * sp.max_intervals : 256;
+        sp.points = realloc(sp.points, (size_t) sp.max_intervals * sp.dims * sizeof(double));
+        sp.insts = realloc(sp.insts, sp.max_intervals * sizeof(uint64_t));
+    }
+    double *point = &sp.points[(size_t) sp.num_intervals * sp.dims];
+    sp.insts[sp.num_intervals++] = sp.interval_insts;
+
+    memset(point, 0, sp.dims * sizeof(double));
+    if (sp.bbv)
+        fprintf(sp.bbv, "T");
+    for (int t = 0; t < sp.num_touched; ++t) {
+        int b = sp.touched[t];
+        double share = (double) sp.block_insts[b] / sp.interval_insts;
+        for (int d = 0; d < sp.dims; ++d)
+            point[d] += share * sp.block_vector[(size_t) b * sp.dims + d];
+        if (sp.bbv)
+            fprintf(sp.bbv, ":%d:%" PRIu64 " ", b + 1, sp.block_insts[b]);
+        sp.block_insts[b] = 0;
+    }
+    if (sp.bbv)
+        fprintf(sp.bbv, "\n");
+
+    sp.num_touched = 0;
+    sp.interval_insts = 0;
+}
+
+void simpoint_record(uint32_t pc, int ends_block)
+{
+    if (sp.block_len == 0)
+        sp.block_start = pc;
+    sp.block_len++;
+    sp.interval_insts++;
+
+    /* intervals end exactly every interval_length instructions, splitting
+     * the block in progress */
+    int interval_done = sp.interval_insts == sp.interval_length;
+    if (ends_block || interval_done)
+        simpoint_end_block();
+    if (interval_done)
+        simpoint_end_interval();
+}
+
+static double distance2(const double *a, const double *b, int dims)
+{
+    double sum = 0.0;
+    for (int d = 0; d < dims; ++d)
+        sum += (a[d] - b[d]) * (a[d] - b[d]);
+    return sum;
+}
+
+/* clusters n points into k clusters with k-means, from k-means++ seeds;
+ * returns the sum of the squared distances of the points to their centers */
+static double kmeans(const double *points, int n, int dims, int k, uint32_t seed, int *labels,
+                     double *centers)
+{
+    double *nearest = malloc(n * sizeof(double));
+    int *counts = malloc(k * sizeof(int));
+    uint32_t state = seed;
+
+    /* k-means++: every further seed is a point chosen with probability
+     * proportional to its squared distance to the nearest seed so far */
+    memcpy(centers, &points[(size_t) (xorshift(&state) % n) * dims], dims * sizeof(double));
+    for (int i = 0; i < n; ++i)
+        nearest[i] = distance2(&points[(size_t) i * dims], centers, dims);
+    for (int c = 1; c < k; ++c) {
+        double total = 0.0;
+        for (int i = 0; i < n; ++i)
+            total += nearest[i];
+
+        int pick = xorshift(&state) % n;
+        if (total > 0.0) {
+            double target = random_unit(&state) * total;
+            for (pick = 0; pick < n - 1 && target >= nearest[pick]; ++pick)
+                target -= nearest[pick];
+        }
+        double *center = &centers[(size_t) c * dims];
+        memcpy(center, &points[(size_t) pick * dims], dims * sizeof(double));
+        for (int i = 0; i < n; ++i) {
+            double dist = distance2(&points[(size_t) i * dims], center, dims);
+            if (dist < nearest[i])
+                nearest[i] = dist;
+        }
+    }
+
+    for (int i = 0; i < n; ++i)
+        labels[i] = -1;
+
+    double distortion = 0.0;
+    for (int iter = 0; iter < SIMPOINT_MAX_ITERS; ++iter) {
+        int changed = 0;
+        distortion = 0.0;
+        for (int i = 0; i < n; ++i) {
+            const double *point = &points[(size_t) i * dims];
+            int best = 0;
+            double best_dist = distance2(point, centers, dims);
+            for (int c = 1; c < k; ++c) {
+                double dist = distance2(point, &centers[(size_t) c * dims], dims);
+                if (dist < best_dist) {
+                    best = c;
+                    best_dist = dist;
+                }
+            }
+            if (labels[i] != best) {
+                labels[i] = best;
+                changed = 1;
+            }
+            distortion += best_dist;
+        }
+        if (!changed)
+            break;
+
+        /* an empty cluster keeps its old center */
+        memset(counts, 0, k * sizeof(int));
+        for (int i = 0; i < n; ++i)
+            counts[labels[i]]++;
+        for (int c = 0; c < k; ++c) {
+            if (counts[c] > 0)
+                memset(&centers[(size_t) c * dims], 0, dims * sizeof(double));
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int d = 0; d < dims; ++d)
+                centers[(size_t) labels[i] * dims + d] += points[(size_t) i * dims + d];
+        }
+        for (int c = 0; c < k; ++c) {
+            for (int d = 0; d < dims && counts[c] > 0; ++d)
+                centers[(size_t) c * dims + d] /= counts[c];
+        }
+    }
+
+    free(nearest);
+    free(counts);
+    return distortion;
+}
+
+/* Bayesian information criterion of a clustering under a spherical Gaussian
+ * model with one variance (Pelleg and Moore's X-means, as used by SimPoint);
+ * larger is better */
+static double bic(int n, int dims, int k, const int *labels, double distortion)
+{
+    int *counts = calloc(k, sizeof(int));
+    for (int i = 0; i < n; ++i)
+        counts[labels[i]]++;
+
+    double variance = n > k ? distortion / ((double) dims * (n - k)) : 0.0;
+    if (variance < 1e-12)
+        variance = 1e-12;
+
+    double likelihood = -0.5 * n * dims * log(2.0 * 3.14159265358979 * variance) - 0.5 * dims * (n - k);
+    for (int c = 0; c < k; ++c) {
+        if (counts[c] > 0)
+            likelihood += counts[c] * log((double) counts[c] / n);
+    }
+    free(counts);
+
+    double params = (k - 1) + (double) dims * k + 1;
+    return likelihood - 0.5 * params * log((double) n);
+}
+
+/* clusters the profiled intervals and writes the simpoint file */
+static void simpoint_cluster(const char *filename)
+{
+    int n = sp.num_intervals, dims = sp.dims;
+    int max_k = sim_config.simpoint_max_k < n ? sim_config.simpoint_max_k : n;
+    int *labels = malloc(n * sizeof(int));
+    int *best_labels = malloc((size_t) max_k * n * sizeof(int));
+    double *centers = malloc((size_t) max_k * dims * sizeof(double));
+    double *best_centers = malloc((size_t) max_k * max_k * dims * sizeof(double));
+    double *scores = malloc(max_k * sizeof(double));
+
+    /* the best of several k-means runs for every k */
+    for (int k = 1; k <= max_k; ++k) {
+        double best = -1.0;
+        for (int s = 0; s < SIMPOINT_SEEDS; ++s) {
+            double distortion = kmeans(sp.points, n, dims, k, 0x9e3779b9u * (k * SIMPOINT_SEEDS + s + 1),
+                                       labels, centers);
+            if (best < 0.0 || distortion < best) {
+                best = distortion;
+                memcpy(&best_labels[(size_t) (k - 1) * n], labels, n * sizeof(int));
+                memcpy(&best_centers[(size_t) (k - 1) * max_k * dims], centers,
+                       (size_t) k * dims * sizeof(double));
+            }
+        }
+        scores[k - 1] = bic(n, dims, k, &best_labels[(size_t) (k - 1) * n], best);
+    }
+
+    double low = scores[0], high = scores[0];
+    for (int k = 2; k <= max_k; ++k) {
+        low = scores[k - 1] < low ? scores[k - 1] : low;
+        high = scores[k - 1] > high ? scores[k - 1] : high;
+    }
+    int k = 1;
+    while (k < max_k && scores[k - 1] < low + SIMPOINT_BIC_THRESHOLD * (high - low))
+        k++;
+    int *chosen = &best_labels[(size_t) (k - 1) * n];
+    double *chosen_centers = &best_centers[(size_t) (k - 1) * max_k * dims];
+
+    /* the representative of a cluster is the interval closest to its center;
+     * empty clusters are dropped and the others renumbered */
+    int *rep = malloc(k * sizeof(int));
+    int *size = calloc(k, sizeof(int));
+    int *number = malloc(k * sizeof(int));
+    uint64_t *cluster_insts = calloc(k, sizeof(uint64_t));
+    uint64_t total = 0;
+    for (int c = 0; c < k; ++c)
+        rep[c] = -1;
+    for (int i = 0; i < n; ++i) {
+        int c = chosen[i];
+        size[c]++;
+        cluster_insts[c] += sp.insts[i];
+        total += sp.insts[i];
+        if (rep[c] < 0 ||
+            distance2(&sp.points[(size_t) i * dims], &chosen_centers[(size_t) c * dims], dims) <
+            distance2(&sp.points[(size_t) rep[c] * dims], &chosen_centers[(size_t) c * dims], dims))
+            rep[c] = i;
+    }
+    int clusters = 0;
+    for (int c = 0; c < k; ++c)
+        number[c] = size[c] > 0 ? clusters++ : -1;
+
+    FILE *out = fopen(filename, "w");
+    if (!out) {
+        printf("Error: cannot open simpoint file %s\n", filename);
+        exit(-1);
+    }
+    fprintf(out, "interval-length %" PRIu64 "\n", sp.interval_length);
+    for (int c = 0; c < k; ++c) {
+        if (size[c] > 0)
+            fprintf(out, "point %d %.8f\n", rep[c], (double) cluster_insts[c] / total);
+    }
+    for (int i = 0; i < n; ++i)
+        fprintf(out, "label %d\n", number[chosen[i]]);
+    fclose(out);
+
+    printf("SimPoint profile: %" PRIu64 " instructions, %d intervals of %" PRIu64
+           ", %d dimensions\n\n", total, n, sp.interval_length, dims);
+    printf("%3s %14s\n", "k", "BIC");
+    for (int j = 1; j <= max_k; ++j)
+        printf("%3d %14.1f%s\n", j, scores[j - 1], j == k ? "  *" : "");
+    printf("\n%7s %9s %8s %9s\n", "Cluster", "Interval", "Weight", "Intervals");
+    for (int c = 0; c < k; ++c) {
+        if (size[c] > 0)
+            printf("%7d %9d %8.4f %9d\n", number[c], rep[c], (double) cluster_insts[c] / total,
+                   size[c]);
+    }
+    printf("\nWrote %d simulation points to %s\n\n", clusters, filename);
+
+    free(labels);
+    free(best_labels);
+    free(centers);
+    free(best_centers);
+    free(scores);
+    free(rep);
+    free(size);
+    free(number);
+    free(cluster_insts);
+}
+
+static void simpoint_profile()
+{
+    sp.interval_length = sim_config.simpoint_interval;
+    sp.dims = sim_config.simpoint_dims;
+    simpoint_grow_blocks();
+    if (sim_config.simpoint_bbv_file[0]) {
+        sp.bbv = fopen(sim_config.simpoint_bbv_file, "w");
+        if (!sp.bbv) {
+            printf("Error: cannot open BBV file %s\n", sim_config.simpoint_bbv_file);
+            exit(-1);
+        }
+    }
+
+    simpoint_profiling = 1;
+    functional_run(UINT64_MAX, 0);
+    simpoint_profiling = 0;
+    if (sp.block_len > 0)
+        simpoint_end_block();
+    simpoint_end_interval();
+    if (sp.bbv)
+        fclose(sp.bbv);
+
+    simpoint_cluster(sim_config.simpoint_file);
+
+    free(sp.block_pc);
+    free(sp.block_vector);
+    free(sp.block_insts);
+    free(sp.hash);
+    free(sp.touched);
+    free(sp.points);
+    free(sp.insts);
+}
+
+static void simpoint_read(const char *filename, Simpoint_File *f)
+{
+    FILE *in = fopen(filename, "r");
+    if (!in) {
+        printf("Error: cannot open simpoint file %s\n", filename);
+        exit(-1);
+    }
+
+    memset(f, 0, sizeof(Simpoint_File));
+    int max_points = 0, max_labels = 0;
+    char keyword[32];
+    while (fscanf(in, "%31s", keyword) == 1) {
+        if (strcmp(keyword, "interval-length") == 0) {
+            if (fscanf(in, "%" SCNu64, &f->interval_length) != 1)
+                break;
+        }
+        else if (strcmp(keyword, "point") == 0) {
+            if (f->num_points == max_points) {
+                max_points = max_points ? 2 * max_points : 16;
+                f->interval = realloc(f->interval, max_points * sizeof(uint64_t));
+                f->weight = realloc(f->weight, max_points * sizeof(double));
+            }
+            if (fscanf(in, "%" SCNu64 " %lf", &f->interval[f->num_points],
+                       &f->weight[f->num_points]) != 2)
+                break;
+            f->num_points++;
+        }
+        else if (strcmp(keyword, "label") == 0) {
+            if (f->num_labels == max_labels) {
+                max_labels = max_labels ? 2 * max_labels : 256;
+                f->label = realloc(f->label, max_labels * sizeof(int));
+            }
+            if (fscanf(in, "%d", &f->label[f->num_labels]) != 1)
+                break;
+            f->num_labels++;
+        }
+        else
+            break;
+    }
+    int bad = !feof(in);
+    fclose(in);
+
+    if (bad || f->interval_length == 0 || f->num_points == 0) {
+        printf("Error: %s is not a simpoint file\n", filename);
+        exit(-1);
+    }
+    for (int i = 0; i < f->num_labels; ++i) {
+        if (f->label[i] < 0 || f->label[i] >= f->num_points) {
+            printf("Error: %s has a label without a point\n", filename);
+            exit(-1);
+        }
+    }
+}
+
+static void simpoint_free(Simpoint_File *f)
+{
+    free(f->interval);
+    free(f->weight);
+    free(f->label);
+}
+
+/* simulates interval_length instructions in detail from the current state */
+static void simpoint_measure(void *arg, Sample_Result *result)
+{
+    uint64_t length = *(uint64_t *) arg;
+    uint64_t cycles_start = stat_cycles, insts_start = stat_inst_retire;
+    pipe_resume_fetch();
+    while (RUN_BIT && stat_inst_retire - insts_start < length)
+        detailed_cycle();
+    detailed_drain();
+    result->cycles = result->all_cycles = stat_cycles - cycles_start;
+    result->insts = result->all_insts = stat_inst_retire - insts_start;
+}
+
+/* simulates the representative intervals in detail, in program order */
+static void simpoint_simulate()
+{
+    Simpoint_File f;
+    simpoint_read(sim_config.simpoint_file, &f);
+
+    int *order = malloc(f.num_points * sizeof(int));
+    uint64_t *cycles = calloc(f.num_points, sizeof(uint64_t));
+    uint64_t *insts = calloc(f.num_points, sizeof(uint64_t));
+    for (int c = 0; c < f.num_points; ++c)
+        order[c] = c;
+    for (int i = 1; i < f.num_points; ++i) {
+        for (int j = i; j > 0 && f.interval[order[j]] < f.interval[order[j - 1]]; --j) {
+            int swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    /* done counts every instruction executed so far; a drain may run past
+     * the start of an adjacent interval, which then starts a little late.
+     * With workers, this process warms through each interval functionally
+     * instead (walked), while the worker simulates it; then_ff and then_warm
+     * count the fast-forward and warming that follow, up to the next one. */
+    Sample_Pool pool;
+    init_sample_pool(&pool, sim_config.sample_workers);
+    uint64_t *walked = calloc(f.num_points, sizeof(uint64_t));
+    uint64_t *then_ff = calloc(f.num_points, sizeof(uint64_t));
+    uint64_t *then_warm = calloc(f.num_points, sizeof(uint64_t));
+    uint64_t done = 0, warmup = sim_config.simpoint_warmup;
+    int started = 0;
+    for (int i = 0; i < f.num_points && RUN_BIT; ++i) {
+        int c = order[i];
+        uint64_t start = f.interval[c] * f.interval_length;
+        uint64_t warm_start = start > warmup ? start - warmup : 0;
+        if (warm_start > done) {
+            uint64_t n = functional_run(warm_start - done, 0);
+            if (started > 0)
+                then_ff[started - 1] += n;
+            done += n;
+        }
+        if (start > done) {
+            uint64_t n = functional_run(start - done, 1);
+            if (started > 0)
+                then_warm[started - 1] += n;
+            done += n;
+        }
+        if (!RUN_BIT)
+            break;
+
+        sample_pool_start(&pool, i, simpoint_measure, &f.interval_length);
+        started++;
+        if (pool.max_workers > 0) {
+            walked[i] = functional_run(f.interval_length, 1);
+            done += walked[i];
+        }
+        else {
+            done += pool.results[i].all_insts;
+        }
+    }
+    uint64_t rest = functional_run(UINT64_MAX, 0);
+    if (started > 0)
+        then_ff[started - 1] += rest;
+    done += rest;
+
+    /* the workers count their intervals and drains as retired, so take them
+     * back out of this process's warming and fast-forward counts. A drain
+     * overlaps the fast-forward after the interval, then warming; where it
+     * reaches into the next interval, both workers simulate (and count)
+     * those instructions. */
+    sample_pool_wait(&pool, -1);
+    for (int i = 0; i < started; ++i) {
+        Sample_Result *r = &pool.results[i];
+        cycles[order[i]] = r->cycles;
+        insts[order[i]] = r->insts;
+        if (pool.max_workers > 0) {
+            uint64_t over = r->all_insts > walked[i] ? r->all_insts - walked[i] : 0;
+            uint64_t ff = over < then_ff[i] ? over : then_ff[i];
+            uint64_t warm = over - ff < then_warm[i] ? over - ff : then_warm[i];
+            stat_inst_fast_forward -= ff;
+            stat_inst_warm -= (r->all_insts < walked[i] ? r->all_insts : walked[i]) + warm;
+        }
+    }
+    destroy_sample_pool(&pool);
+    free(walked);
+    free(then_ff);
+    free(then_warm);
+
+    printf("SimPoint simulation: %d intervals of %" PRIu64 " instructions, warmup %" PRIu64
+           "\n\n", f.num_points, f.interval_length, warmup);
+    printf("%7s %9s %8s %12s %12s %8s\n", "Cluster", "Interval", "Weight", "Instructions",
+           "Cycles", "CPI");
+    double cpi = 0.0, weight = 0.0;
+    uint64_t detailed = 0;
+    for (int c = 0; c < f.num_points; ++c) {
+        if (insts[c] == 0) {
+            printf("%7d %9" PRIu64 " %8.4f %12s %12s %8s\n", c, f.interval[c], f.weight[c], "-",
+                   "-", "-");
+            continue;
+        }
+        double point_cpi = (double) cycles[c] / insts[c];
+        printf("%7d %9" PRIu64 " %8.4f %12" PRIu64 " %12" PRIu64 " %8.4f\n", c, f.interval[c],
+               f.weight[c], insts[c], cycles[c], point_cpi);
+        cpi += f.weight[c] * point_cpi;
+        weight += f.weight[c];
+        detailed += insts[c];
+    }
+    if (weight < 0.999)
+        printf("\nWarning: intervals with %.1f%% of the weight lie past the end of the program\n",
+               100.0 * (1.0 - weight));
+    if (weight > 0.0)
+        cpi /= weight;
+    printf("\nEstimated CPI: %.4f (IPC %.4f)\n", cpi, cpi > 0.0 ? 1.0 / cpi : 0.0);
+    printf("Simulated in detail: %" PRIu64 " of %" PRIu64 " instructions (%.2f%%)\n\n", detailed,
+           done, done ? 100.0 * detailed / done : 0.0);
+
+    free(order);
+    free(cycles);
+    free(insts);
+    simpoint_free(&f);
+}
+
+/* simulates the whole program in detail and measures the error of the
+ * estimate */
+static void simpoint_verify()
+{
+    Simpoint_File f;
+    simpoint_read(sim_config.simpoint_file, &f);
+    if (f.num_labels == 0) {
+        printf("Error: %s has no interval labels\n", sim_config.simpoint_file);
+        exit(-1);
+    }
+
+    /* the CPI of every interval; retirement can overshoot a boundary by a
+     * few instructions, which then count in the interval that ends there */
+    int n = f.num_labels, num_intervals = 0;
+    uint64_t *cycles = calloc(n, sizeof(uint64_t));
+    uint64_t *insts = calloc(n, sizeof(uint64_t));
+    uint64_t first_insts = stat_inst_retire;
+    uint64_t last_cycles = stat_cycles, last_insts = stat_inst_retire;
+    pipe_resume_fetch();
+    while (RUN_BIT) {
+        detailed_cycle();
+        if (stat_inst_retire - first_insts >= (num_intervals + 1) * f.interval_length || !RUN_BIT) {
+            if (num_intervals == n)
+                break;
+            cycles[num_intervals] = stat_cycles - last_cycles;
+            insts[num_intervals++] = stat_inst_retire - last_insts;
+            last_cycles = stat_cycles;
+            last_insts = stat_inst_retire;
+        }
+    }
+    if (RUN_BIT || num_intervals != n) {
+        printf("Error: the program does not run the %d intervals of %s\n", n,
+               sim_config.simpoint_file);
+        exit(-1);
+    }
+
+    uint64_t total_cycles = 0, total_insts = 0;
+    for (int i = 0; i < n; ++i) {
+        total_cycles += cycles[i];
+        total_insts += insts[i];
+    }
+    double true_cpi = (double) total_cycles / total_insts;
+
+    printf("SimPoint verification: %d intervals of %" PRIu64 " instructions\n\n", n,
+           f.interval_length);
+    printf("%7s %9s %8s %9s %8s %8s %8s\n", "Cluster", "Interval", "Weight", "Intervals",
+           "CPI", "Mean", "CoV");
+    double estimate = 0.0;
+    for (int c = 0; c < f.num_points; ++c) {
+        /* instruction-weighted mean and deviation of the cluster's CPIs */
+        uint64_t c_cycles = 0, c_insts = 0;
+        int size = 0;
+        for (int i = 0; i < n; ++i) {
+            if (f.label[i] == c) {
+                c_cycles += cycles[i];
+                c_insts += insts[i];
+                size++;
+            }
+        }
+        double mean = c_insts ? (double) c_cycles / c_insts : 0.0, var = 0.0;
+        for (int i = 0; i < n; ++i) {
+            if (f.label[i] == c && insts[i] > 0) {
+                double diff = (double) cycles[i] / insts[i] - mean;
+                var += diff * diff * insts[i];
+            }
+        }
+        var = c_insts ? var / c_insts : 0.0;
+
+        double point_cpi = f.interval[c] < (uint64_t) n && insts[f.interval[c]] > 0 ?
+            (double) cycles[f.interval[c]] / insts[f.interval[c]] : 0.0;
+        estimate += f.weight[c] * point_cpi;
+        printf("%7d %9" PRIu64 " %8.4f %9d %8.4f %8.4f %7.2f%%\n", c, f.interval[c], f.weight[c],
+               size, point_cpi, mean, mean > 0.0 ? 100.0 * sqrt(var) / mean : 0.0);
+    }
+
+    printf("\nTrue CPI: %.4f over %" PRIu64 " instructions\n", true_cpi, total_insts);
+    printf("Estimated CPI: %.4f from the representative intervals in context\n", estimate);
+    printf("Error: %+.2f%%\n\n", 100.0 * (estimate - true_cpi) / true_cpi);
+
+    free(cycles);
+    free(insts);
+    simpoint_free(&f);
+}
+
+void simpoint_run()
+{
+    if (sim_config.simpoint_interval == 0 || sim_config.simpoint_max_k <= 0 ||
+        sim_config.simpoint_dims <= 0) {
+        printf("Error: --simpoint-interval, --simpoint-max-k and --simpoint-dims must be positive\n");
+        exit(-1);
+    }
+
+    switch (sim_config.simpoint) {
+        case SIMPOINT_PROFILE:
+            simpoint_profile();
+            break;
+        case SIMPOINT_SIMULATE:
+            simpoint_simulate();
+            break;
+        case SIMPOINT_VERIFY:
+            simpoint_verify();
+            break;
+    }
+}
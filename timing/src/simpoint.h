@@ -0,0 +1,52 @@
+#ifndef _SIMPOINT_H_
+#define _SIMPOINT_H_
+
+#include <stdint.h>
+
+/* modes of --simpoint */
+#define SIMPOINT_OFF      0
+#define SIMPOINT_PROFILE  1
+#define SIMPOINT_SIMULATE 2
+#define SIMPOINT_VERIFY   3
+
+/* SimPoint-style sampling (Sherwood et al.).
+ *
+ * Profiling runs the whole program functionally and splits it into intervals
+ * of --simpoint-interval instructions. The basic-block vector of an interval
+ * (the instructions executed in each basic block, divided by the interval
+ * length) is projected on the fly onto --simpoint-dims random dimensions; each
+ * block has its own fixed random vector. k-means clusters the projected
+ * intervals for every k up to --simpoint-max-k, the Bayesian information
+ * criterion picks k, and the interval closest to the center of each cluster
+ * represents it, weighted by the cluster's share of all instructions. The
+ * result goes to the simpoint file:
+ *
+ *     interval-length <instructions>
+ *     point <interval> <weight>        one per cluster
+ *     label <cluster>                  one per interval
+ *
+ * Simulation executes the program functionally up to each representative
+ * interval in turn, warms the caches and predictors over the
+ * --simpoint-warmup instructions before it (0 = cold start), simulates the
+ * interval in detail and drains the pipeline. The weighted CPIs of the
+ * intervals estimate the CPI of the whole program. With --sample-workers,
+ * the intervals run in forked workers while the program continues
+ * functionally (see sample_pool.h).
+ *
+ * Verification simulates the whole program in detail and compares its CPI
+ * with the estimate made from the representative intervals, as measured in
+ * the same run, and reports how much the CPI varies within each cluster. */
+
+/* set while profiling; every instruction executed functionally must then
+ * be passed to simpoint_record() */
+extern int simpoint_profiling;
+
+/* counts one executed instruction; ends_block is set for branches and
+ * jumps */
+void simpoint_record(uint32_t pc, int ends_block);
+
+/* runs the whole program in the --simpoint mode and prints its report; the
+ * pipeline must not have run yet */
+void simpoint_run();
+
+#endif
@@ -0,0 +1,234 @@
+#include "smarts.h"
+#include "config.h"
+#include "functional.h"
+#include "pipe.h"
+#include "sample_pool.h"
+#include "shell.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SMARTS_MIN_SAMPLES 30   /* samples of a period before it may double */
+#define SMARTS_MAX_STRATA  40
+
+/* z-scores of the --smarts-confidence choices */
+static const double confidence_z[] = { 1.960, 2.576, 3.000 };
+static const char *confidence_names[] = { "95", "99", "99.7" };
+
+/* a stretch of the program sampled at one period */
+typedef struct Smarts_Stratum {
+    uint64_t period;
+    uint64_t insts;             /* all instructions executed in the stratum */
+    int samples;
+    double sum, sum2;           /* of the unit CPIs */
+} Smarts_Stratum;
+
+/* returns the CPI estimate over the strata with samples, and sets half to
+ * the half-width of its confidence interval. A stratum with a single
+ * sample uses the variance of all samples. */
+static double smarts_estimate(Smarts_Stratum *strata, int num_strata, double z, double *half)
+{
+    uint64_t total = 0;
+    int samples = 0;
+    double sum = 0.0, sum2 = 0.0;
+    for (int h = 0; h < num_strata; ++h) {
+        if (strata[h].samples == 0)
+            continue;
+        total += strata[h].insts;
+        samples += strata[h].samples;
+        sum += strata[h].sum;
+        sum2 += strata[h].sum2;
+    }
+    *half = 0.0;
+    if (samples == 0)
+        return 0.0;
+    double pooled = samples > 1 ? (sum2 - sum * sum / samples) / (samples - 1) : 0.0;
+
+    double estimate = 0.0, variance = 0.0;
+    for (int h = 0; h < num_strata; ++h) {
+        Smarts_Stratum *s = &strata[h];
+        if (s->samples == 0)
+            continue;
+        double weight = (double) s->insts / total;
+        double mean = s->sum / s->samples;
+        double var = s->samples > 1 ? (s->sum2 - s->sum * mean) / (s->samples - 1) : pooled;
+        estimate += weight * mean;
+        variance += weight * weight * (var > 0.0 ? var : 0.0) / s->samples;
+    }
+    *half = z * sqrt(variance);
+    return estimate;
+}
+
+/* adds a sample to its stratum */
+static void smarts_count(Smarts_Stratum *s, const Sample_Result *r)
+{
+    if (r->insts == 0)
+        return;
+    double cpi = (double) r->cycles / r->insts;
+    s->samples++;
+    s->sum += cpi;
+    s->sum2 += cpi * cpi;
+}
+
+/* the detailed part of a sample */
+typedef struct Smarts_Unit {
+    uint64_t warmup, unit;
+} Smarts_Unit;
+
+/* simulates the detailed warming and the unit from the current state; a
+ * unit cut short by the end of the program is not a sample (insts 0) */
+static void smarts_measure(void *arg, Sample_Result *result)
+{
+    Smarts_Unit *u = arg;
+    uint64_t start_cycles = stat_cycles, start = stat_inst_retire;
+    pipe_resume_fetch();
+    while (RUN_BIT && stat_inst_retire - start < u->warmup)
+        detailed_cycle();
+    uint64_t unit_cycles = stat_cycles, unit_insts = stat_inst_retire;
+    while (RUN_BIT && stat_inst_retire - unit_insts < u->unit)
+        detailed_cycle();
+    if (stat_inst_retire - unit_insts >= u->unit) {
+        result->cycles = stat_cycles - unit_cycles;
+        result->insts = stat_inst_retire - unit_insts;
+    }
+    detailed_drain();
+    result->all_cycles = stat_cycles - start_cycles;
+    result->all_insts = stat_inst_retire - start;
+}
+
+void smarts_run()
+{
+    uint64_t unit = sim_config.smarts_unit, warmup = sim_config.smarts_warmup;
+    if (unit == 0 || sim_config.smarts_error <= 0 || sim_config.smarts_period <= unit + warmup) {
+        printf("Error: SMARTS needs a positive unit and error, and a period longer than the unit and its warmup\n");
+        exit(-1);
+    }
+    double z = confidence_z[sim_config.smarts_confidence];
+    double target = sim_config.smarts_error / 100.0;
+    Smarts_Unit u = { warmup, unit };
+
+    Smarts_Stratum strata[SMARTS_MAX_STRATA];
+    int num_strata = 1;
+    memset(strata, 0, sizeof(strata));
+    strata[0].period = sim_config.smarts_period;
+
+    /* With workers, this process warms through each sample functionally
+     * while a worker simulates it, and the period is chosen from the
+     * samples before the ones still in flight (so the strata depend on the
+     * number of workers, but not on how fast they are). */
+    Sample_Pool pool;
+    init_sample_pool(&pool, sim_config.sample_workers);
+    int num_samples = 0, counted = 0, max_samples = 0;
+    int *sample_stratum = NULL;
+
+    /* detailed warming of the next unit starts at instruction next, so that
+     * units end every period instructions */
+    uint64_t done = 0, detailed = 0, next = strata[0].period - unit - warmup;
+    while (RUN_BIT) {
+        Smarts_Stratum *s = &strata[num_strata - 1];
+        if (next > done) {
+            uint64_t n = functional_run(next - done, 1);
+            s->insts += n;
+            done += n;
+        }
+        if (!RUN_BIT)
+            break;
+
+        if (num_samples == max_samples) {
+            max_samples = max_samples ? 2 * max_samples : 256;
+            sample_stratum = realloc(sample_stratum, max_samples * sizeof(int));
+        }
+        sample_stratum[num_samples] = num_strata - 1;
+        sample_pool_start(&pool, num_samples, smarts_measure, &u);
+        uint64_t n = pool.max_workers > 0 ? functional_run(warmup + unit, 1) :
+                     pool.results[num_samples].all_insts;
+        num_samples++;
+        s->insts += n;
+        done += n;
+        next += s->period;
+
+        /* add the samples that are known to the strata */
+        if (num_samples - pool.max_workers > counted) {
+            sample_pool_wait(&pool, num_samples - pool.max_workers - 1);
+            for (; counted < num_samples - pool.max_workers; ++counted)
+                smarts_count(&strata[sample_stratum[counted]], &pool.results[counted]);
+        }
+
+        /* sample less often once the interval is well within the target,
+         * and more often while it misses the target */
+        double half, estimate = smarts_estimate(strata, num_strata, z, &half);
+        if (s->samples < SMARTS_MIN_SAMPLES || num_strata == SMARTS_MAX_STRATA)
+            continue;
+        if (half <= 0.5 * target * estimate) {
+            strata[num_strata].period = 2 * s->period;
+            next += s->period;
+            num_strata++;
+        }
+        else if (half > target * estimate && s->period / 2 > unit + warmup) {
+            strata[num_strata].period = s->period / 2;
+            next -= s->period / 2;
+            num_strata++;
+        }
+    }
+
+    sample_pool_wait(&pool, -1);
+    for (; counted < num_samples; ++counted)
+        smarts_count(&strata[sample_stratum[counted]], &pool.results[counted]);
+    /* the workers count their samples and drains as retired, so take them
+     * back out of this process's warming */
+    for (int i = 0; i < num_samples; ++i) {
+        detailed += pool.results[i].all_insts;
+        if (pool.max_workers > 0)
+            stat_inst_warm -= pool.results[i].all_insts;
+    }
+    destroy_sample_pool(&pool);
+    free(sample_stratum);
+
+    /* instructions after the last sample belong to the stratum before */
+    if (num_strata > 1 && strata[num_strata - 1].samples == 0) {
+        strata[num_strata - 2].insts += strata[num_strata - 1].insts;
+        num_strata--;
+    }
+
+    int samples = 0;
+    double sum = 0.0, sum2 = 0.0;
+    printf("SMARTS sampling: units of %" PRIu64 " instructions after %" PRIu64
+           " of detailed warming\n\n", unit, warmup);
+    printf("%12s %8s %14s %8s\n", "Period", "Samples", "Instructions", "CPI");
+    for (int h = 0; h < num_strata; ++h) {
+        Smarts_Stratum *st = &strata[h];
+        printf("%12" PRIu64 " %8d %14" PRIu64 " %8.4f\n", st->period, st->samples, st->insts,
+               st->samples ? st->sum / st->samples : 0.0);
+        samples += st->samples;
+        sum += st->sum;
+        sum2 += st->sum2;
+    }
+
+    printf("\nSimulated in detail: %" PRIu64 " of %" PRIu64 " instructions (%.2f%%)\n", detailed,
+           done, done ? 100.0 * detailed / done : 0.0);
+    if (samples < 2) {
+        printf("Too few samples for an estimate: lower --smarts-period\n\n");
+        return;
+    }
+
+    double half, estimate = smarts_estimate(strata, num_strata, z, &half);
+    printf("Estimated CPI: %.4f +- %.4f (+-%.2f%%) at %s%% confidence\n", estimate, half,
+           100.0 * half / estimate, confidence_names[sim_config.smarts_confidence]);
+
+    /* the samples needed for the target at the variation seen (n = (z V / e)^2) */
+    if (half > target * estimate) {
+        double mean = sum / samples;
+        double cov = sqrt((sum2 - sum * mean) / (samples - 1)) / mean;
+        double needed = ceil((z * cov / target) * (z * cov / target));
+        uint64_t period = (uint64_t) (done / needed);
+        if (period > unit + warmup)
+            printf("Target of +-%d%% missed: rerun with --smarts-period=%" PRIu64 "\n",
+                   sim_config.smarts_error, period);
+        else
+            printf("Target of +-%d%% missed: the program is too short to sample; simulate it in detail\n",
+                   sim_config.smarts_error);
+    }
+    printf("\n");
+}
@@ -0,0 +1,26 @@
+#ifndef _SMARTS_H_
+#define _SMARTS_H_
+
+/* SMARTS-style systematic sampling (Wunderlich et al.).
+ *
+ * The program runs with functional warming: every instruction trains the
+ * caches and predictors, but there is no timing. Every --smarts-period
+ * instructions, the pipeline takes over for --smarts-warmup instructions of
+ * detailed warming and then a measurement unit of --smarts-unit
+ * instructions, whose CPI is one sample, and drains again.
+ *
+ * The sample count adapts to the program: once the current period has 30
+ * samples, the period doubles if the confidence interval of the CPI is
+ * within half the --smarts-error target, and halves if it misses the
+ * target (down to just over the unit and its warming). Each stretch of the
+ * program sampled at one period is a stratum, weighted by its
+ * instructions, so the estimate stays unbiased. At the end the estimate is
+ * printed with its confidence interval; if that still misses the target,
+ * the period to rerun with is suggested. With --sample-workers, the samples run in forked workers (see
+ * sample_pool.h). */
+
+/* runs the whole program with sampling and prints the estimate; the
+ * pipeline must not have run yet */
+void smarts_run();
+
+#endif
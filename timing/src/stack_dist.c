@@ -0,0 +1,231 @@
+#include "stack_dist.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STACK_DISTANCE_MIN_SIZE 16
+
+void init_stack_distance(Stack_Distance *sd, int max_sets)
+{
+    if (max_sets < 1 || (max_sets & (max_sets - 1))) {
+        printf("Error: stack distance set count %d is not a power of two\n", max_sets);
+        exit(-1);
+    }
+
+    sd->num_levels = 1;
+    while ((1 << (sd->num_levels - 1)) < max_sets)
+        sd->num_levels++;
+    sd->levels = (Stack_Distance_Level*) calloc(sd->num_levels, sizeof(Stack_Distance_Level));
+    for (int l = 0; l < sd->num_levels; ++l) {
+        sd->levels[l].log2_sets = l;
+        sd->levels[l].sets = (Stack_Distance_Set*) calloc(1 << l, sizeof(Stack_Distance_Set));
+    }
+    sd->accesses = 0;
+
+    sd->num_lines = 0;
+    sd->max_lines = 1024;
+    sd->line_addr = (uint32_t*) malloc(sd->max_lines * sizeof(uint32_t));
+    sd->hash_next = (int*) malloc(sd->max_lines * sizeof(int));
+    sd->last = (uint32_t*) malloc(sd->max_lines * sd->num_levels * sizeof(uint32_t));
+    sd->hash_mask = 2 * sd->max_lines - 1;
+    sd->hash = (int*) malloc((sd->hash_mask + 1) * sizeof(int));
+    memset(sd->hash, -1, (sd->hash_mask + 1) * sizeof(int));
+}
+
+void destroy_stack_distance(Stack_Distance *sd)
+{
+    for (int l = 0; l < sd->num_levels; ++l) {
+        for (int s = 0; s < (1 << l); ++s) {
+            free(sd->levels[l].sets[s].tree);
+            free(sd->levels[l].sets[s].owner);
+        }
+        free(sd->levels[l].sets);
+        free(sd->levels[l].histogram);
+    }
+    free(sd->levels);
+    free(sd->line_addr);
+    free(sd->hash_next);
+    free(sd->last);
+    free(sd->hash);
+}
+
+static uint32_t bucket(Stack_Distance *sd, uint32_t line)
+{
+    return (line * 2654435761u) & sd->hash_mask;
+}
+
+/* doubles the line table and rehashes it */
+static void grow_lines(Stack_Distance *sd)
+{
+    sd->max_lines *= 2;
+    sd->line_addr = (uint32_t*) realloc(sd->line_addr, sd->max_lines * sizeof(uint32_t));
+    sd->hash_next = (int*) realloc(sd->hash_next, sd->max_lines * sizeof(int));
+    sd->last = (uint32_t*) realloc(sd->last, sd->max_lines * sd->num_levels * sizeof(uint32_t));
+
+    free(sd->hash);
+    sd->hash_mask = 2 * sd->max_lines - 1;
+    sd->hash = (int*) malloc((sd->hash_mask + 1) * sizeof(int));
+    memset(sd->hash, -1, (sd->hash_mask + 1) * sizeof(int));
+    for (int n = 0; n < sd->num_lines; ++n) {
+        sd->hash_next[n] = sd->hash[bucket(sd, sd->line_addr[n])];
+        sd->hash[bucket(sd, sd->line_addr[n])] = n;
+    }
+}
+
+/* returns the index of a line, adding it if it is new */
+static int find_line(Stack_Distance *sd, uint32_t line)
+{
+    for (int n = sd->hash[bucket(sd, line)]; n != -1; n = sd->hash_next[n]) {
+        if (sd->line_addr[n] == line)
+            return n;
+    }
+
+    if (sd->num_lines == sd->max_lines)
+        grow_lines(sd);
+    int n = sd->num_lines++;
+    sd->line_addr[n] = line;
+    sd->hash_next[n] = sd->hash[bucket(sd, line)];
+    sd->hash[bucket(sd, line)] = n;
+    memset(&sd->last[n * sd->num_levels], 0, sd->num_levels * sizeof(uint32_t));
+    return n;
+}
+
+static void tree_add(Stack_Distance_Set *s, uint32_t time, int delta)
+{
+    for (; time <= s->size; time += time & -time)
+        s->tree[time] += delta;
+}
+
+/* number of live times in 1..time */
+static uint32_t tree_sum(Stack_Distance_Set *s, uint32_t time)
+{
+    uint32_t sum = 0;
+    for (; time > 0; time -= time & -time)
+        sum += s->tree[time];
+    return sum;
+}
+
+/* Renumbers the live times of a set 1..live, keeping their order, once its
+ * times run out; the tree doubles when more than half of it is live. */
+static void compact_set(Stack_Distance *sd, int level, Stack_Distance_Set *s)
+{
+    uint32_t size = s->size;
+    if (size == 0)
+        size = STACK_DISTANCE_MIN_SIZE;
+    else if (2 * s->live > size)
+        size *= 2;
+
+    int *owner = (int*) malloc((size + 1) * sizeof(int));
+    uint32_t time = 0;
+    for (uint32_t t = 1; t <= s->time; ++t) {
+        if (s->owner[t] != -1) {
+            owner[++time] = s->owner[t];
+            sd->last[s->owner[t] * sd->num_levels + level] = time;
+        }
+    }
+    free(s->owner);
+    s->owner = owner;
+
+    /* linear-time Fenwick build */
+    free(s->tree);
+    s->tree = (uint32_t*) calloc(size + 1, sizeof(uint32_t));
+    for (uint32_t t = 1; t <= size; ++t) {
+        s->tree[t] += t <= time;
+        if (t + (t & -t) <= size)
+            s->tree[t + (t & -t)] += s->tree[t];
+    }
+
+    s->size = size;
+    s->time = time;
+}
+
+void stack_distance_access(Stack_Distance *sd, uint32_t line)
+{
+    int n = find_line(sd, line);
+    sd->accesses++;
+
+    for (int l = 0; l < sd->num_levels; ++l) {
+        Stack_Distance_Level *level = &sd->levels[l];
+        Stack_Distance_Set *s = &level->sets[line & ((1u << l) - 1)];
+        uint32_t *last = &sd->last[n * sd->num_levels + l];
+
+        if (*last == 0) {
+            level->cold++;
+        }
+        else {
+            uint32_t distance = s->live - tree_sum(s, *last);
+            if (distance >= level->histogram_size) {
+                uint32_t size = level->histogram_size ? level->histogram_size : 16;
+                while (size <= distance)
+                    size *= 2;
+                level->histogram = (uint64_t*) realloc(level->histogram, size * sizeof(uint64_t));
+                memset(&level->histogram[level->histogram_size], 0,
+                       (size - level->histogram_size) * sizeof(uint64_t));
+                level->histogram_size = size;
+            }
+            level->histogram[distance]++;
+
+            tree_add(s, *last, -1);
+            s->owner[*last] = -1;
+            s->live--;
+        }
+
+        if (s->time == s->size)
+            compact_set(sd, l, s);
+        *last = ++s->time;
+        s->owner[*last] = n;
+        tree_add(s, *last, 1);
+        s->live++;
+    }
+}
+
+uint64_t stack_distance_misses(Stack_Distance *sd, int log2_sets, int num_ways)
+{
+    Stack_Distance_Level *level = &sd->levels[log2_sets];
+    uint64_t misses = level->cold;
+    for (uint32_t d = num_ways; d < level->histogram_size; ++d)
+        misses += level->histogram[d];
+    return misses;
+}
+
+void stack_distance_report(Stack_Distance *sd, FILE *out, const char *name, int line_bytes,
+                           int max_ways)
+{
+    fprintf(out, "%s LRU miss rate (%%) by sets x ways, %d-byte lines, %d lines touched\n",
+            name, line_bytes, sd->num_lines);
+    fprintf(out, "%6s", "sets");
+    for (int w = 1; w <= max_ways; w *= 2)
+        fprintf(out, " %6dw", w);
+    fprintf(out, "\n");
+
+    for (int l = 0; l < sd->num_levels; ++l) {
+        fprintf(out, "%6d", 1 << l);
+        for (int w = 1; w <= max_ways; w *= 2) {
+            double rate = sd->accesses ? 100.0 * stack_distance_misses(sd, l, w) / sd->accesses : 0;
+            fprintf(out, " %7.3f", rate);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n");
+}
+
+void stack_distance_write_csv(Stack_Distance *sd, FILE *out, const char *name, int line_bytes)
+{
+    for (int l = 0; l < sd->num_levels; ++l) {
+        Stack_Distance_Level *level = &sd->levels[l];
+
+        /* beyond the longest distance seen, only the cold misses remain */
+        uint32_t max_ways = level->histogram_size;
+        while (max_ways > 0 && level->histogram[max_ways - 1] == 0)
+            max_ways--;
+
+        uint64_t misses = stack_distance_misses(sd, l, 1);
+        for (uint32_t w = 1; w <= max_ways + 1; ++w) {
+            fprintf(out, "%s,%d,%u,%" PRIu64 ",%" PRIu64 ",%.6f\n", name, 1 << l, w,
+                    (uint64_t) (1 << l) * w * line_bytes, misses,
+                    sd->accesses ? (double) misses / sd->accesses : 0.0);
+            if (w < level->histogram_size)
+                misses -= level->histogram[w];
+        }
+    }
+}
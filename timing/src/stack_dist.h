@@ -0,0 +1,64 @@
+#ifndef _STACK_DIST_H_
+#define _STACK_DIST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* The LRU stacks of one set count. Each set keeps a Fenwick tree over its own
+ * access times, in which a time holds 1 while it is the last access of its
+ * line; the stack distance of an access is then the number of ones after the
+ * last access of the same line (Mattson's algorithm). */
+typedef struct Stack_Distance_Set {
+    uint32_t *tree;         /* Fenwick tree over times 1..size */
+    int *owner;             /* line of each time, -1 once accessed again */
+    uint32_t size, time, live;
+} Stack_Distance_Set;
+
+typedef struct Stack_Distance_Level {
+    int log2_sets;
+    Stack_Distance_Set *sets;
+    uint64_t *histogram;    /* accesses by stack distance */
+    uint32_t histogram_size;
+    uint64_t cold;          /* first accesses to a line */
+} Stack_Distance_Level;
+
+/* Stack distances of one address stream for 1, 2, 4, ... sets at once. A
+ * cache with S sets and W ways misses on every access with a distance of W or
+ * more at level S, and on every cold access. */
+typedef struct Stack_Distance {
+    int num_levels;
+    Stack_Distance_Level *levels;
+    uint64_t accesses;
+
+    /* lines seen so far: address, hash chain, and last access time per level
+     * (0 = never) */
+    int num_lines, max_lines;
+    uint32_t *line_addr;
+    int *hash_next;
+    uint32_t *last;
+    int *hash;
+    uint32_t hash_mask;
+} Stack_Distance;
+
+/* sets up levels of 1, 2, 4, ... max_sets sets (a power of two) */
+void init_stack_distance(Stack_Distance *sd, int max_sets);
+
+/* frees everything */
+void destroy_stack_distance(Stack_Distance *sd);
+
+/* records an access to a line (an address without its offset bits) */
+void stack_distance_access(Stack_Distance *sd, uint32_t line);
+
+/* misses of a cache with 2^log2_sets sets and num_ways ways */
+uint64_t stack_distance_misses(Stack_Distance *sd, int log2_sets, int num_ways);
+
+/* prints miss rates for all set counts and power-of-two associativities up
+ * to max_ways; name and line_bytes label the table */
+void stack_distance_report(Stack_Distance *sd, FILE *out, const char *name, int line_bytes,
+                           int max_ways);
+
+/* writes the miss rate of every associativity up to the one that only has
+ * cold misses, for every set count, as CSV rows */
+void stack_distance_write_csv(Stack_Distance *sd, FILE *out, const char *name, int line_bytes);
+
+#endif
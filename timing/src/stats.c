@@ -0,0 +1,276 @@
+#include "stats.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STAT_COUNTER   0
+#define STAT_HISTOGRAM 1
+#define STAT_FORMULA   2
+#define STAT_CONSTANT  3
+
+typedef struct Stat {
+    char *name;
+    const char *desc;
+    int type;
+
+    /* counter, and its value at the last reset (the value of a constant) */
+    uint64_t *counter;
+    uint64_t base;
+
+    Stat_Histogram *histogram;
+
+    /* formula */
+    const uint64_t *num, *num_sub, *den;
+    double scale;
+} Stat;
+
+static Stat *stats;
+static int num_stats, max_stats;
+
+/* returns the stat with the given name, adding it if there is none */
+static Stat *stats_find(const char *name)
+{
+    for (int i = 0; i < num_stats; ++i) {
+        if (strcmp(stats[i].name, name) == 0) {
+            if (stats[i].histogram) {
+                free(stats[i].histogram->buckets);
+                free(stats[i].histogram);
+            }
+            char *old_name = stats[i].name;
+            memset(&stats[i], 0, sizeof(Stat));
+            stats[i].name = old_name;
+            return &stats[i];
+        }
+    }
+
+    if (num_stats == max_stats) {
+        max_stats = max_stats ? 2 * max_stats : 64;
+        stats = realloc(stats, max_stats * sizeof(Stat));
+    }
+    Stat *s = &stats[num_stats++];
+    memset(s, 0, sizeof(Stat));
+    s->name = strdup(name);
+    return s;
+}
+
+void stats_register_counter(const char *name, uint64_t *counter, const char *desc)
+{
+    Stat *s = stats_find(name);
+    s->type = STAT_COUNTER;
+    s->desc = desc;
+    s->counter = counter;
+    s->base = *counter;
+}
+
+void stats_register_constant(const char *name, uint64_t value, const char *desc)
+{
+    Stat *s = stats_find(name);
+    s->type = STAT_CONSTANT;
+    s->desc = desc;
+    s->base = value;
+}
+
+Stat_Histogram *stats_register_histogram(const char *name, int num_buckets, uint64_t bucket_width,
+                                         const char *desc)
+{
+    if (num_buckets < 1 || bucket_width < 1) {
+        printf("Error: histogram %s needs at least one bucket of width 1 or more\n", name);
+        exit(-1);
+    }
+
+    Stat *s = stats_find(name);
+    s->type = STAT_HISTOGRAM;
+    s->desc = desc;
+    s->histogram = calloc(1, sizeof(Stat_Histogram));
+    s->histogram->num_buckets = num_buckets;
+    s->histogram->bucket_width = bucket_width;
+    s->histogram->buckets = calloc(num_buckets, sizeof(uint64_t));
+    return s->histogram;
+}
+
+void stats_register_formula(const char *name, const uint64_t *num, const uint64_t *num_sub,
+                            const uint64_t *den, double scale, const char *desc)
+{
+    Stat *s = stats_find(name);
+    s->type = STAT_FORMULA;
+    s->desc = desc;
+    s->num = num;
+    s->num_sub = num_sub;
+    s->den = den;
+    s->scale = scale;
+}
+
+void stats_reset()
+{
+    for (int i = 0; i < num_stats; ++i) {
+        Stat *s = &stats[i];
+        if (s->type == STAT_COUNTER)
+            s->base = *s->counter;
+        if (s->type == STAT_HISTOGRAM) {
+            memset(s->histogram->buckets, 0, s->histogram->num_buckets * sizeof(uint64_t));
+            s->histogram->samples = s->histogram->sum = 0;
+        }
+    }
+}
+
+uint64_t stats_value(const uint64_t *counter)
+{
+    for (int i = 0; i < num_stats; ++i) {
+        if (stats[i].counter == counter)
+            return *counter - stats[i].base;
+    }
+    return *counter;
+}
+
+int stats_num_values()
+{
+    int n = 0;
+    for (int i = 0; i < num_stats; ++i) {
+        if (stats[i].type == STAT_COUNTER)
+            n++;
+        if (stats[i].type == STAT_HISTOGRAM)
+            n += stats[i].histogram->num_buckets + 2;
+    }
+    return n;
+}
+
+void stats_save(uint64_t *values)
+{
+    for (int i = 0; i < num_stats; ++i) {
+        Stat *s = &stats[i];
+        if (s->type == STAT_COUNTER)
+            *values++ = *s->counter;
+        if (s->type == STAT_HISTOGRAM) {
+            memcpy(values, s->histogram->buckets, s->histogram->num_buckets * sizeof(uint64_t));
+            values += s->histogram->num_buckets;
+            *values++ = s->histogram->samples;
+            *values++ = s->histogram->sum;
+        }
+    }
+}
+
+void stats_add(const uint64_t *values)
+{
+    for (int i = 0; i < num_stats; ++i) {
+        Stat *s = &stats[i];
+        if (s->type == STAT_COUNTER)
+            *s->counter += *values++;
+        if (s->type == STAT_HISTOGRAM) {
+            for (int b = 0; b < s->histogram->num_buckets; ++b)
+                s->histogram->buckets[b] += *values++;
+            s->histogram->samples += *values++;
+            s->histogram->sum += *values++;
+        }
+    }
+}
+
+static double stats_formula_value(Stat *s)
+{
+    uint64_t den = stats_value(s->den);
+    if (den == 0)
+        return 0.0;
+
+    double num = (double) stats_value(s->num);
+    if (s->num_sub)
+        num -= (double) stats_value(s->num_sub);
+    return s->scale * num / den;
+}
+
+static void stats_dump_histogram(FILE *out, int format, Stat *s)
+{
+    Stat_Histogram *h = s->histogram;
+    double mean = h->samples ? (double) h->sum / h->samples : 0.0;
+
+    if (format == STATS_JSON) {
+        fprintf(out, "{\"samples\": %" PRIu64 ", \"mean\": %.4f, \"bucket_width\": %" PRIu64
+                ", \"buckets\": [", h->samples, mean, h->bucket_width);
+        for (int b = 0; b < h->num_buckets; ++b)
+            fprintf(out, "%s%" PRIu64, b ? ", " : "", h->buckets[b]);
+        fprintf(out, "]}");
+        return;
+    }
+
+    if (format == STATS_CSV) {
+        fprintf(out, "%s.samples,%" PRIu64 ",\"%s\"\n", s->name, h->samples, s->desc);
+        fprintf(out, "%s.mean,%.4f,\"\"\n", s->name, mean);
+        for (int b = 0; b < h->num_buckets; ++b)
+            fprintf(out, "%s.%" PRIu64 ",%" PRIu64 ",\"\"\n", s->name, b * h->bucket_width,
+                    h->buckets[b]);
+        return;
+    }
+
+    /* only buckets with samples are printed */
+    fprintf(out, "%s: %" PRIu64 " samples, mean %0.2f\n", s->name, h->samples, mean);
+    for (int b = 0; b < h->num_buckets; ++b) {
+        if (h->buckets[b] == 0)
+            continue;
+        if (b == h->num_buckets - 1)
+            fprintf(out, "%s[%" PRIu64 "+]: %" PRIu64 "\n", s->name, b * h->bucket_width,
+                    h->buckets[b]);
+        else
+            fprintf(out, "%s[%" PRIu64 "-%" PRIu64 "]: %" PRIu64 "\n", s->name,
+                    b * h->bucket_width, (b + 1) * h->bucket_width - 1, h->buckets[b]);
+    }
+}
+
+void stats_dump(FILE *out, int format)
+{
+    if (format == STATS_JSON)
+        fprintf(out, "{\n");
+    if (format == STATS_CSV)
+        fprintf(out, "name,value,description\n");
+
+    for (int i = 0; i < num_stats; ++i) {
+        Stat *s = &stats[i];
+
+        if (format == STATS_JSON)
+            fprintf(out, "  \"%s\": ", s->name);
+
+        uint64_t value = s->type == STAT_COUNTER ? *s->counter - s->base : s->base;
+
+        switch (s->type) {
+            case STAT_COUNTER:
+            case STAT_CONSTANT:
+                if (format == STATS_TEXT)
+                    fprintf(out, "%s: %" PRIu64 "\n", s->name, value);
+                else if (format == STATS_CSV)
+                    fprintf(out, "%s,%" PRIu64 ",\"%s\"\n", s->name, value, s->desc);
+                else
+                    fprintf(out, "%" PRIu64, value);
+                break;
+
+            case STAT_FORMULA:
+                if (format == STATS_TEXT)
+                    fprintf(out, "%s: %0.4f\n", s->name, stats_formula_value(s));
+                else if (format == STATS_CSV)
+                    fprintf(out, "%s,%.6f,\"%s\"\n", s->name, stats_formula_value(s), s->desc);
+                else
+                    fprintf(out, "%.6f", stats_formula_value(s));
+                break;
+
+            case STAT_HISTOGRAM:
+                stats_dump_histogram(out, format, s);
+                break;
+        }
+
+        if (format == STATS_JSON)
+            fprintf(out, "%s\n", i < num_stats - 1 ? "," : "");
+    }
+
+    if (format == STATS_JSON)
+        fprintf(out, "}\n");
+}
+
+void stats_clear()
+{
+    for (int i = 0; i < num_stats; ++i) {
+        free(stats[i].name);
+        if (stats[i].histogram) {
+            free(stats[i].histogram->buckets);
+            free(stats[i].histogram);
+        }
+    }
+    free(stats);
+    stats = NULL;
+    num_stats = max_stats = 0;
+}
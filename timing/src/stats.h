@@ -0,0 +1,75 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* output formats of stats_dump() */
+#define STATS_TEXT 0
+#define STATS_JSON 1
+#define STATS_CSV  2
+
+/* Distribution of a value: bucket i counts the samples in
+ * [i * bucket_width, (i + 1) * bucket_width), and the last bucket also counts
+ * all larger samples. */
+typedef struct Stat_Histogram {
+    int num_buckets;
+    uint64_t bucket_width;
+    uint64_t *buckets;
+    uint64_t samples, sum;
+} Stat_Histogram;
+
+/* adds a sample to a histogram */
+static inline void stats_sample(Stat_Histogram *h, uint64_t value)
+{
+    uint64_t bucket = value / h->bucket_width;
+    h->buckets[bucket < (uint64_t) h->num_buckets ? bucket : (uint64_t) h->num_buckets - 1]++;
+    h->samples++;
+    h->sum += value;
+}
+
+/* Statistics registry. Modules keep their counters and increment them
+ * directly; the registry only holds pointers to them, and reads them when the
+ * statistics are dumped. Stats are dumped in the order they were registered.
+ * Registering a name again replaces the earlier stat. */
+
+/* registers a counter owned by the caller */
+void stats_register_counter(const char *name, uint64_t *counter, const char *desc);
+
+/* registers a value that does not change (such as a storage budget) */
+void stats_register_constant(const char *name, uint64_t value, const char *desc);
+
+/* allocates and registers a histogram */
+Stat_Histogram *stats_register_histogram(const char *name, int num_buckets, uint64_t bucket_width,
+                                         const char *desc);
+
+/* registers scale * (num - num_sub) / den, where num, num_sub (which may be
+ * NULL) and den are registered counters; the value is 0 if den is 0 */
+void stats_register_formula(const char *name, const uint64_t *num, const uint64_t *num_sub,
+                            const uint64_t *den, double scale, const char *desc);
+
+/* starts a new measurement: later dumps report what was counted since. The
+ * counters themselves keep running (some of them are also used as clocks). */
+void stats_reset();
+
+/* returns the value of a counter counted since the last reset */
+uint64_t stats_value(const uint64_t *counter);
+
+/* returns the number of values that stats_save() copies: one per counter
+ * and, per histogram, its buckets, samples and sum */
+int stats_num_values();
+
+/* copies the values of all counters and histograms */
+void stats_save(uint64_t *values);
+
+/* adds values (such as the difference of two stats_save() copies) to the
+ * counters and histograms; for merging the stats of another process */
+void stats_add(const uint64_t *values);
+
+/* prints all stats in the given format (STATS_*) */
+void stats_dump(FILE *out, int format);
+
+/* unregisters all stats */
+void stats_clear();
+
+#endif
@@ -0,0 +1,107 @@
+#include "store_buffer.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void init_store_buffer(Store_Buffer *sb, int size)
+{
+    sb->size = size;
+    sb->entries = (Store_Buffer_Entry*) calloc(size > 0 ? size : 1, sizeof(Store_Buffer_Entry));
+    sb->head = sb->count = 0;
+    sb->fill_active = sb->fill_cycles = 0;
+    sb->stat_stores = sb->stat_coalesced = sb->stat_full = 0;
+    sb->stat_forwarded = sb->stat_partial = 0;
+    sb->stat_drain_misses = sb->stat_fill_wait = 0;
+}
+
+void destroy_store_buffer(Store_Buffer *sb)
+{
+    free(sb->entries);
+}
+
+static Store_Buffer_Entry *store_buffer_tail(Store_Buffer *sb)
+{
+    return &sb->entries[(sb->head + sb->count - 1) % sb->size];
+}
+
+int store_buffer_can_insert(Store_Buffer *sb, uint32_t addr)
+{
+    if (sb->count < sb->size)
+        return 1;
+    return store_buffer_tail(sb)->addr == addr;
+}
+
+void store_buffer_insert(Store_Buffer *sb, uint32_t pc, uint32_t addr, uint32_t data,
+                         uint8_t mask)
+{
+    sb->stat_stores++;
+
+    if (sb->count > 0 && store_buffer_tail(sb)->addr == addr) {
+        Store_Buffer_Entry *entry = store_buffer_tail(sb);
+        entry->data = store_buffer_merge(entry->data, data, mask);
+        entry->mask |= mask;
+        sb->stat_coalesced++;
+        return;
+    }
+
+    Store_Buffer_Entry *entry = &sb->entries[(sb->head + sb->count) % sb->size];
+    entry->addr = addr;
+    entry->data = data;
+    entry->mask = mask;
+    entry->pc = pc;
+    sb->count++;
+}
+
+uint8_t store_buffer_forward(Store_Buffer *sb, uint32_t addr, uint32_t *data)
+{
+    uint8_t found = 0;
+
+    for (int i = 0; i < sb->count; ++i) {
+        Store_Buffer_Entry *entry = &sb->entries[(sb->head + i) % sb->size];
+        if (entry->addr == addr) {
+            *data = store_buffer_merge(*data, entry->data, entry->mask);
+            found |= entry->mask;
+        }
+    }
+
+    return found;
+}
+
+Store_Buffer_Entry *store_buffer_head(Store_Buffer *sb)
+{
+    return &sb->entries[sb->head];
+}
+
+void store_buffer_pop(Store_Buffer *sb)
+{
+    sb->head = (sb->head + 1) % sb->size;
+    sb->count--;
+}
+
+uint32_t store_buffer_merge(uint32_t word, uint32_t data, uint8_t mask)
+{
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (mask & (1 << i))
+            bits |= 0xFFu << (8 * i);
+    }
+
+    return (word & ~bits) | (data & bits);
+}
+
+void store_buffer_register_stats(Store_Buffer *sb)
+{
+    stats_register_constant("StoreBufferEntries", sb->size, "store buffer entries");
+    stats_register_counter("SBStores", &sb->stat_stores, "buffered stores");
+    stats_register_counter("SBCoalesced", &sb->stat_coalesced,
+                           "stores merged into the youngest entry");
+    stats_register_counter("SBFullStalls", &sb->stat_full,
+                           "cycles a store waited for a free entry");
+    stats_register_counter("SBForwardedLoads", &sb->stat_forwarded,
+                           "loads served entirely by the buffer");
+    stats_register_counter("SBPartialForwards", &sb->stat_partial,
+                           "loads merging buffered bytes with the L1D");
+    stats_register_counter("SBDrainMisses", &sb->stat_drain_misses, "drained stores that missed");
+    stats_register_counter("SBFillWaitStalls", &sb->stat_fill_wait,
+                           "cycles a load waited for a drain miss");
+}
@@ -0,0 +1,66 @@
+#ifndef _STORE_BUFFER_H_
+#define _STORE_BUFFER_H_
+
+#include <stdint.h>
+
+#define STORE_BUFFER_SIZE 0     /* disabled by default */
+
+/* A buffered store: the bytes it writes within one aligned word. */
+typedef struct Store_Buffer_Entry {
+    uint32_t addr;          /* word address */
+    uint32_t data;          /* bytes in their position within the word */
+    uint8_t mask;           /* bytes written, as a 4-bit mask */
+    uint32_t pc;            /* of the first store merged into the entry */
+} Store_Buffer_Entry;
+
+/* FIFO of retired stores waiting to be written to the L1D. A store that
+ * writes the same word as the youngest entry is merged into it. */
+typedef struct Store_Buffer {
+    int size;
+    Store_Buffer_Entry *entries;    /* circular */
+    int head, count;
+
+    /* the oldest entry missed and its line is being filled */
+    int fill_active;
+    int fill_cycles;
+
+    /* statistics */
+    uint64_t stat_stores;
+    uint64_t stat_coalesced;        /* stores merged into the youngest entry */
+    uint64_t stat_full;             /* cycles a store waited for a free entry */
+    uint64_t stat_forwarded;        /* loads served entirely by the buffer */
+    uint64_t stat_partial;          /* loads merging buffered bytes with the L1D */
+    uint64_t stat_drain_misses;
+    uint64_t stat_fill_wait;        /* cycles a load waited for a drain miss */
+} Store_Buffer;
+
+/* allocates the buffer */
+void init_store_buffer(Store_Buffer *sb, int size);
+
+/* frees the buffer */
+void destroy_store_buffer(Store_Buffer *sb);
+
+/* returns 1 if a store to the given word can be accepted */
+int store_buffer_can_insert(Store_Buffer *sb, uint32_t addr);
+
+/* appends a store (at pc) of the masked bytes of data to the word at addr */
+void store_buffer_insert(Store_Buffer *sb, uint32_t pc, uint32_t addr, uint32_t data,
+                         uint8_t mask);
+
+/* merges the buffered bytes of the word at addr into *data, oldest store
+ * first, and returns the mask of bytes found */
+uint8_t store_buffer_forward(Store_Buffer *sb, uint32_t addr, uint32_t *data);
+
+/* returns the oldest entry; the buffer must not be empty */
+Store_Buffer_Entry *store_buffer_head(Store_Buffer *sb);
+
+/* removes the oldest entry */
+void store_buffer_pop(Store_Buffer *sb);
+
+/* returns the word with the masked bytes replaced by those of data */
+uint32_t store_buffer_merge(uint32_t word, uint32_t data, uint8_t mask);
+
+/* registers store buffer statistics */
+void store_buffer_register_stats(Store_Buffer *sb);
+
+#endif
@@ -0,0 +1,245 @@
+#include "sweep.h"
+#include "cache.h"
+#include "config.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SWEEP_MAX_VALUES 32
+
+static const char *policy_names[] = { "lru", "fifo", "random", NULL };
+
+typedef struct Sweep_Config {
+    int sets, ways, line_bytes, policy;
+
+    /* results */
+    uint64_t accesses, misses;
+} Sweep_Config;
+
+/* state shared by the workers */
+typedef struct Sweep {
+    Trace_Reader mapped;
+    int stream;
+    Sweep_Config *configs;
+    int num_configs;
+    int next;                   /* next configuration to run */
+    uint64_t instructions;
+} Sweep;
+
+static int log2_exact(int value)
+{
+    int log2 = 0;
+    while ((1 << log2) < value)
+        log2++;
+    return (1 << log2) == value ? log2 : -1;
+}
+
+/* parses a comma-separated list of numbers or, if names is set, of names;
+ * exits on error */
+static int parse_list(const char *option, const char *list, const char **names, int *values)
+{
+    int count = 0;
+    const char *p = list;
+
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (count == SWEEP_MAX_VALUES) {
+            printf("Error: --%s has more than %d values\n", option, SWEEP_MAX_VALUES);
+            exit(-1);
+        }
+
+        int found = 0;
+        if (names) {
+            for (int i = 0; names[i]; ++i) {
+                if (strlen(names[i]) == len && strncmp(names[i], p, len) == 0) {
+                    values[count++] = i;
+                    found = 1;
+                }
+            }
+        }
+        else {
+            char *end;
+            long value = strtol(p, &end, 0);
+            if (end == p + len && len > 0) {
+                values[count++] = (int) value;
+                found = 1;
+            }
+        }
+        if (!found) {
+            printf("Error: invalid value '%.*s' in --%s\n", (int) len, p, option);
+            exit(-1);
+        }
+
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+
+    if (count == 0) {
+        printf("Error: --%s is empty\n", option);
+        exit(-1);
+    }
+    return count;
+}
+
+/* runs one configuration over the whole trace */
+static void sweep_simulate(Sweep *sweep, Sweep_Config *config)
+{
+    static uint32_t no_data[BLOCK_SIZE];
+    Trace_Reader reader;
+    Trace_Record record;
+    Cache cache;
+
+    int offset_bits = log2_exact(config->line_bytes);
+    int set_bits = log2_exact(config->sets);
+    uint32_t set_mask = config->sets - 1;
+    uint32_t random = 2463534242u;  /* xorshift state; the same for every run */
+    uint64_t instructions = 0;
+
+    init_trace_cursor(&reader, &sweep->mapped);
+    cache_init(&cache, config->sets, config->ways);
+
+    while (trace_read(&reader, &record)) {
+        instructions++;
+
+        uint32_t addr;
+        if (sweep->stream == SWEEP_INST)
+            addr = record.pc;
+        else if (record.mem != TRACE_MEM_NONE)
+            addr = record.mem_addr;
+        else
+            continue;
+
+        uint32_t set = (addr >> offset_bits) & set_mask;
+        uint32_t tag = addr >> (offset_bits + set_bits);
+        uint16_t way = cache_get_way(&cache, set, tag);
+
+        cache.stat_accesses++;
+        if (way != cache.NUM_WAY) {
+            /* FIFO keeps the insertion order */
+            if (config->policy == SWEEP_LRU)
+                cache_update_lru_state(&cache, set, way);
+            continue;
+        }
+
+        cache.stat_misses++;
+        way = cache_find_victim(&cache, set);
+        if (config->policy == SWEEP_RANDOM && cache.block[set][way].valid) {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            way = random % cache.NUM_WAY;
+        }
+        cache_insert_data(&cache, set, way, tag, no_data);
+    }
+
+    config->accesses = cache.stat_accesses;
+    config->misses = cache.stat_misses;
+    if (config == sweep->configs)
+        sweep->instructions = instructions;
+
+    cache_destroy(&cache);
+    destroy_trace_reader(&reader);
+}
+
+static void *sweep_worker(void *arg)
+{
+    Sweep *sweep = (Sweep*) arg;
+    int i;
+    while ((i = __sync_fetch_and_add(&sweep->next, 1)) < sweep->num_configs)
+        sweep_simulate(sweep, &sweep->configs[i]);
+    return NULL;
+}
+
+void sweep_run(const char *filename)
+{
+    Sweep sweep;
+    int sets[SWEEP_MAX_VALUES], ways[SWEEP_MAX_VALUES], lines[SWEEP_MAX_VALUES];
+    int policies[SWEEP_MAX_VALUES];
+
+    int num_sets = parse_list("sweep-sets", sim_config.sweep_sets, NULL, sets);
+    int num_ways = parse_list("sweep-ways", sim_config.sweep_ways, NULL, ways);
+    int num_lines = parse_list("sweep-line", sim_config.sweep_line, NULL, lines);
+    int num_policies = parse_list("sweep-policy", sim_config.sweep_policy, policy_names, policies);
+
+    for (int i = 0; i < num_sets; ++i) {
+        if (log2_exact(sets[i]) < 0 || sets[i] > 32768) {
+            printf("Error: %d sets is not a power of two up to 32768\n", sets[i]);
+            exit(-1);
+        }
+    }
+    for (int i = 0; i < num_ways; ++i) {
+        if (ways[i] < 1 || ways[i] > 256) {
+            printf("Error: %d ways is not between 1 and 256\n", ways[i]);
+            exit(-1);
+        }
+    }
+    for (int i = 0; i < num_lines; ++i) {
+        if (log2_exact(lines[i]) < 2) {
+            printf("Error: %d-byte lines are not a power of two of at least 4\n", lines[i]);
+            exit(-1);
+        }
+    }
+
+    sweep.num_configs = num_sets * num_ways * num_lines * num_policies;
+    sweep.configs = (Sweep_Config*) calloc(sweep.num_configs, sizeof(Sweep_Config));
+    Sweep_Config *config = sweep.configs;
+    for (int s = 0; s < num_sets; ++s)
+        for (int w = 0; w < num_ways; ++w)
+            for (int l = 0; l < num_lines; ++l)
+                for (int p = 0; p < num_policies; ++p, ++config) {
+                    config->sets = sets[s];
+                    config->ways = ways[w];
+                    config->line_bytes = lines[l];
+                    config->policy = policies[p];
+                }
+
+    init_trace_reader(&sweep.mapped, filename);
+    sweep.stream = sim_config.sweep_stream;
+    sweep.next = 0;
+    sweep.instructions = 0;
+
+    int num_threads = sim_config.sweep_threads;
+    if (num_threads <= 0)
+        num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads > sweep.num_configs)
+        num_threads = sweep.num_configs;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t *threads = (pthread_t*) malloc(num_threads * sizeof(pthread_t));
+    for (int t = 0; t < num_threads; ++t) {
+        if (pthread_create(&threads[t], NULL, sweep_worker, &sweep) != 0) {
+            printf("Error: cannot start sweep thread\n");
+            exit(-1);
+        }
+    }
+    for (int t = 0; t < num_threads; ++t)
+        pthread_join(threads[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Sweep of %s (%s stream): %d configurations, %d threads, %.2f s\n\n", filename,
+           sweep.stream == SWEEP_INST ? "instruction" : "data", sweep.num_configs, num_threads,
+           seconds);
+    printf("%6s %5s %5s %9s %-7s %12s %12s %9s %9s\n", "sets", "ways", "line", "bytes", "policy",
+           "accesses", "misses", "missrate", "MPKI");
+    for (int i = 0; i < sweep.num_configs; ++i) {
+        config = &sweep.configs[i];
+        uint64_t bytes = (uint64_t) config->sets * config->ways * config->line_bytes;
+        printf("%6d %5d %5d %9" PRIu64 " %-7s %12" PRIu64 " %12" PRIu64 " %9.6f %9.4f\n",
+               config->sets, config->ways, config->line_bytes, bytes, policy_names[config->policy],
+               config->accesses, config->misses,
+               config->accesses ? (double) config->misses / config->accesses : 0.0,
+               sweep.instructions ? 1000.0 * config->misses / sweep.instructions : 0.0);
+    }
+
+    free(threads);
+    free(sweep.configs);
+    destroy_trace_reader(&sweep.mapped);
+}
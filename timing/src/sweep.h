@@ -0,0 +1,20 @@
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+/* replacement policies of a sweep */
+#define SWEEP_LRU    0
+#define SWEEP_FIFO   1
+#define SWEEP_RANDOM 2
+
+/* streams of a sweep */
+#define SWEEP_INST 0
+#define SWEEP_DATA 1
+
+/* Cache design-space sweep: simulates every combination of the set counts,
+ * associativities, line sizes and replacement policies given by the
+ * --sweep-* options over one trace, on a pool of threads, and prints one
+ * table of results. Every thread reads the same mapping of the trace and
+ * owns the Cache of the configuration it runs. */
+void sweep_run(const char *filename);
+
+#endif
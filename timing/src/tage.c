@@ -0,0 +1,229 @@
+#include "tage.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static void init_folded_history(Folded_History *f, int orig_len, int comp_len)
+{
+    f->comp = 0;
+    f->orig_len = orig_len;
+    f->comp_len = comp_len;
+    f->out_point = orig_len % comp_len;
+}
+
+/* folds in the newest history bit and folds out the one leaving the window */
+static void update_folded_history(Folded_History *f, uint8_t *ghist, uint32_t ptr)
+{
+    f->comp = (f->comp << 1) ^ ghist[ptr & (TAGE_HIST_BUFFER - 1)];
+    f->comp ^= ghist[(ptr + f->orig_len) & (TAGE_HIST_BUFFER - 1)] << f->out_point;
+    f->comp ^= (f->comp >> f->comp_len);
+    f->comp &= (1u << f->comp_len) - 1;
+}
+
+void init_tage(Tage *tage, uint32_t base_size, int num_tables, int log_entries,
+               int tag_bits, int min_history, int max_history)
+{
+    memset(tage, 0, sizeof(Tage));
+    tage->num_tables = num_tables;
+    tage->log_entries = log_entries;
+    tage->tag_bits = tag_bits;
+    tage->seed = 0x2545F491;
+
+    init_bimodal(&tage->base, base_size);
+
+    for (int i = 1; i <= num_tables; ++i) {
+        /* geometric series from min_history to max_history */
+        if (num_tables == 1) {
+            tage->hist_len[i] = min_history;
+        }
+        else {
+            double ratio = pow((double) max_history / min_history,
+                               (double) (i - 1) / (num_tables - 1));
+            tage->hist_len[i] = (int) (min_history * ratio + 0.5);
+        }
+
+        tage->table[i] = (Tage_Entry*) calloc(1u << log_entries, sizeof(Tage_Entry));
+
+        init_folded_history(&tage->idx_fold[i], tage->hist_len[i], log_entries);
+        init_folded_history(&tage->tag_fold[0][i], tage->hist_len[i], tag_bits);
+        init_folded_history(&tage->tag_fold[1][i], tage->hist_len[i], tag_bits - 1);
+    }
+}
+
+void destroy_tage(Tage *tage)
+{
+    destroy_bimodal(&tage->base);
+    for (int i = 1; i <= tage->num_tables; ++i) {
+        free(tage->table[i]);
+    }
+}
+
+int predict_tage(Tage *tage, uint32_t PC, Bpred_Info *info)
+{
+    uint32_t pc = PC >> 2;
+    uint32_t index_mask = (1u << tage->log_entries) - 1;
+    uint32_t tag_mask = (1u << tage->tag_bits) - 1;
+
+    uint8_t base_taken = predict_bimodal(&tage->base, PC, info);
+
+    info->provider = 0;
+    info->alt_provider = 0;
+    for (int i = tage->num_tables; i >= 1; --i) {
+        info->index[i] = (pc ^ (pc >> (tage->log_entries - i % tage->log_entries)) ^
+                          tage->idx_fold[i].comp) & index_mask;
+        info->tag[i] = (pc ^ tage->tag_fold[0][i].comp ^ (tage->tag_fold[1][i].comp << 1)) &
+                       tag_mask;
+
+        if (tage->table[i][info->index[i]].tag == info->tag[i]) {
+            if (info->provider == 0)
+                info->provider = i;
+            else if (info->alt_provider == 0)
+                info->alt_provider = i;
+        }
+    }
+
+    if (info->alt_provider)
+        info->alt_taken = tage->table[info->alt_provider][info->index[info->alt_provider]].ctr >= 0;
+    else
+        info->alt_taken = base_taken;
+
+    if (info->provider == 0) {
+        info->output = base_taken;
+        info->taken = base_taken;
+        return info->taken;
+    }
+
+    /* newly allocated entries are weak and not yet useful; the alternate
+     * prediction is often better for them */
+    Tage_Entry *entry = &tage->table[info->provider][info->index[info->provider]];
+    int weak = (entry->ctr == 0 || entry->ctr == -1) && entry->u == 0;
+    info->output = entry->ctr >= 0;
+    info->taken = (weak && tage->use_alt_on_na >= 0) ? info->alt_taken : info->output;
+
+    return info->taken;
+}
+
+static void update_ctr(int8_t *ctr, uint8_t is_taken)
+{
+    if (is_taken) {
+        *ctr += (*ctr == 3 ? 0 : 1);
+    }
+    else {
+        *ctr -= (*ctr == -4 ? 0 : 1);
+    }
+}
+
+void update_tage(Tage *tage, uint32_t PC, uint8_t is_taken, Bpred_Info *info)
+{
+    int provider = info->provider;
+    uint8_t provider_taken = info->output;
+
+    if (provider) {
+        Tage_Entry *entry = &tage->table[provider][info->index[provider]];
+        int weak = (entry->ctr == 0 || entry->ctr == -1) && entry->u == 0;
+
+        if (weak && provider_taken != info->alt_taken) {
+            if (info->alt_taken == is_taken)
+                tage->use_alt_on_na += (tage->use_alt_on_na == 7 ? 0 : 1);
+            else
+                tage->use_alt_on_na -= (tage->use_alt_on_na == -8 ? 0 : 1);
+        }
+    }
+
+    /* on a misprediction, allocate an entry in a table with longer history */
+    if (info->taken != is_taken && provider < tage->num_tables) {
+        tage->seed ^= tage->seed << 13;
+        tage->seed ^= tage->seed >> 17;
+        tage->seed ^= tage->seed << 5;
+
+        int start = provider + 1;
+        if ((tage->seed & 1) && start < tage->num_tables)
+            start++;
+
+        int allocated = 0;
+        for (int i = start; i <= tage->num_tables; ++i) {
+            Tage_Entry *entry = &tage->table[i][info->index[i]];
+            if (entry->u == 0) {
+                entry->tag = info->tag[i];
+                entry->ctr = is_taken ? 0 : -1;
+                allocated = 1;
+                break;
+            }
+        }
+
+        if (!allocated) {
+            for (int i = provider + 1; i <= tage->num_tables; ++i) {
+                Tage_Entry *entry = &tage->table[i][info->index[i]];
+                entry->u -= (entry->u == 0 ? 0 : 1);
+            }
+        }
+    }
+
+    /* train the provider */
+    if (provider) {
+        Tage_Entry *entry = &tage->table[provider][info->index[provider]];
+        update_ctr(&entry->ctr, is_taken);
+
+        if (provider_taken != info->alt_taken) {
+            if (provider_taken == is_taken)
+                entry->u += (entry->u == 3 ? 0 : 1);
+            else
+                entry->u -= (entry->u == 0 ? 0 : 1);
+        }
+    }
+    else {
+        update_bimodal(&tage->base, info->index[0], is_taken);
+    }
+
+    /* periodically age the useful counters */
+    if (++tage->tick == TAGE_U_RESET_PERIOD) {
+        tage->tick = 0;
+        for (int i = 1; i <= tage->num_tables; ++i) {
+            for (uint32_t j = 0; j < (1u << tage->log_entries); ++j) {
+                tage->table[i][j].u >>= 1;
+            }
+        }
+    }
+}
+
+void shift_tage_history(Tage *tage, uint8_t is_taken)
+{
+    tage->ptr--;
+    tage->ghist[tage->ptr & (TAGE_HIST_BUFFER - 1)] = is_taken;
+    for (int i = 1; i <= tage->num_tables; ++i) {
+        update_folded_history(&tage->idx_fold[i], tage->ghist, tage->ptr);
+        update_folded_history(&tage->tag_fold[0][i], tage->ghist, tage->ptr);
+        update_folded_history(&tage->tag_fold[1][i], tage->ghist, tage->ptr);
+    }
+}
+
+void save_tage_history(Tage *tage, Bpred_History *history)
+{
+    history->ptr = tage->ptr;
+    for (int i = 1; i <= tage->num_tables; ++i) {
+        history->fold[0][i] = tage->idx_fold[i].comp;
+        history->fold[1][i] = tage->tag_fold[0][i].comp;
+        history->fold[2][i] = tage->tag_fold[1][i].comp;
+    }
+}
+
+void restore_tage_history(Tage *tage, Bpred_History *history)
+{
+    /* entries written by younger (squashed) branches lie below ptr and are
+     * overwritten by later updates */
+    tage->ptr = history->ptr;
+    for (int i = 1; i <= tage->num_tables; ++i) {
+        tage->idx_fold[i].comp = history->fold[0][i];
+        tage->tag_fold[0][i].comp = history->fold[1][i];
+        tage->tag_fold[1][i].comp = history->fold[2][i];
+    }
+}
+
+uint32_t tage_storage_bits(Tage *tage)
+{
+    uint32_t entry_bits = 3 + tage->tag_bits + 2;
+
+    return bimodal_storage_bits(&tage->base) +
+           tage->num_tables * (1u << tage->log_entries) * entry_bits +
+           tage->hist_len[tage->num_tables] + 4;
+}
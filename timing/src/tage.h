@@ -0,0 +1,75 @@
+#ifndef _TAGE_H_
+#define _TAGE_H_
+
+#include <stdint.h>
+#include "bpred_info.h"
+#include "bimodal.h"
+
+#define TAGE_MAX_TABLES (BPRED_MAX_TABLES - 1)
+#define TAGE_HIST_BUFFER 1024       /* global history buffer length (power of two) */
+#define TAGE_U_RESET_PERIOD (1 << 18)
+
+#define TAGE_NUM_TABLES 4
+#define TAGE_LOG_ENTRIES 10
+#define TAGE_TAG_BITS 9
+#define TAGE_MIN_HISTORY 4
+#define TAGE_MAX_HISTORY 64
+
+typedef struct Tage_Entry {
+    int8_t ctr;             /* 3-bit signed prediction counter */
+    uint16_t tag;           /* partial tag */
+    uint8_t u;              /* 2-bit useful counter */
+} Tage_Entry;
+
+/* A global history of orig_len bits folded onto comp_len bits, updated
+ * incrementally as branches are shifted in. */
+typedef struct Folded_History {
+    uint32_t comp;
+    int comp_len, orig_len, out_point;
+} Folded_History;
+
+/* TAGE: a bimodal base predictor and tagged tables indexed with geometrically
+ * increasing global history lengths. The longest matching table provides the
+ * prediction. Table 0 is the base predictor; tagged tables are 1..num_tables. */
+typedef struct Tage {
+    int num_tables, log_entries, tag_bits;
+    int hist_len[TAGE_MAX_TABLES + 1];
+
+    Bimodal base;
+    Tage_Entry *table[TAGE_MAX_TABLES + 1];
+
+    /* global history, newest branch at ghist[ptr] */
+    uint8_t ghist[TAGE_HIST_BUFFER];
+    uint32_t ptr;
+    Folded_History idx_fold[TAGE_MAX_TABLES + 1];
+    Folded_History tag_fold[2][TAGE_MAX_TABLES + 1];
+
+    int8_t use_alt_on_na;   /* 4-bit counter: trust altpred over new entries? */
+    uint32_t tick;          /* branches since the last useful-bit reset */
+    uint32_t seed;          /* allocation randomization */
+} Tage;
+
+/* allocates the tables and computes the history lengths */
+void init_tage(Tage *tage, uint32_t base_size, int num_tables, int log_entries,
+               int tag_bits, int min_history, int max_history);
+
+/* frees all tables */
+void destroy_tage(Tage *tage);
+
+/* returns 1 if the branch at PC is predicted taken */
+int predict_tage(Tage *tage, uint32_t PC, Bpred_Info *info);
+
+/* trains the provider and allocates on mispredictions */
+void update_tage(Tage *tage, uint32_t PC, uint8_t is_taken, Bpred_Info *info);
+
+/* shifts a branch outcome into the global and folded histories */
+void shift_tage_history(Tage *tage, uint8_t is_taken);
+
+/* saves/restores the history buffer position and the folded histories */
+void save_tage_history(Tage *tage, Bpred_History *history);
+void restore_tage_history(Tage *tage, Bpred_History *history);
+
+/* returns the number of bits of predictor state */
+uint32_t tage_storage_bits(Tage *tage);
+
+#endif
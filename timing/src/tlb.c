@@ -0,0 +1,165 @@
+#include "tlb.h"
+#include "config.h"
+#include "pipe.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static void init_tlb(TLB *tlb, const char *name, int entries, int ways)
+{
+    tlb->name = name;
+    tlb->num_sets = tlb->num_ways = 0;
+    tlb->entries = NULL;
+    tlb->stat_accesses = tlb->stat_misses = 0;
+    if (entries == 0)
+        return;
+
+    if (entries < 0 || ways <= 0 || (entries & (entries - 1)) != 0 ||
+        (ways & (ways - 1)) != 0 || ways > entries) {
+        printf("Error: %s entries and ways must be powers of two with ways <= entries\n", name);
+        exit(-1);
+    }
+
+    tlb->num_ways = ways;
+    tlb->num_sets = entries / ways;
+    tlb->entries = (TLB_Entry*) calloc(entries, sizeof(TLB_Entry));
+    for (int i = 0; i < entries; ++i)
+        tlb->entries[i].lru = ways - 1;
+}
+
+/* marks way as most recently used */
+static void tlb_touch(TLB_Entry *set, int ways, int way)
+{
+    for (int i = 0; i < ways; ++i) {
+        if (set[i].lru < set[way].lru)
+            set[i].lru++;
+    }
+    set[way].lru = 0;
+}
+
+/* returns the way holding vpn, or -1 */
+static int tlb_find(TLB *tlb, uint32_t vpn)
+{
+    TLB_Entry *set = &tlb->entries[(vpn & (tlb->num_sets - 1)) * tlb->num_ways];
+    for (int way = 0; way < tlb->num_ways; ++way) {
+        if (set[way].valid && set[way].vpn == vpn)
+            return way;
+    }
+    return -1;
+}
+
+static int tlb_lookup(TLB *tlb, uint32_t vpn)
+{
+    TLB_Entry *set = &tlb->entries[(vpn & (tlb->num_sets - 1)) * tlb->num_ways];
+    int way = tlb_find(tlb, vpn);
+
+    tlb->stat_accesses++;
+    if (way == -1) {
+        tlb->stat_misses++;
+        return 0;
+    }
+
+    tlb_touch(set, tlb->num_ways, way);
+    return 1;
+}
+
+static void tlb_insert(TLB *tlb, uint32_t vpn)
+{
+    TLB_Entry *set = &tlb->entries[(vpn & (tlb->num_sets - 1)) * tlb->num_ways];
+    int victim = 0;
+
+    for (int way = 0; way < tlb->num_ways; ++way) {
+        if (set[way].lru == tlb->num_ways - 1)
+            victim = way;
+    }
+
+    set[victim].vpn = vpn;
+    set[victim].valid = 1;
+    tlb_touch(set, tlb->num_ways, victim);
+}
+
+void init_mmu(MMU *mmu)
+{
+    init_tlb(&mmu->itlb, "ITLB", sim_config.itlb_entries, sim_config.itlb_ways);
+    init_tlb(&mmu->dtlb, "DTLB", sim_config.dtlb_entries, sim_config.dtlb_ways);
+    init_tlb(&mmu->l2, "L2TLB", sim_config.l2tlb_entries, sim_config.l2tlb_ways);
+    mmu->l2_latency = sim_config.l2tlb_latency;
+    mmu->stat_walks = mmu->stat_walk_cycles = 0;
+}
+
+void destroy_mmu(MMU *mmu)
+{
+    free(mmu->itlb.entries);
+    free(mmu->dtlb.entries);
+    free(mmu->l2.entries);
+}
+
+uint32_t mmu_translate(MMU *mmu, TLB *l1, uint32_t vaddr)
+{
+    uint32_t vpn = vaddr >> TLB_PAGE_BITS;
+    uint32_t cycles = 0;
+
+    if (tlb_lookup(l1, vpn))
+        return 0;
+
+    if (mmu->l2.entries) {
+        cycles = mmu->l2_latency;
+        if (tlb_lookup(&mmu->l2, vpn)) {
+            tlb_insert(l1, vpn);
+            return cycles;
+        }
+    }
+
+    /* the root page holds one entry per leaf page of entries */
+    uint32_t entries_per_page = 1 << (TLB_PAGE_BITS - 2);
+    uint32_t root_pte = TLB_PT_BASE + (vpn / entries_per_page) * 4;
+    uint32_t leaf_pte = TLB_PT_BASE + (1 << TLB_PAGE_BITS) + vpn * 4;
+    uint32_t walk_start = cycles;
+
+    cycles = d_cache_walk_access(root_pte, cycles);
+    cycles = d_cache_walk_access(leaf_pte, cycles);
+    mmu->stat_walks++;
+    mmu->stat_walk_cycles += cycles - walk_start;
+
+    if (mmu->l2.entries)
+        tlb_insert(&mmu->l2, vpn);
+    tlb_insert(l1, vpn);
+
+    return cycles;
+}
+
+int mmu_probe(MMU *mmu, TLB *l1, uint32_t vaddr)
+{
+    uint32_t vpn = vaddr >> TLB_PAGE_BITS;
+
+    return tlb_find(l1, vpn) != -1 || (mmu->l2.entries && tlb_find(&mmu->l2, vpn) != -1);
+}
+
+static void tlb_register_stats(TLB *tlb)
+{
+    char name[64];
+
+    if (tlb->num_sets == 0)
+        return;
+
+    snprintf(name, sizeof(name), "%sEntries", tlb->name);
+    stats_register_constant(name, tlb->num_sets * tlb->num_ways, "TLB entries");
+    snprintf(name, sizeof(name), "%sAccesses", tlb->name);
+    stats_register_counter(name, &tlb->stat_accesses, "TLB lookups");
+    snprintf(name, sizeof(name), "%sMisses", tlb->name);
+    stats_register_counter(name, &tlb->stat_misses, "TLB misses");
+    snprintf(name, sizeof(name), "%sMissRate", tlb->name);
+    stats_register_formula(name, &tlb->stat_misses, NULL, &tlb->stat_accesses, 1.0,
+                           "TLB miss rate");
+}
+
+void mmu_register_stats(MMU *mmu)
+{
+    tlb_register_stats(&mmu->itlb);
+    tlb_register_stats(&mmu->dtlb);
+    tlb_register_stats(&mmu->l2);
+    stats_register_counter("PageWalks", &mmu->stat_walks, "page table walks");
+    stats_register_counter("PageWalkCycles", &mmu->stat_walk_cycles, "cycles spent walking");
+    stats_register_formula("AvgWalkCycles", &mmu->stat_walk_cycles, NULL, &mmu->stat_walks, 1.0,
+                           "average page walk latency");
+}
@@ -0,0 +1,64 @@
+#ifndef _TLB_H_
+#define _TLB_H_
+
+#include <stdint.h>
+
+#define TLB_PAGE_BITS 12        /* 4KB pages */
+#define TLB_PT_BASE 0xA0000000  /* page table: a root page followed by the leaf tables */
+
+#define ITLB_SIZE 0             /* 0 = instruction addresses are not translated */
+#define DTLB_SIZE 0             /* 0 = data addresses are not translated */
+#define L1_TLB_WAYS 4
+#define L2_TLB_SIZE 512         /* 0 = no L2 TLB */
+#define L2_TLB_WAYS 4
+#define L2_TLB_LATENCY 4
+
+typedef struct TLB_Entry {
+    uint32_t vpn;
+    uint8_t valid;
+    uint8_t lru;
+} TLB_Entry;
+
+/* set-associative TLB with LRU replacement */
+typedef struct TLB {
+    const char *name;
+    int num_sets, num_ways;
+    TLB_Entry *entries;     /* num_sets x num_ways */
+
+    /* statistics */
+    uint64_t stat_accesses;
+    uint64_t stat_misses;
+} TLB;
+
+/* Address translation. Virtual pages are mapped to the physical page with
+ * the same number. A miss in an L1 TLB looks up the shared L2 TLB, and a miss
+ * there walks a two-level page table: the walker reads the root entry and the
+ * leaf entry through the L1D. */
+typedef struct MMU {
+    TLB itlb, dtlb, l2;
+    int l2_latency;
+
+    /* statistics */
+    uint64_t stat_walks;
+    uint64_t stat_walk_cycles;
+} MMU;
+
+/* allocates the TLBs with the configured geometry */
+void init_mmu(MMU *mmu);
+
+/* frees all TLBs */
+void destroy_mmu(MMU *mmu);
+
+/* translates vaddr through the given L1 TLB (itlb or dtlb) and returns the
+ * cycles until the translation is available (0 on an L1 TLB hit). The TLBs
+ * are filled right away, so the access hits when it is retried. */
+uint32_t mmu_translate(MMU *mmu, TLB *l1, uint32_t vaddr);
+
+/* returns 1 if vaddr is mapped by the L1 TLB or the L2 TLB, without updating
+ * any state */
+int mmu_probe(MMU *mmu, TLB *l1, uint32_t vaddr);
+
+/* registers TLB miss rates and page walk statistics */
+void mmu_register_stats(MMU *mmu);
+
+#endif
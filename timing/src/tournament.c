@@ -0,0 +1,73 @@
+#include "tournament.h"
+#include <stdlib.h>
+
+void init_tournament(Tournament *tournament, uint32_t bimodal_size, uint32_t history_bits,
+                     uint32_t pht_size, uint32_t chooser_size)
+{
+    init_bimodal(&tournament->bimodal, bimodal_size);
+    init_gshare(&tournament->gshare, history_bits, pht_size);
+
+    tournament->chooser_size = chooser_size;
+    tournament->chooser = (uint8_t*) malloc(chooser_size * sizeof(uint8_t));
+    for (uint32_t i = 0; i < chooser_size; ++i) {
+        tournament->chooser[i] = 1;
+    }
+}
+
+void destroy_tournament(Tournament *tournament)
+{
+    destroy_bimodal(&tournament->bimodal);
+    destroy_gshare(&tournament->gshare);
+    free(tournament->chooser);
+}
+
+int predict_tournament(Tournament *tournament, uint32_t PC, Bpred_Info *info)
+{
+    Bpred_Info component;
+
+    uint8_t bimodal_taken = predict_bimodal(&tournament->bimodal, PC, &component);
+    info->index[0] = component.index[0];
+    uint8_t gshare_taken = predict_gshare(&tournament->gshare, PC, &component);
+    info->index[1] = component.index[0];
+    info->history = component.history;
+    info->index[2] = (PC >> 2) & (tournament->chooser_size - 1);
+
+    if (tournament->chooser[info->index[2]] > 1) {
+        info->provider = TOURNAMENT_GSHARE;
+        info->taken = gshare_taken;
+        info->alt_taken = bimodal_taken;
+    }
+    else {
+        info->provider = TOURNAMENT_BIMODAL;
+        info->taken = bimodal_taken;
+        info->alt_taken = gshare_taken;
+    }
+
+    return info->taken;
+}
+
+void update_tournament(Tournament *tournament, uint32_t PC, uint8_t is_taken, Bpred_Info *info)
+{
+    /* move the chooser towards the component that was right */
+    if (info->taken != info->alt_taken) {
+        uint8_t *choice = &tournament->chooser[info->index[2]];
+        uint8_t gshare_correct = (info->provider == TOURNAMENT_GSHARE) == (info->taken == is_taken);
+
+        if (gshare_correct) {
+            *choice += (*choice == 3 ? 0 : 1);
+        }
+        else {
+            *choice -= (*choice == 0 ? 0 : 1);
+        }
+    }
+
+    update_bimodal(&tournament->bimodal, info->index[0], is_taken);
+    update_gshare(&tournament->gshare, info->index[1], is_taken);
+}
+
+uint32_t tournament_storage_bits(Tournament *tournament)
+{
+    return bimodal_storage_bits(&tournament->bimodal) +
+           gshare_storage_bits(&tournament->gshare) +
+           2 * tournament->chooser_size;
+}
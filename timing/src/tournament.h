@@ -0,0 +1,41 @@
+#ifndef _TOURNAMENT_H_
+#define _TOURNAMENT_H_
+
+#include <stdint.h>
+#include "bpred_info.h"
+#include "bimodal.h"
+#include "gshare.h"
+
+#define CHOOSER_SIZE 4096
+
+/* components of the tournament predictor */
+#define TOURNAMENT_BIMODAL 0
+#define TOURNAMENT_GSHARE  1
+
+/* Bimodal and gshare components with a PC-indexed table of 2-bit counters
+ * that chooses between them (>1 selects gshare). */
+typedef struct Tournament {
+    Bimodal bimodal;
+    Gshare gshare;
+    uint32_t chooser_size;
+    uint8_t *chooser;
+} Tournament;
+
+/* initializes both components and the chooser */
+void init_tournament(Tournament *tournament, uint32_t bimodal_size, uint32_t history_bits,
+                     uint32_t pht_size, uint32_t chooser_size);
+
+/* frees all tables */
+void destroy_tournament(Tournament *tournament);
+
+/* returns 1 if the branch at PC is predicted taken */
+int predict_tournament(Tournament *tournament, uint32_t PC, Bpred_Info *info);
+
+/* trains both components, and the chooser if they disagreed (the gshare
+ * component is trained at info->index[1]) */
+void update_tournament(Tournament *tournament, uint32_t PC, uint8_t is_taken, Bpred_Info *info);
+
+/* returns the number of bits of predictor state */
+uint32_t tournament_storage_bits(Tournament *tournament);
+
+#endif
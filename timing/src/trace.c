@@ -0,0 +1,341 @@
+#include "trace.h"
+#include "lz.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRACE_MAGIC "MIPSTRC1"
+#define TRACE_HEADER_SIZE 16
+#define TRACE_BLOCK_HEADER_SIZE 12
+
+/* flags, PC, instruction, register writes and address, at their longest */
+#define TRACE_MAX_RECORD (1 + 5 + 4 + TRACE_MAX_REG_WRITES * 6 + 5)
+
+Trace_Writer trace;
+
+static inline uint32_t zigzag(uint32_t delta)
+{
+    return (delta << 1) ^ (uint32_t) ((int32_t) delta >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ (0 - (v & 1));
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+static inline const uint8_t *get_varint(const uint8_t *p, uint32_t *v)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t b = *p++;
+        value |= (uint32_t) (b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    *v = value;
+    return p;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = (uint8_t) (v >> (8 * i));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void trace_start_block()
+{
+    trace.used = 0;
+    trace.num_records = 0;
+    trace.block_number++;
+    trace.last_pc = 0;
+    trace.last_mem_addr = 0;
+    memset(trace.last_value, 0, sizeof(trace.last_value));
+}
+
+static void trace_flush_block()
+{
+    if (trace.num_records == 0)
+        return;
+
+    const uint8_t *data = trace.block;
+    size_t stored = trace.used;
+    if (trace.compress) {
+        size_t size = lz_compress(trace.block, trace.used, trace.compressed);
+        if (size < trace.used) {
+            data = trace.compressed;
+            stored = size;
+        }
+    }
+
+    uint8_t header[TRACE_BLOCK_HEADER_SIZE];
+    put_u32(header, trace.used);
+    put_u32(header + 4, stored);
+    put_u32(header + 8, trace.num_records);
+    if (fwrite(header, 1, sizeof(header), trace.file) != sizeof(header) ||
+        fwrite(data, 1, stored, trace.file) != stored) {
+        printf("Error: trace write failed\n");
+        exit(-1);
+    }
+
+    trace_start_block();
+}
+
+void init_trace(const char *filename, int compress, uint32_t text_start, uint32_t text_size)
+{
+    trace.file = fopen(filename, "wb");
+    if (trace.file == NULL) {
+        printf("Error: cannot open %s for writing\n", filename);
+        exit(-1);
+    }
+
+    uint8_t header[TRACE_HEADER_SIZE];
+    memcpy(header, TRACE_MAGIC, 8);
+    put_u32(header + 8, text_start);
+    put_u32(header + 12, text_size);
+    fwrite(header, 1, sizeof(header), trace.file);
+
+    trace.compress = compress;
+    trace.block = malloc(TRACE_BLOCK_SIZE);
+    trace.compressed = compress ? malloc(LZ_BOUND(TRACE_BLOCK_SIZE)) : NULL;
+    trace.text_start = text_start;
+    trace.text_words = text_size / 4;
+    trace.seen = calloc(trace.text_words, sizeof(uint32_t));
+    trace.block_number = 0;
+    trace_start_block();
+    trace.active = 1;
+
+    /* the shell may exit before the program halts */
+    atexit(trace_finish);
+}
+
+void trace_write(const Trace_Record *record)
+{
+    if (trace.used + TRACE_MAX_RECORD > TRACE_BLOCK_SIZE)
+        trace_flush_block();
+
+    uint8_t *p = trace.block + trace.used;
+    uint8_t *flags = p++;
+    uint8_t f = (uint8_t) (record->num_reg_writes << TRACE_F_REG_SHIFT);
+
+    if (record->pc != trace.last_pc + 4) {
+        f |= TRACE_F_PC;
+        p = put_varint(p, zigzag(record->pc - (trace.last_pc + 4)));
+    }
+    trace.last_pc = record->pc;
+
+    uint32_t index = (record->pc - trace.text_start) >> 2;
+    if (index >= trace.text_words || trace.seen[index] != trace.block_number) {
+        f |= TRACE_F_INSTRUCTION;
+        put_u32(p, record->instruction);
+        p += 4;
+        if (index < trace.text_words)
+            trace.seen[index] = trace.block_number;
+    }
+
+    for (int i = 0; i < record->num_reg_writes; ++i) {
+        uint8_t reg = record->reg[i];
+        *p++ = reg;
+        p = put_varint(p, zigzag(record->value[i] - trace.last_value[reg]));
+        trace.last_value[reg] = record->value[i];
+    }
+
+    if (record->mem != TRACE_MEM_NONE) {
+        f |= TRACE_F_MEM | (record->mem == TRACE_MEM_STORE ? TRACE_F_STORE : 0);
+        p = put_varint(p, zigzag(record->mem_addr - trace.last_mem_addr));
+        trace.last_mem_addr = record->mem_addr;
+    }
+
+    *flags = f;
+    trace.used = p - trace.block;
+    trace.num_records++;
+}
+
+void trace_finish()
+{
+    if (!trace.active)
+        return;
+
+    trace_flush_block();
+    fclose(trace.file);
+    free(trace.block);
+    free(trace.compressed);
+    free(trace.seen);
+    trace.active = 0;
+}
+
+void init_trace_reader(Trace_Reader *r, const char *filename)
+{
+    memset(r, 0, sizeof(Trace_Reader));
+
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error: cannot open trace %s\n", filename);
+        exit(-1);
+    }
+    r->size = st.st_size;
+    if (r->size < TRACE_HEADER_SIZE) {
+        printf("Error: %s is not a trace\n", filename);
+        exit(-1);
+    }
+    r->data = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (r->data == MAP_FAILED) {
+        printf("Error: cannot map trace %s\n", filename);
+        exit(-1);
+    }
+    if (memcmp(r->data, TRACE_MAGIC, 8) != 0) {
+        printf("Error: %s is not a trace\n", filename);
+        exit(-1);
+    }
+    madvise((void *) r->data, r->size, MADV_SEQUENTIAL);
+
+    r->text_start = get_u32(r->data + 8);
+    r->text_words = get_u32(r->data + 12) / 4;
+    r->instructions = calloc(r->text_words, sizeof(uint32_t));
+    r->block = malloc(TRACE_BLOCK_SIZE);
+    r->pos = TRACE_HEADER_SIZE;
+}
+
+void init_trace_cursor(Trace_Reader *r, const Trace_Reader *mapped)
+{
+    memset(r, 0, sizeof(Trace_Reader));
+    r->data = mapped->data;
+    r->size = mapped->size;
+    r->shared = 1;
+
+    r->text_start = mapped->text_start;
+    r->text_words = mapped->text_words;
+    r->instructions = calloc(r->text_words, sizeof(uint32_t));
+    r->block = malloc(TRACE_BLOCK_SIZE);
+    r->pos = TRACE_HEADER_SIZE;
+}
+
+void destroy_trace_reader(Trace_Reader *r)
+{
+    if (!r->shared)
+        munmap((void *) r->data, r->size);
+    free(r->instructions);
+    free(r->block);
+    r->data = NULL;
+}
+
+/* moves to the next block; returns 0 at the end of the trace */
+static int trace_next_block(Trace_Reader *r)
+{
+    if (r->pos + TRACE_BLOCK_HEADER_SIZE > r->size)
+        return 0;
+
+    const uint8_t *header = r->data + r->pos;
+    uint32_t size = get_u32(header), stored = get_u32(header + 4);
+    r->pos += TRACE_BLOCK_HEADER_SIZE;
+    if (stored > r->size - r->pos || size > TRACE_BLOCK_SIZE) {
+        printf("Error: truncated or corrupt trace\n");
+        exit(-1);
+    }
+
+    if (stored == size) {
+        r->records = r->data + r->pos;
+    }
+    else {
+        if (lz_decompress(r->data + r->pos, stored, r->block, TRACE_BLOCK_SIZE) != size) {
+            printf("Error: corrupt trace block\n");
+            exit(-1);
+        }
+        r->records = r->block;
+    }
+    r->pos += stored;
+    r->records_size = size;
+    r->offset = 0;
+
+    r->last_pc = 0;
+    r->last_mem_addr = 0;
+    memset(r->last_value, 0, sizeof(r->last_value));
+    return 1;
+}
+
+int trace_read(Trace_Reader *r, Trace_Record *record)
+{
+    while (r->offset >= r->records_size) {
+        if (!trace_next_block(r))
+            return 0;
+    }
+
+    /* a record near the end of the block is decoded from a padded copy, so
+     * that a corrupt one cannot read past the block */
+    uint8_t tail[TRACE_MAX_RECORD];
+    const uint8_t *start = r->records + r->offset;
+    size_t left = r->records_size - r->offset;
+    if (left < TRACE_MAX_RECORD) {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, start, left);
+        start = tail;
+    }
+    const uint8_t *p = start;
+    uint8_t f = *p++;
+    uint32_t v;
+
+    record->pc = r->last_pc + 4;
+    if (f & TRACE_F_PC) {
+        p = get_varint(p, &v);
+        record->pc += unzigzag(v);
+    }
+    r->last_pc = record->pc;
+
+    uint32_t index = (record->pc - r->text_start) >> 2;
+    if (f & TRACE_F_INSTRUCTION) {
+        record->instruction = get_u32(p);
+        p += 4;
+        if (index < r->text_words)
+            r->instructions[index] = record->instruction;
+    }
+    else {
+        record->instruction = index < r->text_words ? r->instructions[index] : 0;
+    }
+
+    record->num_reg_writes = (f >> TRACE_F_REG_SHIFT) & 3;
+    if (record->num_reg_writes > TRACE_MAX_REG_WRITES) {
+        printf("Error: corrupt trace block\n");
+        exit(-1);
+    }
+    for (int i = 0; i < record->num_reg_writes; ++i) {
+        uint8_t reg = *p++ % (TRACE_REG_LO + 1);
+        p = get_varint(p, &v);
+        record->reg[i] = reg;
+        record->value[i] = r->last_value[reg] + unzigzag(v);
+        r->last_value[reg] = record->value[i];
+    }
+
+    record->mem = TRACE_MEM_NONE;
+    if (f & TRACE_F_MEM) {
+        p = get_varint(p, &v);
+        record->mem = f & TRACE_F_STORE ? TRACE_MEM_STORE : TRACE_MEM_LOAD;
+        record->mem_addr = r->last_mem_addr + unzigzag(v);
+        r->last_mem_addr = record->mem_addr;
+    }
+
+    if ((size_t) (p - start) > left) {
+        printf("Error: corrupt trace block\n");
+        exit(-1);
+    }
+    r->offset += p - start;
+    return 1;
+}
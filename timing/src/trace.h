@@ -0,0 +1,115 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* registers in trace records beyond the GPRs */
+#define TRACE_REG_HI 32
+#define TRACE_REG_LO 33
+
+/* memory access of a record */
+#define TRACE_MEM_NONE  0
+#define TRACE_MEM_LOAD  1
+#define TRACE_MEM_STORE 2
+
+#define TRACE_MAX_REG_WRITES 2
+
+/* A retired instruction. */
+typedef struct Trace_Record {
+    uint32_t pc;
+    uint32_t instruction;
+    int num_reg_writes;                  /* $zero is never written */
+    uint8_t reg[TRACE_MAX_REG_WRITES];   /* 0 -- 31, TRACE_REG_HI or TRACE_REG_LO */
+    uint32_t value[TRACE_MAX_REG_WRITES];
+    int mem;                             /* TRACE_MEM_* */
+    uint32_t mem_addr;
+} Trace_Record;
+
+/* Binary instruction trace. The file starts with the magic "MIPSTRC1", the
+ * start address and the size of the text segment, and is followed by blocks
+ * of records. Each block has a 12-byte header: the size of its records, the
+ * size stored in the file (smaller if the block was compressed with lz.h) and
+ * the number of records. All fixed-size numbers are 32-bit little-endian.
+ *
+ * A record starts with a flags byte (TRACE_F_*). The PC is stored as a
+ * zigzag varint of its difference to the previous PC + 4, and only if that
+ * is not 0. The instruction word is stored the first time its PC appears in a
+ * block. A register write is the register number followed by a zigzag
+ * varint of its difference to the register's previous value, and the memory
+ * address a zigzag varint of its difference to the previous address. All
+ * differences start from 0 in every block, so blocks can be decoded
+ * independently. */
+#define TRACE_F_PC          0x01    /* not the previous PC + 4 */
+#define TRACE_F_INSTRUCTION 0x02    /* instruction word follows */
+#define TRACE_F_REG_SHIFT   2       /* 2 bits: number of register writes */
+#define TRACE_F_MEM         0x10
+#define TRACE_F_STORE       0x20
+
+#define TRACE_BLOCK_SIZE (1 << 18)
+
+/* Trace being written (at most one per simulator). */
+typedef struct Trace_Writer {
+    int active;                 /* cleared when tracing is off */
+    int compress;
+    FILE *file;
+
+    uint8_t *block, *compressed;
+    size_t used;
+    uint32_t num_records;
+    uint32_t block_number;      /* from 1 */
+
+    /* previous values within the block */
+    uint32_t last_pc, last_mem_addr;
+    uint32_t last_value[TRACE_REG_LO + 1];
+
+    /* block in which each text word was last written; words outside the
+     * text segment are always written */
+    uint32_t text_start, text_words;
+    uint32_t *seen;
+} Trace_Writer;
+
+/* global variable -- the trace of this simulator */
+extern Trace_Writer trace;
+
+/* starts writing a trace of the instructions retired from now on; the file
+ * is completed when the simulator exits */
+void init_trace(const char *filename, int compress, uint32_t text_start, uint32_t text_size);
+
+/* appends a record; only call while trace.active is set */
+void trace_write(const Trace_Record *record);
+
+/* writes the last block and closes the file */
+void trace_finish();
+
+/* Trace being read, mapped into memory. */
+typedef struct Trace_Reader {
+    const uint8_t *data;
+    size_t size, pos;           /* file, and position of the next block */
+
+    uint8_t *block;             /* decompressed block */
+    const uint8_t *records;     /* records of the current block */
+    size_t records_size, offset;
+
+    uint32_t last_pc, last_mem_addr;
+    uint32_t last_value[TRACE_REG_LO + 1];
+    uint32_t *instructions;     /* text words seen so far */
+    uint32_t text_start, text_words;
+    int shared;                 /* the mapping belongs to another reader */
+} Trace_Reader;
+
+/* maps a trace file; exits on error */
+void init_trace_reader(Trace_Reader *r, const char *filename);
+
+/* reads, from its start, a trace already mapped by another reader, which
+ * must outlive this one; readers of one mapping can run in different threads */
+void init_trace_cursor(Trace_Reader *r, const Trace_Reader *mapped);
+
+/* frees the reader, and unmaps the file unless the mapping is shared */
+void destroy_trace_reader(Trace_Reader *r);
+
+/* reads the next record; returns 0 at the end of the trace */
+int trace_read(Trace_Reader *r, Trace_Record *record);
+
+#endif
@@ -0,0 +1,129 @@
+#include "trace_sim.h"
+#include "bpred.h"
+#include "cache.h"
+#include "config.h"
+#include "shell.h"
+#include "stack_dist.h"
+#include "stats.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* accesses the line of addr; returns 1 on a miss, which fills the line */
+static inline int trace_sim_access(Cache *cache, int log2_num_sets, uint32_t addr)
+{
+    static uint32_t no_data[BLOCK_SIZE];
+    uint32_t tag = addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE + log2_num_sets);
+    uint16_t set = (addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE)) & (cache->NUM_SET - 1);
+    uint16_t way = cache_get_way(cache, set, tag);
+
+    cache->stat_accesses++;
+    if (way != cache->NUM_WAY) {
+        cache_update_lru_state(cache, set, way);
+        return 0;
+    }
+
+    cache->stat_misses++;
+    cache_insert_data(cache, set, cache_find_victim(cache, set), tag, no_data);
+    return 1;
+}
+
+void trace_sim_run(const char *filename)
+{
+    Trace_Reader reader;
+    Trace_Record record;
+    Cache l1i, l1d;
+    Branch_Predictor bp;
+
+    /* the branch at branch_pc waits for the next PC to resolve */
+    int branch_pending = 0;
+    uint32_t branch_pc = 0;
+    Bpred_Info branch_info;
+
+    /* instruction and data stack distances */
+    int stack_distance = sim_config.stack_distance;
+    Stack_Distance sd_i, sd_d;
+
+    init_trace_reader(&reader, filename);
+    cache_init(&l1i, L1I_NUM_SETS, L1I_NUM_WAYS);
+    cache_init(&l1d, L1D_NUM_SETS, L1D_NUM_WAYS);
+    init_bpred(&bp, sim_config.bp);
+
+    stats_register_counter("RetiredInstr", &stat_inst_retire, "instructions in the trace");
+    cache_register_stats(&l1i, "L1I");
+    stats_register_formula("L1IMPKI", &l1i.stat_misses, NULL, &stat_inst_retire, 1000.0,
+                           "L1I misses per 1000 instructions");
+    cache_register_stats(&l1d, "L1D");
+    stats_register_formula("L1DMPKI", &l1d.stat_misses, NULL, &stat_inst_retire, 1000.0,
+                           "L1D misses per 1000 instructions");
+    bpred_register_stats(&bp);
+
+    if (stack_distance) {
+        init_stack_distance(&sd_i, sim_config.stack_distance_sets);
+        init_stack_distance(&sd_d, sim_config.stack_distance_sets);
+    }
+
+    clock_t start = clock();
+    while (trace_read(&reader, &record)) {
+        stat_inst_retire++;
+
+        if (branch_pending) {
+            uint8_t taken = record.pc != branch_pc + 4;
+            bpred_resolve(&bp, branch_pc, taken, &branch_info);
+            /* there is no wrong path to repair: the history is always right */
+            if (bp.speculative)
+                bpred_update_history(&bp, taken);
+            branch_pending = 0;
+        }
+
+        trace_sim_access(&l1i, L1I_LOG2_NUM_SETS, record.pc);
+        if (record.mem != TRACE_MEM_NONE)
+            trace_sim_access(&l1d, L1D_LOG2_NUM_SETS, record.mem_addr);
+
+        if (stack_distance) {
+            stack_distance_access(&sd_i, record.pc >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE));
+            if (record.mem != TRACE_MEM_NONE)
+                stack_distance_access(&sd_d, record.mem_addr >> (LOG2_WORD_SIZE + LOG2_BLOCK_SIZE));
+        }
+
+        if (bpred_is_cond_branch(record.instruction)) {
+            bpred_predict(&bp, record.pc, &branch_info);
+            branch_pc = record.pc;
+            branch_pending = 1;
+        }
+    }
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    printf("Trace %s: %" PRIu64 " instructions in %.2f s (%.1f M/s)\n\n", filename,
+           stat_inst_retire, seconds, seconds > 0 ? stat_inst_retire / seconds / 1e6 : 0.0);
+    stats_dump(stdout, STATS_TEXT);
+
+    if (stack_distance) {
+        int line_bytes = BLOCK_SIZE << LOG2_WORD_SIZE;
+        printf("\n");
+        stack_distance_report(&sd_i, stdout, "L1I", line_bytes, sim_config.stack_distance_ways);
+        stack_distance_report(&sd_d, stdout, "L1D", line_bytes, sim_config.stack_distance_ways);
+
+        if (sim_config.stack_distance_file[0]) {
+            FILE *out = fopen(sim_config.stack_distance_file, "w");
+            if (out == NULL) {
+                printf("Error: cannot open stack distance file %s\n", sim_config.stack_distance_file);
+                exit(-1);
+            }
+            fprintf(out, "stream,sets,ways,bytes,misses,miss_rate\n");
+            stack_distance_write_csv(&sd_i, out, "L1I", line_bytes);
+            stack_distance_write_csv(&sd_d, out, "L1D", line_bytes);
+            fclose(out);
+        }
+
+        destroy_stack_distance(&sd_d);
+        destroy_stack_distance(&sd_i);
+    }
+
+    destroy_bpred(&bp);
+    cache_destroy(&l1d);
+    cache_destroy(&l1i);
+    destroy_trace_reader(&reader);
+}
@@ -0,0 +1,10 @@
+#ifndef _TRACE_SIM_H_
+#define _TRACE_SIM_H_
+
+/* Trace-driven mode: runs the instruction fetches, the memory accesses and
+ * the conditional branches of a trace (see trace.h) through the L1 caches and
+ * the configured direction predictor, without a pipeline, and prints their
+ * statistics. */
+void trace_sim_run(const char *filename);
+
+#endif
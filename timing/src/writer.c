@@ -0,0 +1,98 @@
+#include "writer.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+void init_writer(Buffered_Writer *w, const char *filename, size_t size)
+{
+    w->file = fopen(filename, "wb");
+    if (w->file == NULL) {
+        printf("Error: cannot open %s for writing\n", filename);
+        exit(-1);
+    }
+    w->size = size;
+    w->used = 0;
+    w->buffer = malloc(size);
+}
+
+void destroy_writer(Buffered_Writer *w)
+{
+    if (w->file == NULL)
+        return;
+
+    writer_flush(w);
+    fclose(w->file);
+    free(w->buffer);
+    w->file = NULL;
+    w->buffer = NULL;
+}
+
+void writer_flush(Buffered_Writer *w)
+{
+    if (w->used && fwrite(w->buffer, 1, w->used, w->file) != w->used) {
+        printf("Error: write failed\n");
+        exit(-1);
+    }
+    w->used = 0;
+}
+
+void writer_write(Buffered_Writer *w, const void *data, size_t len)
+{
+    if (w->used + len > w->size) {
+        writer_flush(w);
+        /* too large to buffer */
+        if (len > w->size) {
+            if (fwrite(data, 1, len, w->file) != len) {
+                printf("Error: write failed\n");
+                exit(-1);
+            }
+            return;
+        }
+    }
+    memcpy(w->buffer + w->used, data, len);
+    w->used += len;
+}
+
+void writer_write_u64(Buffered_Writer *w, uint64_t value)
+{
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    writer_write(w, bytes, 8);
+}
+
+void writer_write_varint(Buffered_Writer *w, uint64_t value)
+{
+    uint8_t bytes[10];
+    int n = 0;
+    while (value >= 0x80) {
+        bytes[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    bytes[n++] = (uint8_t) value;
+    writer_write(w, bytes, n);
+}
+
+void writer_printf(Buffered_Writer *w, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(w->buffer + w->used, w->size - w->used, format, args);
+    va_end(args);
+    if (len < 0)
+        return;
+
+    if ((size_t) len < w->size - w->used) {
+        w->used += len;
+        return;
+    }
+
+    /* did not fit: format again into a buffer of the right size */
+    char *text = malloc(len + 1);
+    va_start(args, format);
+    vsnprintf(text, len + 1, format, args);
+    va_end(args);
+    writer_write(w, text, len);
+    free(text);
+}
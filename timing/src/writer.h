@@ -0,0 +1,40 @@
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define WRITER_BUFFER_SIZE (1 << 16)
+
+/* Output file that collects small writes in a buffer and hands them to the
+ * C library in large blocks. */
+typedef struct Buffered_Writer {
+    FILE *file;
+    char *buffer;
+    size_t size, used;
+} Buffered_Writer;
+
+/* opens the file for writing (exits on error) */
+void init_writer(Buffered_Writer *w, const char *filename, size_t size);
+
+/* flushes the buffer, closes the file and frees the buffer */
+void destroy_writer(Buffered_Writer *w);
+
+/* appends raw bytes */
+void writer_write(Buffered_Writer *w, const void *data, size_t len);
+
+/* appends a 64-bit value in little-endian byte order */
+void writer_write_u64(Buffered_Writer *w, uint64_t value);
+
+/* appends a value as a varint: 7 bits per byte, least significant first,
+ * with the top bit set on all but the last byte */
+void writer_write_varint(Buffered_Writer *w, uint64_t value);
+
+/* appends formatted text */
+void writer_printf(Buffered_Writer *w, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/* writes out the buffered bytes */
+void writer_flush(Buffered_Writer *w);
+
+#endif